@@ -0,0 +1,16 @@
+#include "core/bench.hpp"
+
+#include <cstdio>
+
+void run_job_benchmarks();
+void run_memory_benchmarks();
+
+int main() {
+    std::printf("cube_bench\n");
+    cube::bench::Registry builtin;
+    cube::bench::register_builtin_benchmarks(builtin);
+    builtin.run("all", {}, cube::bench::print);
+    run_job_benchmarks();
+    run_memory_benchmarks();
+    return 0;
+}
@@ -0,0 +1,251 @@
+#include "core/bench.hpp"
+
+#include "core/job_system.hpp"
+#include "core/log.hpp"
+#include "core/parallel_for.hpp"
+#include "core/task_graph.hpp"
+#include "voxel/chunk.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Sink { std::atomic<std::uint64_t> v{0}; };
+
+void touch(void* p) { static_cast<Sink*>(p)->v.fetch_add(1, std::memory_order_relaxed); }
+
+std::uint64_t now_ns() {
+    return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct LatencyProbe {
+    std::uint64_t submit_ns{};
+    std::atomic<std::uint64_t> start_ns{0};
+};
+
+void probe_job(void* p) { static_cast<LatencyProbe*>(p)->start_ns.store(now_ns(), std::memory_order_release); }
+
+// Submit-to-start latency of a single job landing on an idle (parked) worker. The submitter polls a
+// flag instead of JobSystem::wait so it never runs the job itself.
+void submit_latency(cube::jobs::JobSystem& js, cube::jobs::Priority prio, const char* label) {
+    constexpr int samples = 2000;
+    std::vector<double> us;
+    us.reserve(samples);
+    for (int i = 0; i < samples; ++i) {
+        std::this_thread::sleep_for(std::chrono::microseconds(500));
+        LatencyProbe probe;
+        probe.submit_ns = now_ns();
+        js.submit(&probe_job, &probe, prio, nullptr, nullptr, "probe");
+        std::uint64_t start = 0;
+        while ((start = probe.start_ns.load(std::memory_order_acquire)) == 0) std::this_thread::yield();
+        us.push_back((double)(start - probe.submit_ns) / 1000.0);
+    }
+    std::sort(us.begin(), us.end());
+    auto pct = [&](double q) { return us[std::min(us.size() - 1, (std::size_t)(q * (double)us.size()))]; };
+    std::printf("%-40s p50 %8.1f us  p90 %8.1f us  p99 %8.1f us  max %8.1f us\n", label, pct(0.50), pct(0.90), pct(0.99), us.back());
+}
+
+// Cost of the submit call alone, per job, for one submit_batch versus the same jobs submitted one by
+// one. The drain (wait) is outside the timed region.
+void batch_submit_cost(cube::jobs::JobSystem& js, Sink& sink) {
+    using cube::jobs::JobSystem;
+    constexpr std::size_t sizes[] = {1, 8, 64, 512, 4096, 10000};
+    std::vector<JobSystem::Job> jobs(10000);
+    for (auto& j : jobs) {
+        j.fn = &touch;
+        j.data = &sink;
+        j.name = "bench.batch";
+    }
+    for (const std::size_t n : sizes) {
+        const int reps = (int)std::max<std::size_t>(20, 20000 / n);
+        std::vector<double> batch, single;
+        batch.reserve(reps);
+        single.reserve(reps);
+        for (int r = 0; r < reps; ++r) {
+            JobSystem::Counter c;
+            js.init_counter(c);
+            std::uint64_t t0 = now_ns();
+            js.submit_batch(jobs.data(), n, cube::jobs::Priority::Normal, &c);
+            batch.push_back((double)(now_ns() - t0) / (double)n);
+            js.wait(c);
+            t0 = now_ns();
+            for (std::size_t i = 0; i < n; ++i) js.submit(jobs[i], cube::jobs::Priority::Normal);
+            single.push_back((double)(now_ns() - t0) / (double)n);
+            while (js.pending_jobs() > 0) std::this_thread::yield();
+        }
+        std::sort(batch.begin(), batch.end());
+        std::sort(single.begin(), single.end());
+        char label[64];
+        std::snprintf(label, sizeof(label), "jobs/submit_batch n=%zu", n);
+        std::printf("%-40s %8.1f ns/job batch  %8.1f ns/job single\n", label, batch[batch.size() / 2], single[single.size() / 2]);
+    }
+}
+
+// Stand-in for chunk meshing until a mesher exists: count exposed faces of every solid block. Same
+// memory access pattern (neighbour lookups through the palette) and roughly the same cost per chunk.
+std::uint32_t count_faces(const cube::voxel::Chunk& c) {
+    using cube::voxel::CHUNK_SIZE;
+    std::uint32_t faces = 0;
+    auto solid = [&](int x, int y, int z) {
+        if (x < 0 || y < 0 || z < 0 || x >= CHUNK_SIZE || y >= CHUNK_SIZE || z >= CHUNK_SIZE) return false;
+        return c.get_block(x, y, z) != 0;
+    };
+    for (int z = 0; z < CHUNK_SIZE; ++z) for (int y = 0; y < CHUNK_SIZE; ++y) for (int x = 0; x < CHUNK_SIZE; ++x) {
+        if (!solid(x, y, z)) continue;
+        faces += !solid(x - 1, y, z) + !solid(x + 1, y, z) + !solid(x, y - 1, z) + !solid(x, y + 1, z) + !solid(x, y, z - 1) + !solid(x, y, z + 1);
+    }
+    return faces;
+}
+
+void meshing_throughput(bool pin, const std::vector<cube::voxel::Chunk>& chunks) {
+    using cube::jobs::JobSystem;
+    JobSystem js;
+    if (!js.init(JobSystem::Config{.thread_count = 0, .queue_capacity = 4096, .stall_warn_ms = 1000, .pin_workers = pin})) return;
+    std::atomic<std::uint64_t> faces{0};
+    char label[64];
+    std::snprintf(label, sizeof(label), "jobs/mesh_faces %s (%u workers)", pin ? "pinned" : "unpinned", js.worker_count());
+    cube::bench::print(cube::bench::run(label, 1, 10, chunks.size(), [&] {
+        cube::jobs::parallel_for(js, 0, chunks.size(), 1, [&](std::size_t i) {
+            faces.fetch_add(count_faces(chunks[i]), std::memory_order_relaxed);
+        });
+    }));
+    js.shutdown();
+}
+
+// Wall time for 4 threads to each emit 2000 warnings into a log file, synchronously (every call
+// formats, writes and flushes under the lock) versus through the writer thread.
+void log_contention(bool async, const char* label) {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "cube_bench.log";
+    cube::log::Config cfg{};
+    cfg.file_path = path.string();
+    cfg.write_stdout = false;
+    cfg.async = async;
+    cfg.overflow = cube::log::OverflowPolicy::Block;
+    cube::log::init(cfg);
+    constexpr std::uint32_t threads = 4, lines = 2000;
+    cube::bench::print(cube::bench::run(label, 1, 5, threads * lines, [&] {
+        std::vector<std::thread> ts;
+        for (std::uint32_t t = 0; t < threads; ++t) {
+            ts.emplace_back([t] {
+                for (std::uint32_t i = 0; i < lines; ++i) LOG_WARN("Bench", "Job 'bench' stall: %u ms on thread %u", i, t);
+            });
+        }
+        for (auto& th : ts) th.join();
+    }));
+    cube::log::flush();
+    cube::log::Config sync{};
+    sync.file_path.clear();
+    sync.async = false;
+    cube::log::init(sync);
+    std::filesystem::remove(path);
+}
+
+// Per-call cost of a LOG_INFO whose level is masked off, and of an enabled one handed to the writer
+// thread with only the binary sink open (no formatting anywhere).
+void log_call_cost() {
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "cube_bench.clog";
+    cube::log::Config cfg{};
+    cfg.file_path.clear();
+    cfg.binary_path = path.string();
+    cfg.write_stdout = false;
+    cfg.overflow = cube::log::OverflowPolicy::Block;
+    cube::log::init(cfg);
+    constexpr std::uint32_t N = 100000;
+    cube::log::set_level_mask(1u << 2);
+    cube::bench::print(cube::bench::run("log/info masked off", 1, 10, N, [&] {
+        for (std::uint32_t i = 0; i < N; ++i) LOG_INFO("Bench", "chunk %u at (%d, %d, %d) meshed in %.3f ms", i, 1, 2, 3, 0.25);
+    }));
+    cube::log::set_level_mask(0xFF);
+    cube::bench::print(cube::bench::run("log/info enabled, binary sink", 1, 10, N, [&] {
+        for (std::uint32_t i = 0; i < N; ++i) LOG_INFO("Bench", "chunk %u at (%d, %d, %d) meshed in %.3f ms", i, 1, 2, 3, 0.25);
+    }));
+    cube::log::flush();
+    cube::log::Config sync{};
+    sync.file_path.clear();
+    sync.async = false;
+    cube::log::init(sync);
+    std::filesystem::remove(path);
+}
+
+}
+
+void run_job_benchmarks() {
+    using cube::jobs::JobSystem;
+    using cube::jobs::Priority;
+
+    JobSystem js;
+    if (!js.init(JobSystem::Config{.thread_count = 0, .queue_capacity = 16384, .stall_warn_ms = 1000})) return;
+    std::printf("jobs: %u workers\n", js.worker_count());
+
+    constexpr std::uint32_t N = 10000;
+    Sink sink;
+
+    cube::bench::print(cube::bench::run("jobs/raw_submit", 3, 20, N, [&] {
+        JobSystem::Counter c;
+        js.init_counter(c);
+        for (std::uint32_t i = 0; i < N; ++i) js.submit(&touch, &sink, Priority::Normal, &c, nullptr, "bench");
+        js.wait(c);
+    }));
+
+    cube::bench::print(cube::bench::run("jobs/raw_submit inline closure", 3, 20, N, [&] {
+        JobSystem::Counter c;
+        js.init_counter(c);
+        Sink* sp = &sink;
+        for (std::uint32_t i = 0; i < N; ++i) js.submit([sp] { sp->v.fetch_add(1, std::memory_order_relaxed); }, Priority::Normal, &c, nullptr, "bench");
+        js.wait(c);
+    }));
+
+    cube::bench::print(cube::bench::run("jobs/parallel_for grain=1", 3, 20, N, [&] {
+        cube::jobs::parallel_for(js, 0, N, 1, [&](std::size_t) { sink.v.fetch_add(1, std::memory_order_relaxed); });
+    }));
+
+    cube::bench::print(cube::bench::run("jobs/parallel_for grain=64", 3, 20, N, [&] {
+        cube::jobs::parallel_for(js, 0, N, 64, [&](std::size_t) { sink.v.fetch_add(1, std::memory_order_relaxed); });
+    }));
+
+    cube::jobs::TaskGraph g;
+    g.reserve(N, N);
+    std::vector<cube::jobs::TaskGraph::NodeId> ids;
+    ids.reserve(N);
+    for (std::uint32_t i = 0; i < N; ++i) ids.push_back(g.add("bench", [&sink] { sink.v.fetch_add(1, std::memory_order_relaxed); }));
+    for (std::uint32_t i = 64; i < N; ++i) g.precede(ids[i - 64], ids[i]);
+    g.compile();
+    cube::bench::print(cube::bench::run("jobs/task_graph replay (64 chains)", 3, 20, N, [&] { g.run(js); }));
+
+    batch_submit_cost(js, sink);
+
+    submit_latency(js, Priority::High, "jobs/submit_to_start high (idle)");
+    submit_latency(js, Priority::Normal, "jobs/submit_to_start normal (idle)");
+
+    {
+        const std::clock_t c0 = std::clock();
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        const std::clock_t c1 = std::clock();
+        std::printf("%-40s %8.2f ms cpu per idle second\n", "jobs/idle_burn", (double)(c1 - c0) * 1000.0 / CLOCKS_PER_SEC);
+    }
+
+    js.shutdown();
+
+    std::vector<cube::voxel::Chunk> chunks;
+    chunks.reserve(64);
+    for (int i = 0; i < 64; ++i) {
+        cube::voxel::Chunk& c = chunks.emplace_back(cube::voxel::ChunkCoord{i, 0, 0});
+        for (int z = 0; z < cube::voxel::CHUNK_SIZE; ++z) for (int y = 0; y < cube::voxel::CHUNK_SIZE; ++y) for (int x = 0; x < cube::voxel::CHUNK_SIZE; ++x) {
+            const int h = 8 + ((x * 7 + z * 13 + i * 5) % 17);
+            if (y < h) c.set_block(x, y, z, (cube::voxel::BlockID)(1 + ((x ^ z ^ y) & 3)));
+        }
+    }
+    meshing_throughput(false, chunks);
+    meshing_throughput(true, chunks);
+
+    log_contention(false, "log/4 threads warn sync");
+    log_contention(true, "log/4 threads warn async");
+    log_call_cost();
+}
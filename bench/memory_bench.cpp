@@ -0,0 +1,352 @@
+#include "core/bench.hpp"
+
+#include "memory/concurrent_pool.hpp"
+#include "memory/heap_allocator.hpp"
+#include "memory/heap_profiler.hpp"
+#include "memory/memory_category.hpp"
+#include "memory/pool_allocator.hpp"
+#include "memory/slab_allocator.hpp"
+#include "memory/virtual_arena.hpp"
+#include "memory/virtual_memory.hpp"
+#include "voxel/chunk_manager.hpp"
+
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+  #include <linux/perf_event.h>
+  #include <sys/ioctl.h>
+  #include <sys/syscall.h>
+  #include <unistd.h>
+#endif
+
+namespace {
+
+double elapsed_us(std::chrono::steady_clock::time_point t0) {
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count() / 1000.0;
+}
+
+// Frame arena setup as App used to do it (zero-filled vector) versus a reserved VirtualArena, then one
+// typical frame's worth of allocations (4 MB) through each. RSS deltas are process-wide.
+void frame_arena_startup() {
+    constexpr std::size_t ARENA = 64ull * 1024ull * 1024ull;
+    constexpr std::size_t FRAME_BYTES = 4ull * 1024ull * 1024ull;
+
+    {
+        const std::size_t rss0 = cube::mem::process_rss();
+        const auto t0 = std::chrono::steady_clock::now();
+        std::vector<std::byte> backing(ARENA);
+        const double init_us = elapsed_us(t0);
+        std::memset(backing.data(), 1, FRAME_BYTES);
+        const std::size_t rss1 = cube::mem::process_rss();
+        std::printf("%-40s init %10.1f us  rss +%8.1f MB\n", "mem/frame_arena vector 64MB", init_us, (double)(rss1 - rss0) / (1024.0 * 1024.0));
+    }
+
+    {
+        const std::size_t rss0 = cube::mem::process_rss();
+        const auto t0 = std::chrono::steady_clock::now();
+        cube::mem::VirtualArena arena(1024ull * 1024ull * 1024ull);
+        const double init_us = elapsed_us(t0);
+        void* p = arena.alloc(FRAME_BYTES, 64);
+        if (p) std::memset(p, 1, FRAME_BYTES);
+        const std::size_t rss1 = cube::mem::process_rss();
+        std::printf("%-40s init %10.1f us  rss +%8.1f MB\n", "mem/frame_arena virtual 1GB reserve", init_us, (double)(rss1 - rss0) / (1024.0 * 1024.0));
+    }
+
+    cube::mem::VirtualArena arena(1024ull * 1024ull * 1024ull);
+    constexpr std::uint32_t ALLOCS = 4096;
+    cube::bench::print(cube::bench::run("mem/virtual_arena 4096 x 1KB + reset", 3, 50, ALLOCS, [&] {
+        for (std::uint32_t i = 0; i < ALLOCS; ++i) static_cast<volatile std::byte*>(arena.alloc(1024, 16))[0] = std::byte{1};
+        arena.reset();
+    }));
+}
+
+// Each thread allocates 64 blocks, then frees them, ROUNDS times. Reported per alloc+free pair across
+// all threads (wall time), so lower is better and perfect scaling halves it with each doubling.
+template <class Alloc, class Free>
+double pool_pairs_ns(std::uint32_t threads, Alloc&& alloc, Free&& free) {
+    constexpr int ROUNDS = 2000;
+    constexpr int BATCH = 64;
+    const auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> ts;
+    for (std::uint32_t t = 0; t < threads; ++t) {
+        ts.emplace_back([&] {
+            void* held[BATCH];
+            for (int r = 0; r < ROUNDS; ++r) {
+                for (int i = 0; i < BATCH; ++i) {
+                    held[i] = alloc();
+                    static_cast<volatile std::byte*>(held[i])[0] = std::byte{1};
+                }
+                for (int i = 0; i < BATCH; ++i) free(held[i]);
+            }
+        });
+    }
+    for (auto& t : ts) t.join();
+    return elapsed_us(t0) * 1000.0 / ((double)threads * ROUNDS * BATCH);
+}
+
+void concurrent_pool_throughput() {
+    constexpr std::size_t BLOCK = 64;
+    for (const std::uint32_t threads : {1u, 2u, 4u, 8u}) {
+        cube::mem::ConcurrentPool pool(BLOCK);
+        const double cp = pool_pairs_ns(threads, [&] { return pool.alloc(BLOCK); }, [&](void* p) { pool.free(p); });
+
+        cube::mem::PoolAllocator locked(BLOCK, 64 * 8 + 64);
+        std::mutex m;
+        const double lp = pool_pairs_ns(threads,
+            [&] { std::scoped_lock lk(m); return locked.alloc(BLOCK); },
+            [&](void* p) { std::scoped_lock lk(m); locked.free(p); });
+
+        const double ml = pool_pairs_ns(threads, [] { return std::malloc(BLOCK); }, [](void* p) { std::free(p); });
+
+        char label[64];
+        std::snprintf(label, sizeof(label), "mem/pool alloc+free %u threads", threads);
+        std::printf("%-40s concurrent %7.1f ns  mutex pool %7.1f ns  malloc %7.1f ns\n", label, cp, lp, ml);
+    }
+}
+
+
+// Synthetic chunk streaming trace: a window of loaded chunks slides forward, each load allocating the
+// per-subchunk palette/count/packed arrays and a CPU mesh buffer, with some palettes regrown while the
+// chunk is live, and the oldest chunk freed wholesale. Sizes follow the palette and mesh code paths.
+struct ChurnOp {
+    std::uint32_t slot;
+    std::uint32_t size; // 0 = free slot
+};
+
+std::vector<ChurnOp> chunk_churn_trace(std::uint32_t seed, std::uint32_t chunks, std::uint32_t& slot_count) {
+    constexpr std::uint32_t WINDOW = 128;
+    constexpr std::uint32_t PER_CHUNK = 16 * 3 + 1;
+    std::uint32_t x = seed | 1u;
+    auto rnd = [&] { x ^= x << 13; x ^= x >> 17; x ^= x << 5; return x; };
+    std::vector<ChurnOp> ops;
+    slot_count = WINDOW * PER_CHUNK;
+    for (std::uint32_t c = 0; c < chunks; ++c) {
+        const std::uint32_t base = (c % WINDOW) * PER_CHUNK;
+        if (c >= WINDOW) for (std::uint32_t i = 0; i < PER_CHUNK; ++i) ops.push_back({base + i, 0});
+        for (std::uint32_t s = 0; s < 16; ++s) {
+            const std::uint32_t entries = 1u + (rnd() % 24u);
+            const std::uint32_t bits = entries <= 2 ? 1u : (std::uint32_t)std::bit_width(entries - 1);
+            ops.push_back({base + s * 3 + 0, entries * 2u});
+            ops.push_back({base + s * 3 + 1, entries * 2u});
+            ops.push_back({base + s * 3 + 2, 4096u * bits / 8u});
+        }
+        ops.push_back({base + 48, 2048u + (rnd() % 40000u)});
+        // Block edits grow a few palettes: free the old arrays and allocate larger ones.
+        for (std::uint32_t e = 0; e < 4; ++e) {
+            const std::uint32_t s = rnd() % 16u;
+            ops.push_back({base + s * 3 + 0, 0});
+            ops.push_back({base + s * 3 + 0, 2u * (8u + (rnd() % 56u))});
+        }
+    }
+    return ops;
+}
+
+template <class Alloc, class Free>
+double replay_ns(const std::vector<std::vector<ChurnOp>>& traces, std::uint32_t slot_count, Alloc&& alloc, Free&& free) {
+    const auto t0 = std::chrono::steady_clock::now();
+    std::vector<std::thread> ts;
+    std::size_t total = 0;
+    for (const auto& trace : traces) {
+        total += trace.size();
+        ts.emplace_back([&, slot_count] {
+            std::vector<void*> slots(slot_count, nullptr);
+            for (const ChurnOp& op : trace) {
+                void*& s = slots[op.slot];
+                if (!op.size) {
+                    free(s);
+                    s = nullptr;
+                    continue;
+                }
+                if (s) free(s);
+                s = alloc(op.size);
+                static_cast<volatile std::byte*>(s)[0] = std::byte{1};
+            }
+            for (void* s : slots) if (s) free(s);
+        });
+    }
+    for (auto& t : ts) t.join();
+    return elapsed_us(t0) * 1000.0 / (double)total;
+}
+
+void chunk_churn() {
+    for (const std::uint32_t threads : {1u, 4u}) {
+        std::uint32_t slots = 0;
+        std::vector<std::vector<ChurnOp>> traces;
+        for (std::uint32_t t = 0; t < threads; ++t) traces.push_back(chunk_churn_trace(0x9e3779b9u + t, 4000, slots));
+        cube::mem::SlabAllocator slab;
+        slab.init();
+        const double sl = replay_ns(traces, slots, [&](std::size_t n) { return slab.alloc(n); }, [&](void* p) { slab.free(p); });
+        const double ml = replay_ns(traces, slots, [](std::size_t n) { return std::malloc(n); }, [](void* p) { std::free(p); });
+        char label[64];
+        std::snprintf(label, sizeof(label), "mem/chunk churn %u threads", threads);
+        std::printf("%-40s slab %7.1f ns/op  malloc %7.1f ns/op  (slab committed %.1f MB)\n", label, sl, ml, (double)slab.committed() / (1024.0 * 1024.0));
+    }
+}
+
+// Block edits scattered over a loaded area, as players and world updates produce them, with the Voxel
+// category on the default heap and on a SlabAllocator. Allocation counts are per simulated frame.
+void voxel_edit_frames() {
+    constexpr int FRAMES = 300;
+    constexpr int EDITS_PER_FRAME = 512;
+    auto run = [&](const char* label, cube::mem::IAllocator& a, auto&& malloc_calls) {
+        cube::mem::ScopedCategoryAllocator scope(cube::mem::MemCategory::Voxel, &a);
+        cube::voxel::ChunkManager chunks(0);
+        std::uint32_t x = 0x12345u;
+        auto rnd = [&] { x ^= x << 13; x ^= x >> 17; x ^= x << 5; return x; };
+        const auto allocs0 = a.stats().alloc_count;
+        const auto malloc0 = malloc_calls();
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int f = 0; f < FRAMES; ++f) {
+            for (int e = 0; e < EDITS_PER_FRAME; ++e) {
+                const std::uint32_t r = rnd();
+                const cube::voxel::ChunkCoord cc{(std::int64_t)(r & 7u), 0, (std::int64_t)((r >> 3) & 7u)};
+                const std::uint32_t p = rnd();
+                chunks.set_block(cc, (int)(p & 31u), (int)((p >> 5) & 31u), (int)((p >> 10) & 31u), (cube::voxel::BlockID)((p >> 15) % 12u));
+            }
+        }
+        const double us = elapsed_us(t0) / FRAMES;
+        std::printf("%-40s %8.1f us/frame  %8.1f allocs/frame  %8.1f malloc calls/frame\n", label, us,
+            (double)(a.stats().alloc_count - allocs0) / FRAMES, (double)(malloc_calls() - malloc0) / FRAMES);
+    };
+    {
+        cube::mem::HeapAllocator heap;
+        run("mem/voxel edits heap", heap, [&] { return heap.stats().alloc_count; });
+    }
+    {
+        cube::mem::SlabAllocator slab(1024ull * 1024ull * 1024ull);
+        run("mem/voxel edits slab", slab, [&] { return slab.large_stats().alloc_count; });
+    }
+}
+
+// Cost the always-on profiler hooks add to a malloc/free pair at the default rate and when disabled.
+void heap_profiler_overhead() {
+    constexpr int N = 2000000;
+    constexpr std::size_t SIZES[] = {24, 64, 200, 1024};
+    auto pairs = [&](bool hooked) {
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < N; ++i) {
+            const std::size_t n = SIZES[i & 3];
+            void* p = std::malloc(n);
+            if (hooked) cube::mem::heap_profile_alloc(p, n);
+            static_cast<volatile std::byte*>(p)[0] = std::byte{1};
+            if (hooked) cube::mem::heap_profile_free(p);
+            std::free(p);
+        }
+        return elapsed_us(t0) * 1000.0 / N;
+    };
+    const std::size_t rate = cube::mem::heap_sample_rate();
+    const double plain = pairs(false);
+    const double sampled = pairs(true);
+    cube::mem::set_heap_sample_rate(0);
+    const double off = pairs(true);
+    cube::mem::set_heap_sample_rate(rate);
+    std::printf("%-40s malloc %6.1f ns  sampled %6.1f ns  disabled %6.1f ns  per pair\n", "mem/heap profiler hooks", plain, sampled, off);
+}
+
+// dTLB load misses of the calling thread, where perf_event_open is permitted.
+class DtlbMissCounter {
+public:
+    DtlbMissCounter() {
+#if defined(__linux__)
+        perf_event_attr pe{};
+        pe.type = PERF_TYPE_HW_CACHE;
+        pe.size = sizeof(pe);
+        pe.config = PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+        pe.disabled = 1;
+        pe.exclude_kernel = 1;
+        pe.exclude_hv = 1;
+        fd_ = (int)syscall(SYS_perf_event_open, &pe, 0, -1, -1, 0);
+#endif
+    }
+    ~DtlbMissCounter() {
+#if defined(__linux__)
+        if (fd_ >= 0) close(fd_);
+#endif
+    }
+    DtlbMissCounter(const DtlbMissCounter&) = delete;
+    DtlbMissCounter& operator=(const DtlbMissCounter&) = delete;
+
+    bool ok() const { return fd_ >= 0; }
+    void start() {
+#if defined(__linux__)
+        if (fd_ < 0) return;
+        ioctl(fd_, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd_, PERF_EVENT_IOC_ENABLE, 0);
+#endif
+    }
+    long long stop() {
+        long long v = -1;
+#if defined(__linux__)
+        if (fd_ < 0) return v;
+        ioctl(fd_, PERF_EVENT_IOC_DISABLE, 0);
+        if (read(fd_, &v, sizeof(v)) != (ssize_t)sizeof(v)) v = -1;
+#endif
+        return v;
+    }
+
+private:
+    int fd_{-1};
+};
+
+// Random block lookups across a loaded area far larger than the 4 KB-page TLB reach, with chunk storage
+// (map nodes, subchunk arrays) on a slab allocator backed by default or huge pages.
+void chunk_lookup_tlb() {
+    constexpr int SIDE = 64;
+    constexpr int LOOKUPS = 4000000;
+    auto run = [&](const char* label, cube::mem::PageSize pages) {
+        cube::mem::SlabAllocator slab(4ull * 1024ull * 1024ull * 1024ull, pages);
+        cube::mem::ScopedCategoryAllocator scope(cube::mem::MemCategory::Voxel, &slab);
+        std::uint32_t x = 0xdecafbadu;
+        auto rnd = [&] { x ^= x << 13; x ^= x >> 17; x ^= x << 5; return x; };
+        {
+            cube::voxel::ChunkManager chunks(0);
+            for (int cz = 0; cz < SIDE; ++cz) for (int cx = 0; cx < SIDE; ++cx) {
+                const cube::voxel::ChunkCoord cc{cx, 0, cz};
+                chunks.create_chunk(cc, 0);
+                // ~20 block types per subchunk: 5-bit packed arrays, about 20 KB per chunk.
+                for (int s = 0; s < 8; ++s) for (int b = 0; b < 24; ++b) {
+                    const std::uint32_t r = rnd();
+                    chunks.set_block(cc, (s & 1) * 16 + (int)(r & 15u), ((s >> 1) & 1) * 16 + (int)((r >> 4) & 15u), (s >> 2) * 16 + (int)((r >> 8) & 15u), (cube::voxel::BlockID)(1 + b % 20));
+                }
+            }
+            const cube::voxel::ChunkManager& cm = chunks;
+            DtlbMissCounter tlb;
+            std::uint64_t sum = 0;
+            tlb.start();
+            const auto t0 = std::chrono::steady_clock::now();
+            for (int i = 0; i < LOOKUPS; ++i) {
+                const std::uint32_t r = rnd();
+                const cube::voxel::ChunkCoord cc{(std::int64_t)(r % SIDE), 0, (std::int64_t)((r >> 6) % SIDE)};
+                const std::uint32_t b = rnd();
+                sum += cm.get_block(cc, (int)(b & 31u), (int)((b >> 5) & 31u), (int)((b >> 10) & 31u));
+            }
+            const double ns = elapsed_us(t0) * 1000.0 / LOOKUPS;
+            const long long misses = tlb.stop();
+            char tlb_text[48];
+            if (misses >= 0) std::snprintf(tlb_text, sizeof(tlb_text), "%6.3f dTLB misses/lookup", (double)misses / LOOKUPS);
+            else std::snprintf(tlb_text, sizeof(tlb_text), "dTLB counter unavailable");
+            std::printf("%-40s %6.1f ns/lookup  %s  committed %6.1f MB, %6.1f MB on huge pages  (%llu)\n", label, ns, tlb_text,
+                (double)slab.committed() / (1024.0 * 1024.0), (double)slab.huge_bytes() / (1024.0 * 1024.0), (unsigned long long)(sum & 1));
+        }
+    };
+    run("mem/chunk lookup 4K pages", cube::mem::PageSize::Default);
+    run("mem/chunk lookup huge pages", cube::mem::PageSize::Huge);
+}
+
+}
+
+void run_memory_benchmarks() {
+    frame_arena_startup();
+    concurrent_pool_throughput();
+    chunk_churn();
+    voxel_edit_frames();
+    heap_profiler_overhead();
+    chunk_lookup_tlb();
+}
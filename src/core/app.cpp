@@ -13,6 +13,7 @@
 #include <cstring>
 #include <cstdint>
 #include <charconv>
+#include <thread>
 #include <imgui.h>
 #if defined(TRACY_ENABLE)
   #include <tracy/TracyVulkan.hpp>
@@ -40,6 +41,7 @@ static std::filesystem::path exe_dir() {
 int App::run() {
     cube::log::Config log_cfg{};
     log_cfg.file_path = (exe_dir() / "cube.log").string();
+    log_cfg.binary_path = (exe_dir() / "cube.clog").string();
     cube::log::init(log_cfg);
     LOG_INFO("Core", "Startup");
     if (!init_window()) { cube::log::shutdown(); return 1; }
@@ -79,13 +81,16 @@ bool App::init_vulkan() {
     if (!frames.create(device.handle(), *device.queues().graphics, 2)) return false;
 
     frame_arenas.resize(frames.frame_count());
+    frame_epochs.assign(frames.frame_count(), 0);
     for (auto& a : frame_arenas) {
-        a.backing.resize(FRAME_ARENA_BYTES);
-        a.alloc.reset(a.backing.data(), a.backing.size());
+        if (!a.alloc.init(FRAME_ARENA_RESERVE_BYTES, cube::mem::VirtualArena::DEFAULT_COMMIT_STEP, FRAME_ARENA_RETAIN_BYTES, cube::mem::PageSize::Huge)) {
+            LOG_ERROR("Memory", "Failed to reserve %zu bytes for a frame arena", FRAME_ARENA_RESERVE_BYTES);
+            return false;
+        }
         cube::mem::register_leak_check(
             "FrameArena",
             &a.alloc,
-            +[](void* ctx) -> std::size_t { return static_cast<cube::mem::LinearAllocator*>(ctx)->used(); }
+            +[](void* ctx) -> std::size_t { return static_cast<cube::mem::VirtualArena*>(ctx)->used(); }
         );
     }
 
@@ -296,13 +301,13 @@ bool App::init_vulkan() {
     }
     gpu_mem.on_alloc(cube::render::GpuBudgetCategory::Index, allocator, indexBufferAllocation, (std::uint64_t)indexBufferSize);
 
-    gpu_uploader.begin_frame();
-    auto alloc_fn = +[](void* ctx, std::size_t sz, std::size_t al) -> void* { return static_cast<App*>(ctx)->frame_alloc(sz, al); };
-    if (!gpu_uploader.enqueue_buffer_upload(this, alloc_fn, vertexBuffer, 0, vertices.data(), bufferSize)) return false;
-    if (!gpu_uploader.enqueue_buffer_upload(this, alloc_fn, indexBuffer, 0, indices.data(), indexBufferSize)) return false;
+    gpu_uploader.begin_frame(++gpu_epoch);
+    if (!gpu_uploader.enqueue_buffer_upload(vertexBuffer, 0, vertices.data(), bufferSize)) return false;
+    if (!gpu_uploader.enqueue_buffer_upload(indexBuffer, 0, indices.data(), indexBufferSize)) return false;
     VkCommandBuffer upload_cb = frames.beginSingleTimeCommands(device.handle(), *device.queues().graphics);
     gpu_uploader.flush(upload_cb);
     frames.endSingleTimeCommands(device.handle(), device.graphics(), upload_cb);
+    gpu_uploader.retire(gpu_epoch);
 
     if (!pipeline.create(device.handle(), render_pass.handle, vert_shader->module, frag_shader->module, swapchain.extent, descriptor_set_layout)) return false;
 
@@ -414,6 +419,143 @@ void App::register_console_commands() {
                 console.add_log_message("Error: Invalid coordinates.");
             }
         });
+
+    console.register_command("jobtrace", "Dump recent job timeline as Chrome trace JSON (/jobtrace [seconds])",
+        [this](const std::vector<std::string>& args) {
+            double seconds = 5.0;
+            if (args.size() > 1) {
+                try {
+                    seconds = std::stod(args[1]);
+                } catch (const std::exception&) {
+                    console.add_log_message("Usage: jobtrace [seconds]");
+                    return;
+                }
+            }
+            const std::string path = (exe_dir() / "jobs_trace.json").string();
+            if (!jobs.trace().write_chrome_json(path, seconds)) {
+                console.add_log_message("Error: failed to write " + path);
+                return;
+            }
+            LOG_INFO("Jobs", "Job trace written to %s", path.c_str());
+            console.add_log_message("Job trace written to " + path + " (open in chrome://tracing or ui.perfetto.dev)");
+        });
+
+    console.register_command("heapdump", "Write live heap samples by call site to a file (/heapdump [path])",
+        [this](const std::vector<std::string>& args) {
+            const std::string path = args.size() > 1 ? args[1] : (exe_dir() / "heap_profile.txt").string();
+            if (!cube::mem::heap_profile_dump(path)) {
+                console.add_log_message("Error: failed to write " + path);
+                return;
+            }
+            LOG_INFO("Memory", "Heap profile written to %s", path.c_str());
+            console.add_log_message("Heap profile written to " + path);
+        });
+
+    console.register_command("heaprate", "Set heap profiler sample rate in bytes, 0 disables (/heaprate [bytes])",
+        [this](const std::vector<std::string>& args) {
+            if (args.size() > 1) {
+                try {
+                    cube::mem::set_heap_sample_rate((std::size_t)std::stoull(args[1]));
+                } catch (const std::exception&) {
+                    console.add_log_message("Usage: heaprate [bytes]");
+                    return;
+                }
+            }
+            console.add_log_message("Heap sample rate: " + std::to_string(cube::mem::heap_sample_rate()) + " bytes");
+        });
+
+    cube::bench::register_builtin_benchmarks(benchmarks);
+    benchmarks.add("gpu/upload", "16 MB in 256 KB blocks through GpuUploader into device-local memory",
+        [this](const cube::bench::Options& opt, cube::bench::Result& out) { return bench_gpu_upload(opt, out); });
+
+    console.register_command("bench", "Run built-in benchmarks, blocking the frame (/bench [list|all|name-prefix] [reps])",
+        [this](const std::vector<std::string>& args) {
+            const std::string filter = args.size() > 1 ? args[1] : "all";
+            if (filter == "list") {
+                for (const auto& b : benchmarks.all()) console.add_log_message("  " + b.name + " - " + b.description);
+                return;
+            }
+            cube::bench::Options opt{};
+            if (args.size() > 2) {
+                try {
+                    opt.reps = (std::uint32_t)std::max(1ul, std::stoul(args[2]));
+                } catch (const std::exception&) {
+                    console.add_log_message("Usage: bench [list|all|name-prefix] [reps]");
+                    return;
+                }
+            }
+            const auto results = benchmarks.run(filter, opt, [this](const cube::bench::Result& r) {
+                console.add_log_message(cube::bench::format(r));
+            });
+            if (results.empty()) {
+                console.add_log_message("No benchmark matches '" + filter + "' (/bench list)");
+                return;
+            }
+
+            VkPhysicalDeviceProperties props{};
+            vkGetPhysicalDeviceProperties(device.physical(), &props);
+            const std::vector<std::pair<std::string, std::string>> info{
+                {"device", props.deviceName},
+                {"hardware_threads", std::to_string(std::thread::hardware_concurrency())},
+                {"job_workers", std::to_string(jobs.worker_count())},
+                {"warmup", std::to_string(opt.warmup)},
+                {"reps", std::to_string(opt.reps)},
+                {"unix_time", std::to_string(std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count())},
+            };
+            const std::string path = (exe_dir() / "bench_results.json").string();
+            if (!cube::bench::write_json(path, results, info)) {
+                console.add_log_message("Error: failed to write " + path);
+                return;
+            }
+            LOG_INFO("Core", "Benchmark results written to %s", path.c_str());
+            console.add_log_message("Benchmark results written to " + path);
+        });
+}
+
+bool App::bench_gpu_upload(const cube::bench::Options& opt, cube::bench::Result& out) {
+    constexpr VkDeviceSize BLOCK = 256ull * 1024ull;
+    constexpr VkDeviceSize TOTAL = 16ull * 1024ull * 1024ull;
+    if (!allocator) return false;
+    vkDeviceWaitIdle(device.handle());
+
+    // A scratch uploader so the frame's pending uploads and epochs are left alone.
+    cube::render::GpuUploader uploader;
+    if (!uploader.init(allocator, 2 * TOTAL, 64ull * 1024ull)) {
+        uploader.shutdown(allocator);
+        return false;
+    }
+
+    VkBufferCreateInfo bi{};
+    bi.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bi.size = TOTAL;
+    bi.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    bi.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    VmaAllocationCreateInfo ai{};
+    ai.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    VkBuffer dst = VK_NULL_HANDLE;
+    VmaAllocation dst_alloc = VK_NULL_HANDLE;
+    gpu_mem.update(allocator);
+    if (!gpu_mem.can_allocate_vram((std::uint64_t)TOTAL) || vmaCreateBuffer(allocator, &bi, &ai, &dst, &dst_alloc, nullptr) != VK_SUCCESS) {
+        uploader.shutdown(allocator);
+        return false;
+    }
+
+    std::vector<std::byte> src((std::size_t)BLOCK);
+    for (std::size_t i = 0; i < src.size(); ++i) src[i] = (std::byte)(i * 31u);
+    std::uint64_t epoch = 0;
+    bool ok = true;
+    out = cube::bench::run("gpu/upload", opt.warmup, opt.reps, (std::uint64_t)TOTAL, [&] {
+        uploader.begin_frame(++epoch);
+        for (VkDeviceSize at = 0; at < TOTAL; at += BLOCK) ok &= uploader.enqueue_buffer_upload(dst, at, src.data(), BLOCK);
+        VkCommandBuffer cb = frames.beginSingleTimeCommands(device.handle(), *device.queues().graphics);
+        uploader.flush(cb);
+        frames.endSingleTimeCommands(device.handle(), device.graphics(), cb);
+        uploader.retire(epoch);
+    });
+
+    vmaDestroyBuffer(allocator, dst, dst_alloc);
+    uploader.shutdown(allocator);
+    return ok;
 }
 
 bool App::create_swapchain() {
@@ -446,6 +588,7 @@ void App::main_loop() {
     while (!glfwWindowShouldClose(window)) {
         CUBE_PROFILE_FRAME();
         CUBE_PROFILE_SCOPE_N("frame");
+        jobs.begin_frame();
         double current_time = glfwGetTime();
         float delta_time = static_cast<float>(current_time - last_time);
         last_time = current_time;
@@ -487,6 +630,7 @@ void App::main_loop() {
         }
 
         // Update debug stats every 0.3 seconds
+        debug_stats_frames++;
         if (current_time - last_debug_stats_update >= DEBUG_STATS_UPDATE_INTERVAL) {
             update_debug_stats();
             last_debug_stats_update = current_time;
@@ -552,7 +696,14 @@ void App::main_loop() {
             a.overflowed = false;
             a.alloc.reset();
         }
-        gpu_uploader.begin_frame();
+        {
+            // The fence covers everything this slot submitted last time, so its epoch can be reclaimed.
+            std::uint64_t& slot_epoch = frame_epochs[frames.current_frame_index()];
+            gpu_uploader.retire(slot_epoch);
+            gpu_uploader.begin_frame(++gpu_epoch);
+            slot_epoch = gpu_epoch;
+        }
+        jobs.run_main_thread_jobs(MAIN_THREAD_JOB_BUDGET_NS);
 
         uint32_t imageIndex = 0;
         VkResult acq = VK_SUCCESS;
@@ -565,6 +716,7 @@ void App::main_loop() {
 
         {
             CUBE_PROFILE_SCOPE_N("record");
+            cube::mem::MemTagScope mem_tag(cube::mem::MemCategory::Render);
             vkResetCommandBuffer(frame.cmd, 0);
             record_command(frame.cmd, imageIndex);
         }
@@ -629,6 +781,7 @@ void App::key_callback(GLFWwindow* window, int key, int scancode, int action, in
                 case GLFW_KEY_F3: app->show_debug_overlay = !app->show_debug_overlay; break;
                 case GLFW_KEY_F4: app->show_log_viewer = !app->show_log_viewer; break;
                 case GLFW_KEY_F5: app->show_voxel_debug = !app->show_voxel_debug; break;
+                case GLFW_KEY_F6: app->show_heap_profile = !app->show_heap_profile; break;
                 case GLFW_KEY_T:
                     app->show_console = true;
                     app->console.set_focus();
@@ -812,7 +965,34 @@ void App::update_debug_stats() {
         vram_total = (size_t)gpu_mem.vram_budget();
     }
 
+    for (std::size_t i = 0; i < cube::mem::MEM_CATEGORY_COUNT; ++i) {
+        const auto st = cube::mem::category_allocator((cube::mem::MemCategory)i).stats();
+        mem_category_bytes[i] = st.bytes_in_use;
+        mem_category_allocs_per_frame[i] = debug_stats_frames ? (float)(st.alloc_count - mem_category_allocs_prev[i]) / (float)debug_stats_frames : 0.0f;
+        mem_category_allocs_prev[i] = st.alloc_count;
+    }
+    debug_stats_frames = 0;
+    frame_arena_huge_bytes = 0;
+    for (const auto& a : frame_arenas) frame_arena_huge_bytes += a.alloc.huge_bytes();
+    voxel_heap_committed = voxel_heap.committed();
+    voxel_heap_huge_bytes = voxel_heap.huge_bytes();
+
     job_stats = jobs.snapshot_stats();
+
+    // Job type rows cover the window since the previous update; the histograms themselves are never reset.
+    jobs.snapshot_job_types(job_types_now);
+    job_type_rows.clear();
+    for (const auto& t : job_types_now) {
+        auto prev = std::find_if(job_types_prev.begin(), job_types_prev.end(), [&](const auto& p) { return std::strcmp(p.name, t.name) == 0; });
+        const auto wait = prev != job_types_prev.end() ? t.wait.since(prev->wait) : t.wait;
+        const auto run = prev != job_types_prev.end() ? t.run.since(prev->run) : t.run;
+        if (run.count == 0) continue;
+        auto us = [](const cube::jobs::LatencyHistogram::Snapshot& h) {
+            return std::array<float, 4>{(float)h.percentile(0.50) / 1000.0f, (float)h.percentile(0.95) / 1000.0f, (float)h.percentile(0.99) / 1000.0f, (float)h.max_ns / 1000.0f};
+        };
+        job_type_rows.push_back(JobTypeRow{t.name, run.count, us(wait), us(run)});
+    }
+    std::swap(job_types_prev, job_types_now);
 }
 
 void App::update_camera(float delta_time) {
@@ -956,7 +1136,7 @@ void* App::frame_alloc(std::size_t size, std::size_t align) {
     void* p = a.alloc.alloc(size, align);
     if (!p && !a.overflowed) {
         a.overflowed = true;
-        LOG_WARN("Memory", "Frame allocator overflow (requested %zu bytes)", size);
+        LOG_WARN_LIMITED("Memory", "Frame allocator overflow (requested %zu bytes)", size);
     }
     return p;
 }
@@ -1052,9 +1232,13 @@ bool App::record_command(VkCommandBuffer cmd, uint32_t imageIndex) {
         if (!frame_arenas.empty()) {
             const auto& a = frame_arenas[frames.current_frame_index()].alloc;
             arena_used = a.used();
-            arena_cap = a.capacity();
+            arena_cap = a.committed();
             arena_peak = a.stats().peak_bytes_in_use;
         }
+        std::array<std::uint64_t, DebugData::MAX_STAGING_FRAMES> staging_frame_bytes{};
+        const auto& staging = gpu_uploader.staging_ring();
+        const std::uint32_t staging_frames = (std::min)(staging.epoch_count(), DebugData::MAX_STAGING_FRAMES);
+        for (std::uint32_t i = 0; i < staging_frames; ++i) staging_frame_bytes[i] = staging.epoch_usage(i).bytes;
 
         DebugData debug_data{
             fps,
@@ -1071,8 +1255,15 @@ bool App::record_command(VkCommandBuffer cmd, uint32_t imageIndex) {
             arena_used,
             arena_cap,
             arena_peak,
+            frame_arena_huge_bytes,
+            voxel_heap_committed,
+            voxel_heap_huge_bytes,
+            mem_category_bytes,
+            mem_category_allocs_per_frame,
             (std::uint64_t)gpu_uploader.staging_used(),
             (std::uint64_t)gpu_uploader.staging_capacity(),
+            staging_frame_bytes,
+            staging_frames,
             cpu_usage,
             gpu_usage,
             job_stats.worker_count,
@@ -1080,10 +1271,23 @@ bool App::record_command(VkCommandBuffer cmd, uint32_t imageIndex) {
             job_stats.pending_normal,
             job_stats.pending_low,
             job_stats.stall_warnings,
+            job_stats.overflow_pending,
+            job_stats.overflow_peak,
+            job_stats.overflow_events,
+            job_stats.main_pending,
+            job_stats.main_ran,
+            job_stats.main_latency_avg_us,
+            job_stats.main_latency_max_us,
+            job_stats.missed_deadlines,
+            job_stats.max_queue_age_us,
             job_stats.worker_utilization,
+            job_stats.scratch_bytes,
+            job_stats.scratch_peak_bytes,
+            &job_type_rows,
             show_debug_overlay,
             show_log_viewer,
             show_voxel_debug,
+            show_heap_profile,
             &block_registry,
             &chunk_manager
         };
@@ -25,10 +25,14 @@
 #include "render/gpu_memory.hpp"
 #include "render/gpu_uploader.hpp"
 #include "console.hpp"
+#include "core/bench.hpp"
 #include "core/profile.hpp"
 #include "core/job_system.hpp"
 #include "math/math.hpp"
-#include "memory/linear_allocator.hpp"
+#include "memory/heap_profiler.hpp"
+#include "memory/memory_category.hpp"
+#include "memory/slab_allocator.hpp"
+#include "memory/virtual_arena.hpp"
 #include "voxel/blocks.hpp"
 #include "voxel/chunk_manager.hpp"
 
@@ -44,6 +48,8 @@ private:
     void main_loop();
     void cleanup();
     void register_console_commands();
+    // Staging upload of 16 MB through a scratch GpuUploader into a device-local buffer, GPU copy included.
+    bool bench_gpu_upload(const cube::bench::Options& opt, cube::bench::Result& out);
 
     bool record_command(VkCommandBuffer cmd, uint32_t imageIndex);
 
@@ -118,6 +124,13 @@ private:
     bool show_debug_overlay{false};
     bool show_log_viewer{false};
     bool show_voxel_debug{false};
+    bool show_heap_profile{false};
+
+    // Chunk storage churns through small palette and packed arrays; route the Voxel category to a slab
+    // allocator. Declared before chunk_manager so the switch outlives every voxel container.
+    static constexpr std::size_t VOXEL_HEAP_RESERVE_BYTES = 4ull * 1024ull * 1024ull * 1024ull;
+    cube::mem::SlabAllocator voxel_heap{VOXEL_HEAP_RESERVE_BYTES, cube::mem::PageSize::Huge};
+    cube::mem::ScopedCategoryAllocator voxel_category{cube::mem::MemCategory::Voxel, &voxel_heap};
 
     cube::voxel::BlockRegistry block_registry;
     cube::voxel::DefaultBlocks default_blocks;
@@ -125,6 +138,7 @@ private:
 
     // Console
     Console console;
+    cube::bench::Registry benchmarks;
     bool show_console{false};
     bool prev_show_console{false}; // Track previous console state for mouse capture
 
@@ -138,6 +152,16 @@ private:
     float cpu_usage{0.0f};
     float gpu_usage{0.0f};
 
+    // Per-category heap traffic averaged over the frames since the previous debug stats update
+    std::array<std::size_t, cube::mem::MEM_CATEGORY_COUNT> mem_category_bytes{};
+    std::array<float, cube::mem::MEM_CATEGORY_COUNT> mem_category_allocs_per_frame{};
+    std::array<std::uint64_t, cube::mem::MEM_CATEGORY_COUNT> mem_category_allocs_prev{};
+    // Huge page coverage is an OS query, so it is refreshed with the debug stats rather than per frame.
+    std::size_t frame_arena_huge_bytes{0};
+    std::size_t voxel_heap_committed{0};
+    std::size_t voxel_heap_huge_bytes{0};
+    std::uint32_t debug_stats_frames{0};
+
     // Debug stats update timer
     double last_debug_stats_update{0.0};
     static constexpr double DEBUG_STATS_UPDATE_INTERVAL = 0.3; // seconds
@@ -165,14 +189,23 @@ private:
 
     cube::jobs::JobSystem jobs;
     cube::jobs::JobSystem::Stats job_stats{};
+    std::vector<cube::jobs::JobSystem::JobTypeStats> job_types_prev;
+    std::vector<cube::jobs::JobSystem::JobTypeStats> job_types_now;
+    std::vector<JobTypeRow> job_type_rows;
+    static constexpr std::uint64_t MAIN_THREAD_JOB_BUDGET_NS = 2000000ull;
 
     struct FrameArena {
-        std::vector<std::byte> backing;
-        cube::mem::LinearAllocator alloc;
+        cube::mem::VirtualArena alloc;
         bool overflowed{false};
     };
     std::vector<FrameArena> frame_arenas;
-    static constexpr std::size_t FRAME_ARENA_BYTES = 64ull * 1024ull * 1024ull;
+    // Upload epoch last submitted from each frame slot; retired once that slot's fence is waited on.
+    std::uint64_t gpu_epoch{};
+    std::vector<std::uint64_t> frame_epochs;
+    // Address space only; pages are committed as the frame uses them and anything past the retain
+    // mark is handed back to the OS when the arena is reset.
+    static constexpr std::size_t FRAME_ARENA_RESERVE_BYTES = 1024ull * 1024ull * 1024ull;
+    static constexpr std::size_t FRAME_ARENA_RETAIN_BYTES = 64ull * 1024ull * 1024ull;
 
 };
 
@@ -0,0 +1,234 @@
+#include "bench.hpp"
+
+#include "core/mpmc_queue.hpp"
+#include "memory/slab_allocator.hpp"
+#include "voxel/chunk_manager.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+namespace cube::bench {
+
+namespace {
+
+struct XorShift {
+    std::uint32_t x;
+    std::uint32_t operator()() {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return x;
+    }
+};
+
+void json_string(std::FILE* f, std::string_view s) {
+    std::fputc('"', f);
+    for (const char c : s) {
+        if (c == '"' || c == '\\') std::fputc('\\', f);
+        if ((unsigned char)c < 0x20) {
+            std::fprintf(f, "\\u%04x", (unsigned)c);
+            continue;
+        }
+        std::fputc(c, f);
+    }
+    std::fputc('"', f);
+}
+
+// Fills a fresh chunk with an 8-type pattern, so palettes settle at 3 bits after the first writes.
+bool chunk_set(const Options& opt, Result& out) {
+    out = run("voxel/chunk_set", opt.warmup, opt.reps, voxel::CHUNK_VOLUME, [] {
+        voxel::Chunk c({0, 0, 0});
+        for (int z = 0; z < voxel::CHUNK_SIZE; ++z) for (int y = 0; y < voxel::CHUNK_SIZE; ++y) for (int x = 0; x < voxel::CHUNK_SIZE; ++x) {
+            c.set_block(x, y, z, (voxel::BlockID)(1 + ((x ^ (y * 3) ^ (z * 5)) & 7)));
+        }
+    });
+    return true;
+}
+
+bool chunk_get(const Options& opt, Result& out) {
+    voxel::Chunk c({0, 0, 0});
+    for (int z = 0; z < voxel::CHUNK_SIZE; ++z) for (int y = 0; y < voxel::CHUNK_SIZE; ++y) for (int x = 0; x < voxel::CHUNK_SIZE; ++x) {
+        c.set_block(x, y, z, (voxel::BlockID)(1 + ((x ^ (y * 3) ^ (z * 5)) & 7)));
+    }
+    volatile std::uint32_t sink = 0;
+    out = run("voxel/chunk_get", opt.warmup, opt.reps, voxel::CHUNK_VOLUME, [&] {
+        std::uint32_t sum = 0;
+        for (int z = 0; z < voxel::CHUNK_SIZE; ++z) for (int y = 0; y < voxel::CHUNK_SIZE; ++y) for (int x = 0; x < voxel::CHUNK_SIZE; ++x) {
+            sum += c.get_block(x, y, z);
+        }
+        sink = sink + sum;
+    });
+    return true;
+}
+
+// Every block gets a new type until each subchunk holds 64, so the packed arrays are rebuilt at each
+// bit width from 1 to 6.
+bool palette_repack(const Options& opt, Result& out) {
+    out = run("voxel/palette_repack", opt.warmup, opt.reps, voxel::CHUNK_VOLUME, [] {
+        voxel::Chunk c({0, 0, 0});
+        int i = 0;
+        for (int z = 0; z < voxel::CHUNK_SIZE; ++z) for (int y = 0; y < voxel::CHUNK_SIZE; ++y) for (int x = 0; x < voxel::CHUNK_SIZE; ++x) {
+            c.set_block(x, y, z, (voxel::BlockID)(1 + (i++ % 64)));
+        }
+    });
+    return true;
+}
+
+// Random block reads across a 16x16 area of loaded chunks through the coordinate map.
+bool chunk_manager_lookup(const Options& opt, Result& out) {
+    constexpr int SIDE = 16;
+    constexpr std::uint32_t LOOKUPS = 1u << 20;
+    voxel::ChunkManager chunks(0);
+    XorShift rnd{0xdecafbadu};
+    for (int cz = 0; cz < SIDE; ++cz) for (int cx = 0; cx < SIDE; ++cx) {
+        const voxel::ChunkCoord cc{cx, 0, cz};
+        chunks.create_chunk(cc, 0);
+        for (int b = 0; b < 64; ++b) {
+            const std::uint32_t r = rnd();
+            chunks.set_block(cc, (int)(r & 31u), (int)((r >> 5) & 31u), (int)((r >> 10) & 31u), (voxel::BlockID)(1 + b % 12));
+        }
+    }
+    const voxel::ChunkManager& cm = chunks;
+    volatile std::uint32_t sink = 0;
+    out = run("voxel/chunk_lookup", opt.warmup, opt.reps, LOOKUPS, [&] {
+        XorShift r{0x12345u};
+        std::uint32_t sum = 0;
+        for (std::uint32_t i = 0; i < LOOKUPS; ++i) {
+            const std::uint32_t a = r();
+            const std::uint32_t b = r();
+            const voxel::ChunkCoord cc{(std::int64_t)(a % SIDE), 0, (std::int64_t)((a >> 8) % SIDE)};
+            sum += cm.get_block(cc, (int)(b & 31u), (int)((b >> 5) & 31u), (int)((b >> 10) & 31u));
+        }
+        sink = sink + sum;
+    });
+    return true;
+}
+
+// Half the hardware threads produce, half consume, through one 4096-cell queue.
+bool mpmc_throughput(const Options& opt, Result& out) {
+    constexpr std::uint64_t PER_PRODUCER = 1u << 18;
+    const std::uint32_t side = std::max(1u, std::thread::hardware_concurrency() / 2);
+    jobs::MpmcQueue<std::uint64_t> q;
+    if (!q.init(4096)) return false;
+    out = run("jobs/mpmc", std::min(opt.warmup, 1u), opt.reps, PER_PRODUCER * side, [&] {
+        std::atomic<std::uint64_t> consumed{0};
+        const std::uint64_t total = PER_PRODUCER * side;
+        std::vector<std::thread> ts;
+        for (std::uint32_t t = 0; t < side; ++t) {
+            ts.emplace_back([&] {
+                for (std::uint64_t i = 0; i < PER_PRODUCER; ++i) {
+                    while (!q.enqueue(i)) std::this_thread::yield();
+                }
+            });
+            ts.emplace_back([&] {
+                std::uint64_t v = 0;
+                while (consumed.load(std::memory_order_relaxed) < total) {
+                    if (q.dequeue(v)) consumed.fetch_add(1, std::memory_order_relaxed);
+                    else std::this_thread::yield();
+                }
+            });
+        }
+        for (auto& t : ts) t.join();
+    });
+    return true;
+}
+
+// Random-size reallocation over 4096 live slots, sizes in the range palette and packed arrays use.
+template <class Alloc, class Free>
+void churn(Alloc&& alloc, Free&& free, std::uint32_t ops) {
+    constexpr std::uint32_t SLOTS = 4096;
+    std::vector<void*> slots(SLOTS, nullptr);
+    XorShift rnd{0x9e3779b9u};
+    for (std::uint32_t i = 0; i < ops; ++i) {
+        const std::uint32_t r = rnd();
+        void*& s = slots[r % SLOTS];
+        if (s) free(s);
+        s = alloc(16u + ((r >> 12) % 2048u));
+        static_cast<volatile std::byte*>(s)[0] = std::byte{1};
+    }
+    for (void* s : slots) if (s) free(s);
+}
+
+bool slab_churn(const Options& opt, Result& out) {
+    constexpr std::uint32_t OPS = 1u << 18;
+    mem::SlabAllocator slab;
+    if (!slab.init()) return false;
+    out = run("mem/slab_churn", opt.warmup, opt.reps, OPS, [&] {
+        churn([&](std::size_t n) { return slab.alloc(n); }, [&](void* p) { slab.free(p); }, OPS);
+    });
+    return true;
+}
+
+bool malloc_churn(const Options& opt, Result& out) {
+    constexpr std::uint32_t OPS = 1u << 18;
+    out = run("mem/malloc_churn", opt.warmup, opt.reps, OPS, [] {
+        churn([](std::size_t n) { return std::malloc(n); }, [](void* p) { std::free(p); }, OPS);
+    });
+    return true;
+}
+
+}
+
+std::string format(const Result& r) {
+    char buf[256];
+    std::snprintf(buf, sizeof(buf), "%-40s median %10.1f us  p95 %10.1f us  %8.1f ns/item  %12.0f items/s",
+        r.name.c_str(), r.median_ns / 1000.0, r.p95_ns / 1000.0, r.ns_per_item, r.items_per_sec);
+    return buf;
+}
+
+void print(const Result& r) {
+    std::printf("%s\n", format(r).c_str());
+}
+
+void Registry::add(std::string name, std::string description, std::function<bool(const Options&, Result&)> fn) {
+    benchmarks_.push_back(Benchmark{std::move(name), std::move(description), std::move(fn)});
+}
+
+std::vector<Result> Registry::run(std::string_view filter, const Options& opt, const std::function<void(const Result&)>& on_result) const {
+    const bool everything = filter.empty() || filter == "all";
+    std::vector<Result> out;
+    for (const Benchmark& b : benchmarks_) {
+        if (!everything && b.name.compare(0, filter.size(), filter) != 0) continue;
+        Result r{};
+        if (!b.fn(opt, r)) continue;
+        if (on_result) on_result(r);
+        out.push_back(std::move(r));
+    }
+    return out;
+}
+
+void register_builtin_benchmarks(Registry& r) {
+    r.add("voxel/chunk_set", "Fill a fresh chunk with 8 block types", chunk_set);
+    r.add("voxel/chunk_get", "Read every block of a filled chunk", chunk_get);
+    r.add("voxel/palette_repack", "Grow each subchunk palette to 64 types, repacking at every bit width", palette_repack);
+    r.add("voxel/chunk_lookup", "Random block reads through ChunkManager over 16x16 chunks", chunk_manager_lookup);
+    r.add("jobs/mpmc", "MPMC queue throughput, half the hardware threads on each side", mpmc_throughput);
+    r.add("mem/slab_churn", "Random-size churn over 4096 slots on a SlabAllocator", slab_churn);
+    r.add("mem/malloc_churn", "The same churn on malloc/free", malloc_churn);
+}
+
+bool write_json(const std::string& path, const std::vector<Result>& results, const std::vector<std::pair<std::string, std::string>>& info) {
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    std::fputs("{\n  \"info\": {", f);
+    for (std::size_t i = 0; i < info.size(); ++i) {
+        std::fputs(i ? ",\n    " : "\n    ", f);
+        json_string(f, info[i].first);
+        std::fputs(": ", f);
+        json_string(f, info[i].second);
+    }
+    std::fputs(info.empty() ? "},\n  \"results\": [" : "\n  },\n  \"results\": [", f);
+    for (std::size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::fputs(i ? ",\n    {\"name\": " : "\n    {\"name\": ", f);
+        json_string(f, r.name);
+        std::fprintf(f, ", \"items\": %llu, \"median_ns\": %.1f, \"p95_ns\": %.1f, \"ns_per_item\": %.3f, \"items_per_sec\": %.1f}",
+            (unsigned long long)r.items, r.median_ns, r.p95_ns, r.ns_per_item, r.items_per_sec);
+    }
+    std::fputs(results.empty() ? "]\n}\n" : "\n  ]\n}\n", f);
+    return std::fclose(f) == 0;
+}
+
+}
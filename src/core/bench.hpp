@@ -0,0 +1,84 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace cube::bench {
+
+struct Result {
+    std::string name;
+    std::uint64_t items{};
+    double median_ns{};
+    double p95_ns{};
+    double ns_per_item{};
+    double items_per_sec{};
+};
+
+template <class Fn>
+Result run(std::string name, std::uint32_t warmup, std::uint32_t reps, std::uint64_t items, Fn&& fn) {
+    using clock = std::chrono::steady_clock;
+    for (std::uint32_t i = 0; i < warmup; ++i) fn();
+    std::vector<double> ns;
+    ns.reserve(reps);
+    for (std::uint32_t i = 0; i < reps; ++i) {
+        const auto t0 = clock::now();
+        fn();
+        const auto t1 = clock::now();
+        ns.push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+    }
+    std::sort(ns.begin(), ns.end());
+    Result r{};
+    r.name = std::move(name);
+    r.items = items;
+    if (!ns.empty()) {
+        r.median_ns = ns[ns.size() / 2];
+        r.p95_ns = ns[std::min(ns.size() - 1, (ns.size() * 95) / 100)];
+    }
+    r.ns_per_item = items ? r.median_ns / (double)items : r.median_ns;
+    r.items_per_sec = r.median_ns > 0.0 ? (double)items * 1e9 / r.median_ns : 0.0;
+    return r;
+}
+
+// One line: name, median, p95, ns/item, items/s.
+std::string format(const Result& r);
+void print(const Result& r);
+
+struct Options {
+    std::uint32_t warmup{3};
+    std::uint32_t reps{20};
+};
+
+// A named benchmark; fn returns false if it could not run (missing device, allocation failure).
+struct Benchmark {
+    std::string name;
+    std::string description;
+    std::function<bool(const Options&, Result&)> fn;
+};
+
+class Registry {
+public:
+    void add(std::string name, std::string description, std::function<bool(const Options&, Result&)> fn);
+    const std::vector<Benchmark>& all() const { return benchmarks_; }
+
+    // Runs every benchmark whose name equals filter or starts with it ("all" or empty runs everything),
+    // in registration order. on_result sees each result as it completes; failed runs are skipped.
+    std::vector<Result> run(std::string_view filter, const Options& opt, const std::function<void(const Result&)>& on_result = {}) const;
+
+private:
+    std::vector<Benchmark> benchmarks_;
+};
+
+// CPU-side engine benchmarks: chunk set/get, palette repack, ChunkManager lookups, MPMC queue
+// throughput and allocator churn. Sizes are fixed so numbers compare across machines.
+void register_builtin_benchmarks(Registry& r);
+
+// {"info": {key: value...}, "results": [{name, items, median_ns, p95_ns, ns_per_item, items_per_sec}...]}
+bool write_json(const std::string& path, const std::vector<Result>& results, const std::vector<std::pair<std::string, std::string>>& info);
+
+}
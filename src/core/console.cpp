@@ -1,4 +1,5 @@
 #include "console.hpp"
+#include "log.hpp"
 #include <imgui.h>
 #include <algorithm>
 #include <cstring>
@@ -10,7 +11,8 @@ Console::Console()
     , should_focus_(false)
 {
     input_buffer_[0] = '\0';
-    output_buffer_.push_back('\0');
+    // Start at the end of the history, so the console shows only what is logged after it opens.
+    log_cursor_ = cube::log::read_since(0, {});
 }
 
 void Console::register_command(const std::string& name, const std::string& description, CommandCallback callback) {
@@ -83,13 +85,22 @@ void Console::execute_command(const std::string& input) {
 
 void Console::add_log_message(const std::string& message, bool is_chat) {
     messages_.push_back({message, std::chrono::steady_clock::now(), is_chat});
-    trim_messages();
     scroll_to_bottom_ = true;
-    output_dirty_ = true;
+    output_text_.append(message);
+    trim_messages();
+}
+
+void Console::pull_log_lines() {
+    std::vector<std::string> lines;
+    log_cursor_ = cube::log::read_since(log_cursor_, [&](const cube::log::LineView& l) {
+        if (l.level != cube::log::Level::Info) lines.emplace_back(l.text);
+    });
+    for (const auto& line : lines) add_log_message(line);
 }
 
 void Console::render(bool* show_console) {
     if (!*show_console) return;
+    pull_log_lines();
 
     // Get display size
     ImVec2 display_size = ImGui::GetIO().DisplaySize;
@@ -154,24 +165,12 @@ void Console::render(bool* show_console) {
             ImGui::BeginChild("Output", ImVec2(0, output_h), false,
                               ImGuiWindowFlags_NoScrollbar | ImGuiWindowFlags_NoScrollWithMouse | ImGuiWindowFlags_NoBackground);
             ImGui::SetWindowFontScale(scale);
-            if (output_dirty_) {
-                size_t n = 1;
-                for (const auto& msg : messages_) n += msg.text.size() + 1;
-                output_buffer_.assign(n, '\0');
-                size_t at = 0;
-                for (const auto& msg : messages_) {
-                    std::memcpy(output_buffer_.data() + at, msg.text.data(), msg.text.size());
-                    at += msg.text.size();
-                    output_buffer_[at++] = '\n';
-                }
-                output_buffer_[at] = '\0';
-                output_dirty_ = false;
-            }
+            output_text_.refresh(messages_);
 
             ImGui::PushStyleColor(ImGuiCol_FrameBg, ImVec4(0.0f, 0.0f, 0.0f, 0.0f));
             ImGui::PushStyleVar(ImGuiStyleVar_FrameBorderSize, 0.0f);
             ImGui::PushStyleVar(ImGuiStyleVar_FrameRounding, 0.0f);
-            ImGui::InputTextMultiline("##output_text", output_buffer_.data(), output_buffer_.size(),
+            ImGui::InputTextMultiline("##output_text", output_text_.data(), output_text_.size(),
                                       ImVec2(-1.0f, -1.0f),
                                       ImGuiInputTextFlags_ReadOnly);
             ImGui::PopStyleVar(2);
@@ -358,10 +357,11 @@ void Console::navigate_history(int direction) {
 }
 
 void Console::trim_messages() {
-    if (messages_.size() > MAX_MESSAGES) {
+    // Trimming rebuilds the output text, so let the list run over by a quarter first.
+    if (messages_.size() > MAX_MESSAGES + MAX_MESSAGES / 4) {
         messages_.erase(messages_.begin(),
                        messages_.begin() + (messages_.size() - MAX_MESSAGES));
-        output_dirty_ = true;
+        output_text_.invalidate();
     }
 }
 
@@ -1,5 +1,8 @@
 #pragma once
 
+#include "console_text.hpp"
+
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <functional>
@@ -41,6 +44,8 @@ public:
 private:
     static int input_callback(ImGuiInputTextCallbackData* data);
     void navigate_history(int direction);
+    // Appends warnings and errors logged since the last call.
+    void pull_log_lines();
     void trim_messages();
 
 private:
@@ -52,8 +57,8 @@ private:
     int history_index_;
     bool scroll_to_bottom_;
     bool should_focus_;
-    std::vector<char> output_buffer_;
-    bool output_dirty_{true};
+    ConsoleText output_text_;
+    std::uint64_t log_cursor_{0};
 
     static constexpr size_t MAX_MESSAGES = 1000;
     static constexpr size_t MAX_COMMAND_HISTORY = 100;
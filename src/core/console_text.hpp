@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+// The console output as one NUL-terminated buffer for a read-only ImGui text box. New lines are
+// appended in place; trimming marks it dirty and the next refresh() rebuilds it from the messages.
+class ConsoleText {
+public:
+    ConsoleText() { buf_.push_back('\0'); }
+
+    void append(std::string_view line) {
+        if (dirty_) return;
+        buf_.pop_back();
+        buf_.insert(buf_.end(), line.begin(), line.end());
+        buf_.push_back('\n');
+        buf_.push_back('\0');
+    }
+
+    void invalidate() { dirty_ = true; }
+    bool dirty() const { return dirty_; }
+
+    // Rebuilds from any range of elements with a .text string when dirty.
+    template <class Messages>
+    void refresh(const Messages& messages) {
+        if (!dirty_) return;
+        std::size_t n = 1;
+        for (const auto& msg : messages) n += msg.text.size() + 1;
+        buf_.assign(n, '\0');
+        std::size_t at = 0;
+        for (const auto& msg : messages) {
+            std::memcpy(buf_.data() + at, msg.text.data(), msg.text.size());
+            at += msg.text.size();
+            buf_[at++] = '\n';
+        }
+        buf_[at] = '\0';
+        dirty_ = false;
+    }
+
+    char* data() { return buf_.data(); }
+    const char* c_str() const { return buf_.data(); }
+    std::size_t size() const { return buf_.size(); }
+
+private:
+    std::vector<char> buf_;
+    bool dirty_{true};
+};
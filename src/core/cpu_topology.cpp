@@ -0,0 +1,177 @@
+#include "cpu_topology.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <utility>
+
+#if defined(__linux__)
+  #include <pthread.h>
+  #include <sched.h>
+#elif defined(_WIN32)
+  #include <windows.h>
+#endif
+
+namespace cube::jobs {
+
+namespace {
+
+bool read_line(const std::string& path, std::string& out) {
+    std::ifstream f(path);
+    if (!f) return false;
+    std::getline(f, out);
+    return true;
+}
+
+bool read_u32(const std::string& path, std::uint32_t& out) {
+    std::string s;
+    if (!read_line(path, s)) return false;
+    return std::sscanf(s.c_str(), "%u", &out) == 1;
+}
+
+// "0-3,8,10-11" -> {0,1,2,3,8,10,11}
+std::vector<std::uint32_t> parse_cpu_list(const std::string& s) {
+    std::vector<std::uint32_t> out;
+    std::size_t i = 0;
+    while (i < s.size()) {
+        std::size_t end = s.find(',', i);
+        if (end == std::string::npos) end = s.size();
+        const std::string part = s.substr(i, end - i);
+        unsigned a = 0, b = 0;
+        if (std::sscanf(part.c_str(), "%u-%u", &a, &b) == 2) {
+            for (unsigned c = a; c <= b; ++c) out.push_back(c);
+        } else if (std::sscanf(part.c_str(), "%u", &a) == 1) {
+            out.push_back(a);
+        }
+        i = end + 1;
+    }
+    return out;
+}
+
+}
+
+CpuTopology detect_cpu_topology(const std::string& root) {
+    CpuTopology topo{};
+#if defined(__linux__)
+    std::string online;
+    if (!read_line(root + "/online", online)) return topo;
+    const std::vector<std::uint32_t> cpus = parse_cpu_list(online);
+
+    std::map<std::pair<std::uint32_t, std::uint32_t>, std::uint32_t> core_ids;
+    std::map<std::uint32_t, std::uint32_t> l3_ids;
+    for (const std::uint32_t cpu : cpus) {
+        const std::string dir = root + "/cpu" + std::to_string(cpu);
+        CpuInfo info{};
+        info.cpu = cpu;
+        std::uint32_t core_id = cpu;
+        read_u32(dir + "/topology/physical_package_id", info.package);
+        read_u32(dir + "/topology/core_id", core_id);
+
+        std::string siblings;
+        if (!read_line(dir + "/topology/thread_siblings_list", siblings) && !read_line(dir + "/topology/core_cpus_list", siblings)) siblings = std::to_string(cpu);
+        const std::vector<std::uint32_t> sib = parse_cpu_list(siblings);
+        info.smt_index = (std::uint32_t)(std::find(sib.begin(), sib.end(), cpu) - sib.begin());
+        if (info.smt_index >= sib.size()) info.smt_index = 0;
+
+        std::string l3;
+        std::uint32_t l3_key = info.package;
+        if (read_line(dir + "/cache/index3/shared_cpu_list", l3)) {
+            const std::vector<std::uint32_t> shared = parse_cpu_list(l3);
+            if (!shared.empty()) l3_key = 0x80000000u | *std::min_element(shared.begin(), shared.end());
+        }
+
+        const auto key = std::make_pair(info.package, core_id);
+        auto it = core_ids.find(key);
+        if (it == core_ids.end()) it = core_ids.emplace(key, (std::uint32_t)core_ids.size()).first;
+        info.core = it->second;
+        auto lt = l3_ids.find(l3_key);
+        if (lt == l3_ids.end()) lt = l3_ids.emplace(l3_key, (std::uint32_t)l3_ids.size()).first;
+        info.l3 = lt->second;
+        topo.cpus.push_back(info);
+    }
+    topo.physical_cores = (std::uint32_t)core_ids.size();
+    topo.l3_domains = (std::uint32_t)l3_ids.size();
+#else
+    (void)root;
+#endif
+    return topo;
+}
+
+CpuPlan plan_cpus(const CpuTopology& topo, std::uint32_t reserved_cores, std::uint32_t worker_count) {
+    CpuPlan plan{};
+    if (!topo.valid()) return plan;
+
+    std::vector<CpuInfo> order = topo.cpus;
+    std::sort(order.begin(), order.end(), [](const CpuInfo& a, const CpuInfo& b) {
+        if (a.smt_index != b.smt_index) return a.smt_index < b.smt_index;
+        if (a.l3 != b.l3) return a.l3 < b.l3;
+        if (a.core != b.core) return a.core < b.core;
+        return a.cpu < b.cpu;
+    });
+
+    // Reserved cores come first in the first L3 domain, so the main thread shares its cache with the
+    // first workers and core 0 (which usually services most interrupts) never hosts a worker.
+    reserved_cores = std::min(reserved_cores, topo.physical_cores > 1 ? topo.physical_cores - 1 : 0u);
+    std::vector<std::uint32_t> reserved_core_ids;
+    for (const CpuInfo& c : order) {
+        if (reserved_core_ids.size() >= reserved_cores) break;
+        if (c.smt_index == 0) reserved_core_ids.push_back(c.core);
+    }
+    auto is_reserved = [&](std::uint32_t core) {
+        return std::find(reserved_core_ids.begin(), reserved_core_ids.end(), core) != reserved_core_ids.end();
+    };
+
+    std::uint32_t primary = 0;
+    for (const CpuInfo& c : order) {
+        if (is_reserved(c.core)) plan.reserved.push_back(c.cpu);
+        else if (c.smt_index == 0) ++primary;
+    }
+    std::sort(plan.reserved.begin(), plan.reserved.end());
+
+    const std::uint32_t want = worker_count ? worker_count : std::max(1u, primary);
+    while (plan.workers.size() < want) {
+        const std::size_t before = plan.workers.size();
+        for (const CpuInfo& c : order) {
+            if (plan.workers.size() >= want) break;
+            if (!is_reserved(c.core)) plan.workers.push_back(c.cpu);
+        }
+        if (plan.workers.size() == before) {
+            // Every core is reserved (single-core machine): share the reserved ones.
+            for (const CpuInfo& c : order) {
+                if (plan.workers.size() >= want) break;
+                plan.workers.push_back(c.cpu);
+            }
+        }
+    }
+    return plan;
+}
+
+bool pin_current_thread(const std::vector<std::uint32_t>& cpus) {
+    if (cpus.empty()) return false;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const std::uint32_t c : cpus) if (c < CPU_SETSIZE) CPU_SET(c, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+void set_current_thread_name(const char* name) {
+    if (!name) return;
+#if defined(__linux__)
+    char buf[16];
+    std::snprintf(buf, sizeof(buf), "%s", name);
+    pthread_setname_np(pthread_self(), buf);
+#elif defined(_WIN32)
+    wchar_t wbuf[64];
+    std::size_t i = 0;
+    for (; name[i] && i + 1 < 64; ++i) wbuf[i] = (wchar_t)(unsigned char)name[i];
+    wbuf[i] = 0;
+    SetThreadDescription(GetCurrentThread(), wbuf);
+#endif
+}
+
+}
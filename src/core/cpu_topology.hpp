@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cube::jobs {
+
+struct CpuInfo {
+    std::uint32_t cpu{};
+    std::uint32_t package{};
+    std::uint32_t core{};       // physical core index, dense across packages
+    std::uint32_t l3{};         // lowest cpu sharing this cpu's L3; dense-remapped by detect
+    std::uint32_t smt_index{};  // 0 for the first hardware thread of a core
+};
+
+struct CpuTopology {
+    std::vector<CpuInfo> cpus;
+    std::uint32_t physical_cores{};
+    std::uint32_t l3_domains{};
+    bool valid() const { return !cpus.empty(); }
+};
+
+// Reads cpu/online, topology/* and cache/index3 from a sysfs cpu directory. Returns an empty topology
+// off Linux or when sysfs is unreadable. `root` exists so tests can point it at a synthetic tree.
+CpuTopology detect_cpu_topology(const std::string& root = "/sys/devices/system/cpu");
+
+struct CpuPlan {
+    std::vector<std::uint32_t> reserved;  // every hardware thread of the reserved cores
+    std::vector<std::uint32_t> workers;   // one cpu per worker, in worker order
+};
+
+// Reserves the first `reserved_cores` physical cores (main/render threads), then hands workers one
+// hardware thread per remaining physical core, grouped by L3 domain, before using SMT siblings.
+// worker_count == 0 means one worker per remaining physical core.
+CpuPlan plan_cpus(const CpuTopology& topo, std::uint32_t reserved_cores, std::uint32_t worker_count);
+
+bool pin_current_thread(const std::vector<std::uint32_t>& cpus);
+void set_current_thread_name(const char* name);
+
+}
@@ -0,0 +1,126 @@
+#include "event_count.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+
+#if defined(_WIN32)
+  #include <windows.h>
+  #pragma comment(lib, "Synchronization.lib")
+#elif defined(__linux__)
+  #include <linux/futex.h>
+  #include <sys/syscall.h>
+  #include <time.h>
+  #include <unistd.h>
+#else
+  #include <chrono>
+  #include <thread>
+#endif
+
+namespace cube::jobs {
+
+namespace {
+
+static_assert(sizeof(std::atomic<std::uint64_t>) == sizeof(std::uint64_t));
+static_assert(std::endian::native == std::endian::little || std::endian::native == std::endian::big,
+              "epoch_word needs a byte order where the upper 32 bits are one aligned half");
+
+// Address of the epoch half (upper 32 bits) of the state word: offset 4 on little-endian, 0 on big.
+std::uint32_t* epoch_word(std::atomic<std::uint64_t>& state) {
+    constexpr std::size_t upper = std::endian::native == std::endian::little ? 1 : 0;
+    return reinterpret_cast<std::uint32_t*>(&state) + upper;
+}
+
+bool os_wait(std::atomic<std::uint64_t>& state, std::uint32_t expected, std::uint32_t timeout_ms) {
+#if defined(_WIN32)
+    std::uint32_t cmp = expected;
+    return WaitOnAddress(epoch_word(state), &cmp, sizeof(cmp), timeout_ms ? (DWORD)timeout_ms : INFINITE) != FALSE;
+#elif defined(__linux__)
+    timespec ts{};
+    timespec* pts = nullptr;
+    if (timeout_ms) {
+        ts.tv_sec = (time_t)(timeout_ms / 1000u);
+        ts.tv_nsec = (long)(timeout_ms % 1000u) * 1000000L;
+        pts = &ts;
+    }
+    const long r = syscall(SYS_futex, epoch_word(state), FUTEX_WAIT_PRIVATE, expected, pts, nullptr, 0);
+    return !(r != 0 && errno == ETIMEDOUT);
+#else
+    const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    while ((std::uint32_t)(state.load(std::memory_order_acquire) >> 32) == expected) {
+        if (timeout_ms && std::chrono::steady_clock::now() >= until) return false;
+        std::this_thread::yield();
+    }
+    return true;
+#endif
+}
+
+void os_wake(std::atomic<std::uint64_t>& state, std::uint32_t n, bool all) {
+#if defined(_WIN32)
+    if (all) { WakeByAddressAll(epoch_word(state)); return; }
+    for (std::uint32_t i = 0; i < n; ++i) WakeByAddressSingle(epoch_word(state));
+#elif defined(__linux__)
+    syscall(SYS_futex, epoch_word(state), FUTEX_WAKE_PRIVATE, all ? 0x7fffffff : (int)n, nullptr, nullptr, 0);
+#else
+    (void)state;
+    (void)n;
+    (void)all;
+#endif
+}
+
+}
+
+EventCount::Key EventCount::prepare_wait() {
+    const std::uint64_t prev = state_.fetch_add(WAITER, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return epoch_of(prev);
+}
+
+void EventCount::finish_wait(Key key) {
+    std::uint64_t v = state_.load(std::memory_order_relaxed);
+    for (;;) {
+        std::uint64_t next = v - WAITER;
+        if (epoch_of(v) != key && (v & SIGNAL_MASK)) next -= SIGNAL;
+        if (state_.compare_exchange_weak(v, next, std::memory_order_acq_rel, std::memory_order_relaxed)) return;
+    }
+}
+
+void EventCount::cancel_wait(Key key) {
+    finish_wait(key);
+}
+
+bool EventCount::commit_wait(Key key, std::uint32_t timeout_ms) {
+    bool woke = true;
+    while (epoch_of(state_.load(std::memory_order_acquire)) == key) {
+        if (!os_wait(state_, key, timeout_ms)) {
+            woke = epoch_of(state_.load(std::memory_order_acquire)) != key;
+            break;
+        }
+    }
+    finish_wait(key);
+    return woke;
+}
+
+void EventCount::signal(std::uint32_t n, bool all) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::uint64_t v = state_.load(std::memory_order_seq_cst);
+    std::uint32_t k = 0;
+    for (;;) {
+        const std::uint32_t waiters = (std::uint32_t)(v & WAITER_MASK);
+        const std::uint32_t signals = (std::uint32_t)((v & SIGNAL_MASK) >> 16);
+        if (waiters <= signals) return;
+        k = all ? (waiters - signals) : std::min(n, waiters - signals);
+        if (state_.compare_exchange_weak(v, v + EPOCH + (std::uint64_t)k * SIGNAL, std::memory_order_seq_cst, std::memory_order_relaxed)) break;
+    }
+    os_wake(state_, k, all);
+}
+
+void EventCount::notify(std::uint32_t n) {
+    if (n) signal(n, false);
+}
+
+void EventCount::notify_all() {
+    signal(0, true);
+}
+
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+  #include <intrin.h>
+#endif
+
+namespace cube::jobs {
+
+inline void cpu_relax() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_pause();
+#elif defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// Lock-free parking primitive. A waiter announces itself with prepare_wait(), re-checks its
+// condition, then either cancel_wait()s or commit_wait()s on the returned key. Notifiers only touch
+// the kernel (futex / WaitOnAddress) when a parked waiter has not already been signalled, so a burst
+// of submits wakes each sleeper once instead of issuing a syscall per submit.
+//
+// State word: [epoch:32 | signals:16 | waiters:16]. The OS wait is on the epoch half.
+class EventCount {
+public:
+    using Key = std::uint32_t;
+
+    Key prepare_wait();
+    void cancel_wait(Key key);
+    // Returns false if the timeout elapsed before a notify. timeout_ms == 0 waits indefinitely.
+    bool commit_wait(Key key, std::uint32_t timeout_ms = 0);
+
+    void notify_one() { notify(1); }
+    void notify(std::uint32_t n);
+    void notify_all();
+
+    std::uint32_t waiters() const { return (std::uint32_t)(state_.load(std::memory_order_relaxed) & WAITER_MASK); }
+
+private:
+    static constexpr std::uint64_t WAITER = 1ull;
+    static constexpr std::uint64_t WAITER_MASK = 0xffffull;
+    static constexpr std::uint64_t SIGNAL = 1ull << 16;
+    static constexpr std::uint64_t SIGNAL_MASK = 0xffffull << 16;
+    static constexpr std::uint64_t EPOCH = 1ull << 32;
+
+    static Key epoch_of(std::uint64_t v) { return (Key)(v >> 32); }
+    void finish_wait(Key key);
+    void signal(std::uint32_t n, bool all);
+
+    std::atomic<std::uint64_t> state_{0};
+};
+
+}
@@ -1,10 +1,20 @@
 #include "job_system.hpp"
+#include "cpu_topology.hpp"
+#include "job_task.hpp"
+#include "memory/heap_profiler.hpp"
 
 #include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 
 namespace cube::jobs {
 
 thread_local bool JobSystem::tls_is_worker_ = false;
+thread_local const JobSystem* JobSystem::tls_owner_ = nullptr;
+thread_local JobSystem* JobSystem::tls_current_ = nullptr;
+thread_local std::uint32_t JobSystem::tls_worker_index_ = 0;
+thread_local JobSystem::ScratchArena* JobSystem::tls_scratch_ = nullptr;
 
 static std::uint32_t round_down_pow2(std::uint32_t v) {
     if (v < 2) return 0;
@@ -13,93 +23,51 @@ static std::uint32_t round_down_pow2(std::uint32_t v) {
     return p;
 }
 
-template <class T>
-bool JobSystem::MpmcQueue<T>::init(std::uint32_t capacity_pow2) {
-    const std::uint32_t cap = round_down_pow2(capacity_pow2);
-    if (cap == 0) return false;
-    buf_.clear();
-    buf_.resize(cap);
-    mask_ = static_cast<std::size_t>(cap - 1u);
-    head_.store(0, std::memory_order_relaxed);
-    tail_.store(0, std::memory_order_relaxed);
-    for (std::size_t i = 0; i < buf_.size(); ++i) buf_[i].seq.store(i, std::memory_order_relaxed);
-    return true;
-}
+static_assert(sizeof(JobSystem::Job) <= 128 - sizeof(std::size_t), "Job no longer fits a two-cache-line queue cell");
 
-template <class T>
-void JobSystem::MpmcQueue<T>::reset() {
-    head_.store(0, std::memory_order_relaxed);
-    tail_.store(0, std::memory_order_relaxed);
-    for (std::size_t i = 0; i < buf_.size(); ++i) buf_[i].seq.store(i, std::memory_order_relaxed);
-}
+static_assert(sizeof(JobSystem::Counter) <= 32, "Counter should stay small enough to keep one per chunk per stage");
 
-template <class T>
-bool JobSystem::MpmcQueue<T>::enqueue(const T& v) {
-    Cell* cell = nullptr;
-    std::size_t pos = tail_.load(std::memory_order_relaxed);
-    for (;;) {
-        cell = &buf_[pos & mask_];
-        std::size_t seq = cell->seq.load(std::memory_order_acquire);
-        const std::intptr_t dif = (std::intptr_t)seq - (std::intptr_t)pos;
-        if (dif == 0) {
-            if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
-        } else if (dif < 0) {
-            return false;
-        } else {
-            pos = tail_.load(std::memory_order_relaxed);
-        }
-    }
-    cell->data = v;
-    cell->seq.store(pos + 1, std::memory_order_release);
-    return true;
+JobSystem::JobSystem() {
+    continuations_.init(sizeof(Continuation), alignof(Continuation));
 }
 
-template <class T>
-bool JobSystem::MpmcQueue<T>::dequeue(T& out) {
-    Cell* cell = nullptr;
-    std::size_t pos = head_.load(std::memory_order_relaxed);
-    for (;;) {
-        cell = &buf_[pos & mask_];
-        std::size_t seq = cell->seq.load(std::memory_order_acquire);
-        const std::intptr_t dif = (std::intptr_t)seq - (std::intptr_t)(pos + 1);
-        if (dif == 0) {
-            if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
-        } else if (dif < 0) {
-            return false;
-        } else {
-            pos = head_.load(std::memory_order_relaxed);
-        }
-    }
-    out = cell->data;
-    cell->seq.store(pos + mask_ + 1, std::memory_order_release);
-    return true;
-}
-
-template class JobSystem::MpmcQueue<JobSystem::Job>;
-
 void JobSystem::Counter::add(std::int32_t n) {
     if (n <= 0) return;
-    remaining.fetch_add(n, std::memory_order_relaxed);
+    state.fetch_add((std::uint64_t)n, std::memory_order_relaxed);
 }
 
 void JobSystem::schedule_continuations(Counter& c) {
     Continuation* list = c.conts.exchange(nullptr, std::memory_order_acq_rel);
     while (list) {
         Continuation* n = list->next;
-        enqueue_job(list->job, list->prio);
-        delete list;
+        if (list->main_thread) enqueue_main(list->job);
+        else enqueue_job(list->job, list->prio);
+        list->~Continuation();
+        continuations_.free(list);
         list = n;
     }
 }
 
 void JobSystem::Counter::done() {
-    const std::int32_t prev = remaining.fetch_sub(1, std::memory_order_acq_rel);
-    if (prev != 1) return;
-    if (js) js->schedule_continuations(*this);
-    {
-        std::scoped_lock lk(wait_m);
-    }
-    wait_cv.notify_all();
+    std::uint64_t v = state.load(std::memory_order_relaxed);
+    bool last = false;
+    do {
+        // Decrementing a zero count would borrow from the waiter bits.
+        if ((v & COUNT_MASK) == 0) {
+            LOG_WARN_LIMITED("Jobs", "done() on counter %u with no outstanding work", id);
+            return;
+        }
+        // Test the 1 -> 0 transition itself: a counter re-armed while an earlier finish is still
+        // running carries that finish's FINISHING bit.
+        last = (v & COUNT_MASK) == 1;
+    } while (!state.compare_exchange_weak(v, last ? (v - 1) | FINISHING : v - 1, std::memory_order_acq_rel, std::memory_order_relaxed));
+    if (!last) return;
+    JobSystem* owner = js;
+    if (owner) owner->schedule_continuations(*this);
+    // Waiters register on the same word they test, so this load cannot miss one that parked.
+    const bool wake = (state.load(std::memory_order_seq_cst) & WAITER_MASK) != 0;
+    state.fetch_and(~FINISHING, std::memory_order_release);
+    if (owner && wake) owner->waiter_parker_.notify_all();
 }
 
 bool JobSystem::init(const Config& cfg) {
@@ -107,20 +75,64 @@ bool JobSystem::init(const Config& cfg) {
     cfg_ = cfg;
     if (cfg_.queue_capacity < 64) cfg_.queue_capacity = 64;
     const std::uint32_t cap = round_down_pow2(cfg_.queue_capacity);
-    if (!q_high_.init(cap) || !q_norm_.init(cap) || !q_low_.init(cap)) return false;
+    for (auto& lane : lanes_) if (!lane.ring.init(cap)) return false;
 
     const std::uint32_t hc = std::max(1u, std::thread::hardware_concurrency());
     std::uint32_t tc = cfg_.thread_count ? cfg_.thread_count : (hc > 2 ? (hc - 2) : 1u);
+    worker_cpus_.clear();
+    if (cfg_.pin_workers) {
+        const CpuTopology topo = detect_cpu_topology();
+        const CpuPlan plan = plan_cpus(topo, cfg_.reserved_cores, cfg_.thread_count);
+        if (!plan.workers.empty()) {
+            worker_cpus_ = plan.workers;
+            tc = (std::uint32_t)plan.workers.size();
+            pin_current_thread(plan.reserved);
+            LOG_INFO("Jobs", "CPU topology: %u cpus, %u physical cores, %u L3 domains; %zu reserved cpus, %u pinned workers",
+                     (unsigned)topo.cpus.size(), topo.physical_cores, topo.l3_domains, plan.reserved.size(), tc);
+        } else {
+            LOG_WARN("Jobs", "CPU topology unavailable; workers left unpinned");
+        }
+    }
     tc = std::max(1u, std::min(tc, 64u));
+    if (hc == 1) cfg_.spin_before_park = 0;
 
     stop_.store(false, std::memory_order_release);
-    pending_high_.store(0, std::memory_order_relaxed);
-    pending_norm_.store(0, std::memory_order_relaxed);
-    pending_low_.store(0, std::memory_order_relaxed);
+    for (auto& lane : lanes_) {
+        std::scoped_lock lk(lane.overflow_m, lane.deadline_m);
+        lane.overflow.clear();
+        lane.overflow_size.store(0, std::memory_order_relaxed);
+        lane.deadline_heap.clear();
+        lane.deadline_size.store(0, std::memory_order_relaxed);
+        lane.pending.store(0, std::memory_order_relaxed);
+        lane.max_age_ns.store(0, std::memory_order_relaxed);
+        lane.missed.store(0, std::memory_order_relaxed);
+    }
+    {
+        std::scoped_lock lk(main_m_);
+        main_q_.clear();
+    }
+    main_thread_ = std::this_thread::get_id();
+    tls_current_ = this;
+    main_pending_.store(0, std::memory_order_relaxed);
+    main_ran_.store(0, std::memory_order_relaxed);
+    main_latency_sum_ns_.store(0, std::memory_order_relaxed);
+    main_latency_max_ns_.store(0, std::memory_order_relaxed);
     stall_warnings_.store(0, std::memory_order_relaxed);
+    overflow_peak_.store(0, std::memory_order_relaxed);
+    overflow_events_.store(0, std::memory_order_relaxed);
 
     worker_counters_.clear();
     worker_counters_.resize(tc);
+    job_types_ = std::make_unique<JobTypeSlot[]>(MAX_JOB_TYPES + 1);
+    trace_.init(tc, cfg_.trace_events_per_thread);
+    scratch_count_ = tc + 1;
+    scratch_ = std::make_unique<ScratchArena[]>(scratch_count_);
+    for (std::uint32_t i = 0; i < scratch_count_ && cfg_.scratch_bytes; ++i) {
+        scratch_[i].memory = std::make_unique<std::byte[]>(cfg_.scratch_bytes);
+        scratch_[i].stack.reset(scratch_[i].memory.get(), cfg_.scratch_bytes);
+    }
+    tls_scratch_ = &scratch_[tc];
+    mem::set_thread_scratch(&tls_scratch_->stack);
     workers_.clear();
     workers_.reserve(tc);
     for (std::uint32_t i = 0; i < tc; ++i) workers_.emplace_back([this, i] { worker_main(i); });
@@ -131,37 +143,168 @@ bool JobSystem::init(const Config& cfg) {
 
 void JobSystem::shutdown() {
     if (!running_.exchange(false, std::memory_order_acq_rel)) return;
+    if (tls_current_ == this) tls_current_ = nullptr;
+    if (scratch_ && tls_scratch_ == &scratch_[scratch_count_ - 1]) {
+        tls_scratch_ = nullptr;
+        mem::set_thread_scratch(nullptr);
+    }
     stop_.store(true, std::memory_order_release);
-    wake_cv_.notify_all();
+    parker_.notify_all();
+    waiter_parker_.notify_all();
     for (auto& t : workers_) if (t.joinable()) t.join();
     workers_.clear();
     worker_counters_.clear();
-    q_high_.reset();
-    q_norm_.reset();
-    q_low_.reset();
+    trace_.shutdown();
+    for (auto& lane : lanes_) {
+        lane.ring.reset();
+        std::scoped_lock lk(lane.overflow_m, lane.deadline_m);
+        lane.overflow.clear();
+        lane.overflow_size.store(0, std::memory_order_relaxed);
+        lane.deadline_heap.clear();
+        lane.deadline_size.store(0, std::memory_order_relaxed);
+        lane.pending.store(0, std::memory_order_relaxed);
+    }
+    std::scoped_lock lk(main_m_);
+    main_q_.clear();
+    main_pending_.store(0, std::memory_order_relaxed);
 }
 
 void JobSystem::init_counter(Counter& c, std::int32_t initial) {
     c.js = this;
     c.conts.store(nullptr, std::memory_order_relaxed);
-    c.remaining.store(initial, std::memory_order_relaxed);
+    c.state.store((std::uint32_t)initial, std::memory_order_relaxed);
+    c.id = next_counter_id_.fetch_add(1, std::memory_order_relaxed) + 1u;
 }
 
-bool JobSystem::enqueue_job(const Job& j, Priority p) {
-    for (;;) {
-        bool ok = false;
-        if (p == Priority::High) ok = q_high_.enqueue(j);
-        else if (p == Priority::Normal) ok = q_norm_.enqueue(j);
-        else ok = q_low_.enqueue(j);
-        if (ok) {
-            if (p == Priority::High) pending_high_.fetch_add(1, std::memory_order_relaxed);
-            else if (p == Priority::Normal) pending_norm_.fetch_add(1, std::memory_order_relaxed);
-            else pending_low_.fetch_add(1, std::memory_order_relaxed);
-            wake_one();
-            return true;
+JobSystem::CounterHandle JobSystem::acquire_counter(std::int32_t initial) {
+    std::uint32_t index = 0;
+    {
+        std::scoped_lock lk(counter_pool_m_);
+        if (counter_free_.empty()) {
+            const std::uint32_t blocks = counter_block_count_.load(std::memory_order_relaxed);
+            if (blocks == COUNTER_BLOCKS) {
+                LOG_ERROR("Jobs", "Counter pool exhausted (%u counters)", COUNTER_BLOCKS * COUNTER_BLOCK);
+                return {};
+            }
+            counter_blocks_[blocks] = std::make_unique<Counter[]>(COUNTER_BLOCK);
+            for (std::uint32_t i = COUNTER_BLOCK; i-- > 0;) counter_free_.push_back(blocks * COUNTER_BLOCK + i);
+            counter_block_count_.store(blocks + 1, std::memory_order_release);
         }
-        std::this_thread::yield();
+        index = counter_free_.back();
+        counter_free_.pop_back();
     }
+    Counter& c = counter_blocks_[index / COUNTER_BLOCK][index % COUNTER_BLOCK];
+    init_counter(c, initial);
+    std::uint32_t gen = c.generation.load(std::memory_order_relaxed) + 1u;
+    if (gen == 0) gen = 1;
+    c.generation.store(gen, std::memory_order_release);
+    counter_pool_live_.fetch_add(1, std::memory_order_relaxed);
+    return CounterHandle{index, gen};
+}
+
+JobSystem::Counter* JobSystem::resolve(CounterHandle h) {
+    if (!h || h.index / COUNTER_BLOCK >= counter_block_count_.load(std::memory_order_acquire)) return nullptr;
+    Counter& c = counter_blocks_[h.index / COUNTER_BLOCK][h.index % COUNTER_BLOCK];
+    return c.generation.load(std::memory_order_acquire) == h.generation ? &c : nullptr;
+}
+
+bool JobSystem::release_counter(CounterHandle h) {
+    Counter* c = resolve(h);
+    if (!c) {
+        LOG_WARN("Jobs", "Release of stale counter handle %u/%u", h.index, h.generation);
+        return false;
+    }
+    if (!c->is_settled() || c->waiters() > 0) {
+        LOG_WARN("Jobs", "Release of counter %u with work or waiters outstanding", h.index);
+        return false;
+    }
+    // Bumping the generation first invalidates every outstanding handle before the slot is reused.
+    std::uint32_t expected = h.generation;
+    if (!c->generation.compare_exchange_strong(expected, h.generation + 1u, std::memory_order_acq_rel)) return false;
+    counter_pool_live_.fetch_sub(1, std::memory_order_relaxed);
+    std::scoped_lock lk(counter_pool_m_);
+    counter_free_.push_back(h.index);
+    return true;
+}
+
+static bool later_deadline(const JobSystem::Job& a, const JobSystem::Job& b) {
+    return a.deadline_ns > b.deadline_ns;
+}
+
+bool JobSystem::enqueue_job(const Job& in, Priority p) {
+    Job j = in;
+    j.enqueue_ns = JobTrace::now_ns();
+    j.prio = p;
+    Lane& lane = lanes_[(std::size_t)p];
+    if (j.deadline_ns) {
+        std::scoped_lock lk(lane.deadline_m);
+        lane.deadline_heap.push_back(j);
+        std::push_heap(lane.deadline_heap.begin(), lane.deadline_heap.end(), later_deadline);
+        lane.deadline_size.store((std::uint32_t)lane.deadline_heap.size(), std::memory_order_release);
+    } else if (lane.overflow_size.load(std::memory_order_acquire) != 0 || !lane.ring.enqueue(j)) {
+        std::uint32_t size = 0;
+        {
+            std::scoped_lock lk(lane.overflow_m);
+            lane.overflow.push_back(j);
+            size = (std::uint32_t)lane.overflow.size();
+            lane.overflow_size.store(size, std::memory_order_release);
+        }
+        overflow_events_.fetch_add(1, std::memory_order_relaxed);
+        std::uint32_t peak = overflow_peak_.load(std::memory_order_relaxed);
+        while (size > peak && !overflow_peak_.compare_exchange_weak(peak, size, std::memory_order_relaxed)) {}
+    }
+    // A lane's starvation clock starts when it goes from empty to non-empty.
+    if (lane.pending.fetch_add(1, std::memory_order_relaxed) == 0) lane.served_ns.store(j.enqueue_ns, std::memory_order_relaxed);
+    wake_one();
+    return true;
+}
+
+void JobSystem::enqueue_jobs(Job* jobs, std::size_t n, Priority p) {
+    if (n == 0) return;
+    const std::uint64_t now = JobTrace::now_ns();
+    Lane& lane = lanes_[(std::size_t)p];
+    std::size_t plain = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        Job& j = jobs[i];
+        j.enqueue_ns = now;
+        j.prio = p;
+        if (!j.deadline_ns) {
+            jobs[plain++] = j;
+            continue;
+        }
+        std::scoped_lock lk(lane.deadline_m);
+        lane.deadline_heap.push_back(j);
+        std::push_heap(lane.deadline_heap.begin(), lane.deadline_heap.end(), later_deadline);
+        lane.deadline_size.store((std::uint32_t)lane.deadline_heap.size(), std::memory_order_release);
+    }
+    std::size_t done = 0;
+    if (lane.overflow_size.load(std::memory_order_acquire) == 0) done = lane.ring.enqueue_bulk(jobs, plain);
+    if (done < plain) {
+        std::uint32_t size = 0;
+        {
+            std::scoped_lock lk(lane.overflow_m);
+            lane.overflow.insert(lane.overflow.end(), jobs + done, jobs + plain);
+            size = (std::uint32_t)lane.overflow.size();
+            lane.overflow_size.store(size, std::memory_order_release);
+        }
+        overflow_events_.fetch_add(plain - done, std::memory_order_relaxed);
+        std::uint32_t peak = overflow_peak_.load(std::memory_order_relaxed);
+        while (size > peak && !overflow_peak_.compare_exchange_weak(peak, size, std::memory_order_relaxed)) {}
+    }
+    if (lane.pending.fetch_add((std::uint32_t)n, std::memory_order_relaxed) == 0) lane.served_ns.store(now, std::memory_order_relaxed);
+    parker_.notify((std::uint32_t)std::min<std::size_t>(n, workers_.size()));
+    wake_blocked_waiter();
+}
+
+void JobSystem::defer(Counter& dependency, const Job& j, Priority p, bool main_thread) {
+    void* mem = continuations_.alloc(sizeof(Continuation), alignof(Continuation));
+    if (!mem) throw std::bad_alloc();
+    auto* n = new (mem) Continuation{j, p, main_thread, nullptr};
+    Continuation* head = dependency.conts.load(std::memory_order_relaxed);
+    do { n->next = head; } while (!dependency.conts.compare_exchange_weak(head, n, std::memory_order_acq_rel, std::memory_order_relaxed));
+    // The counter may have hit zero after the caller's is_done() check but before the push, in which
+    // case done() already drained the list and would never see this node. Drain again ourselves.
+    if (dependency.is_done()) schedule_continuations(dependency);
 }
 
 void JobSystem::submit(JobFn fn, void* data, Priority prio, Counter* counter, Counter* dependency, const char* name) {
@@ -169,85 +312,269 @@ void JobSystem::submit(JobFn fn, void* data, Priority prio, Counter* counter, Co
     if (counter) counter->add(1);
     Job j{fn, data, counter, dependency, name};
     if (dependency && !dependency->is_done()) {
-        auto* n = new Continuation{j, prio, nullptr};
-        Continuation* head = dependency->conts.load(std::memory_order_relaxed);
-        do { n->next = head; } while (!dependency->conts.compare_exchange_weak(head, n, std::memory_order_release, std::memory_order_relaxed));
+        defer(*dependency, j, prio, false);
         return;
     }
     enqueue_job(j, prio);
 }
 
+void JobSystem::submit(const Job& job, Priority prio) {
+    if (!job.fn) return;
+    if (job.counter) job.counter->add(1);
+    if (job.dependency && !job.dependency->is_done()) {
+        defer(*job.dependency, job, prio, false);
+        return;
+    }
+    enqueue_job(job, prio);
+}
+
 void JobSystem::submit_batch(const Job* jobs, std::size_t n, Priority prio, Counter* counter, Counter* dependency) {
     if (!jobs || n == 0) return;
     if (counter) counter->add((std::int32_t)n);
+    const bool deferred = dependency && !dependency->is_done();
+    constexpr std::size_t CHUNK = 64;
+    Job chunk[CHUNK];
+    std::size_t at = 0;
     for (std::size_t i = 0; i < n; ++i) {
         const Job& in = jobs[i];
         if (!in.fn) {
             if (counter) counter->done();
             continue;
         }
-        Job j{in.fn, in.data, counter, dependency, in.name};
-        if (dependency && !dependency->is_done()) {
-            auto* nn = new Continuation{j, prio, nullptr};
-            Continuation* head = dependency->conts.load(std::memory_order_relaxed);
-            do { nn->next = head; } while (!dependency->conts.compare_exchange_weak(head, nn, std::memory_order_release, std::memory_order_relaxed));
+        Job j = in;
+        j.counter = counter;
+        j.dependency = dependency;
+        if (deferred) {
+            defer(*dependency, j, prio, false);
             continue;
         }
-        enqueue_job(j, prio);
+        chunk[at++] = j;
+        if (at == CHUNK) {
+            enqueue_jobs(chunk, at, prio);
+            at = 0;
+        }
     }
+    if (at) enqueue_jobs(chunk, at, prio);
+}
+
+void JobSystem::submit_main(JobFn fn, void* data, Counter* counter, Counter* dependency, const char* name) {
+    if (!fn) return;
+    if (counter) counter->add(1);
+    Job j{fn, data, counter, dependency, name};
+    if (dependency && !dependency->is_done()) {
+        defer(*dependency, j, Priority::High, true);
+        return;
+    }
+    enqueue_main(j);
+}
+
+void JobSystem::enqueue_main(const Job& in) {
+    Job j = in;
+    j.enqueue_ns = JobTrace::now_ns();
+    j.prio = Priority::High;
+    {
+        std::scoped_lock lk(main_m_);
+        main_q_.push_back(j);
+    }
+    main_pending_.fetch_add(1, std::memory_order_relaxed);
+    // The main thread may be parked inside wait() on a counter this job feeds.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (main_waiters_.load(std::memory_order_relaxed) > 0) waiter_parker_.notify_all();
+}
+
+bool JobSystem::try_run_main_one() {
+    if (main_pending_.load(std::memory_order_acquire) == 0) return false;
+    Job j{};
+    {
+        std::scoped_lock lk(main_m_);
+        if (main_q_.empty()) return false;
+        j = main_q_.front();
+        main_q_.pop_front();
+    }
+    main_pending_.fetch_sub(1, std::memory_order_relaxed);
+    const std::uint64_t now = JobTrace::now_ns();
+    const std::uint64_t lat = now > j.enqueue_ns ? now - j.enqueue_ns : 0;
+    main_ran_.fetch_add(1, std::memory_order_relaxed);
+    main_latency_sum_ns_.fetch_add(lat, std::memory_order_relaxed);
+    if (lat > main_latency_max_ns_.load(std::memory_order_relaxed)) main_latency_max_ns_.store(lat, std::memory_order_relaxed);
+    run_job(j, trace_.external_slot());
+    return true;
+}
+
+std::uint32_t JobSystem::run_main_thread_jobs(std::uint64_t budget_ns) {
+    CUBE_PROFILE_SCOPE_N("main_thread_jobs");
+    const std::uint64_t start = JobTrace::now_ns();
+    std::uint32_t ran = 0;
+    while (try_run_main_one()) {
+        ++ran;
+        if (JobTrace::now_ns() - start >= budget_ns) break;
+    }
+    return ran;
+}
+
+bool JobSystem::dequeue_lane(Lane& lane, Job& out, std::uint64_t now) {
+    bool got = false;
+    if (lane.deadline_size.load(std::memory_order_acquire) != 0) {
+        std::scoped_lock lk(lane.deadline_m);
+        if (!lane.deadline_heap.empty()) {
+            std::pop_heap(lane.deadline_heap.begin(), lane.deadline_heap.end(), later_deadline);
+            out = lane.deadline_heap.back();
+            lane.deadline_heap.pop_back();
+            lane.deadline_size.store((std::uint32_t)lane.deadline_heap.size(), std::memory_order_release);
+            got = true;
+        }
+    }
+    if (!got && !lane.ring.dequeue(out)) {
+        if (lane.overflow_size.load(std::memory_order_acquire) == 0) return false;
+        std::scoped_lock lk(lane.overflow_m);
+        if (lane.overflow.empty()) return false;
+        out = lane.overflow.front();
+        lane.overflow.pop_front();
+        lane.overflow_size.store((std::uint32_t)lane.overflow.size(), std::memory_order_release);
+    }
+    lane.pending.fetch_sub(1, std::memory_order_relaxed);
+    lane.served_ns.store(now, std::memory_order_relaxed);
+    const std::uint64_t age = now > out.enqueue_ns ? now - out.enqueue_ns : 0;
+    if (age > lane.max_age_ns.load(std::memory_order_relaxed)) lane.max_age_ns.store(age, std::memory_order_relaxed);
+    return true;
 }
 
 bool JobSystem::try_dequeue(Job& out) {
-    if (q_high_.dequeue(out)) { pending_high_.fetch_sub(1, std::memory_order_relaxed); return true; }
-    if (q_norm_.dequeue(out)) { pending_norm_.fetch_sub(1, std::memory_order_relaxed); return true; }
-    if (q_low_.dequeue(out)) { pending_low_.fetch_sub(1, std::memory_order_relaxed); return true; }
+    const std::uint64_t now = JobTrace::now_ns();
+    std::size_t first = 0;
+    if (cfg_.aging_ms) {
+        // Every full aging interval a waiting lane goes unserved lifts it one priority step. Ties keep
+        // the natural order, so High still wins unless a lower lane has starved.
+        const std::uint64_t step = (std::uint64_t)cfg_.aging_ms * 1000000ull;
+        std::int64_t best = INT64_MAX;
+        for (std::size_t i = 0; i < lanes_.size(); ++i) {
+            const Lane& lane = lanes_[i];
+            if (lane.pending.load(std::memory_order_relaxed) == 0) continue;
+            const std::uint64_t served = lane.served_ns.load(std::memory_order_relaxed);
+            const std::int64_t boost = now > served ? (std::int64_t)((now - served) / step) : 0;
+            const std::int64_t rank = (std::int64_t)i - boost;
+            if (rank < best) { best = rank; first = i; }
+        }
+    }
+    if (dequeue_lane(lanes_[first], out, now)) return true;
+    for (std::size_t i = 0; i < lanes_.size(); ++i) {
+        if (i != first && dequeue_lane(lanes_[i], out, now)) return true;
+    }
     return false;
 }
 
 bool JobSystem::try_run_one() {
     Job j{};
     if (!try_dequeue(j)) return false;
-    const auto t0 = std::chrono::steady_clock::now();
+    run_job(j, tls_owner_ == this ? tls_worker_index_ : trace_.external_slot());
+    return true;
+}
+
+std::uint64_t JobSystem::run_job(Job& j, std::uint32_t trace_slot) {
     const char* nm = j.name ? j.name : "job";
-    CUBE_PROFILE_SCOPE_N("job");
-    j.fn(j.data);
+    ScratchArena* arena = tls_scratch_;
+    const mem::StackAllocator::Marker mark = arena ? arena->stack.mark() : 0;
+    const auto t0 = std::chrono::steady_clock::now();
+    {
+        CUBE_PROFILE_SCOPE_N("job");
+        CUBE_PROFILE_ZONE_NAME(nm);
+        j.fn(j.context());
+    }
     const auto t1 = std::chrono::steady_clock::now();
-    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
-    if ((std::uint64_t)ms > cfg_.stall_warn_ms) {
+    if (arena) {
+        arena->peak.store(arena->stack.stats().peak_bytes_in_use, std::memory_order_relaxed);
+        arena->stack.pop(mark);
+    }
+    const std::uint64_t ns = (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+    if (j.deadline_ns && (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t1.time_since_epoch()).count() > j.deadline_ns) {
+        lanes_[(std::size_t)j.prio].missed.fetch_add(1, std::memory_order_relaxed);
+    }
+    const std::uint64_t start_ns = (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t0.time_since_epoch()).count();
+    if (job_types_) {
+        JobTypeSlot& slot = job_type_slot(nm);
+        slot.wait.record(j.enqueue_ns && j.enqueue_ns < start_ns ? start_ns - j.enqueue_ns : 0);
+        slot.run.record(ns);
+    }
+    if (trace_.enabled()) {
+        TraceEvent e{};
+        e.name = nm;
+        e.start_ns = start_ns;
+        e.end_ns = e.start_ns + ns;
+        e.queue_ns = (j.enqueue_ns && j.enqueue_ns < e.start_ns) ? (e.start_ns - j.enqueue_ns) : 0;
+        e.counter_id = j.counter ? j.counter->id : 0;
+        trace_.record(trace_slot, e);
+    }
+    if (ns / 1000000ull > cfg_.stall_warn_ms) {
         stall_warnings_.fetch_add(1, std::memory_order_relaxed);
-        LOG_WARN("Jobs", "Job '%s' stall: %lldms", nm, (long long)ms);
+        LOG_WARN_LIMITED("Jobs", "Job '%s' stall: %llums", nm, (unsigned long long)(ns / 1000000ull));
     }
     if (j.counter) j.counter->done();
-    return true;
+    return ns;
 }
 
 void JobSystem::wait(Counter& c) {
-    using namespace std::chrono_literals;
     const auto start = std::chrono::steady_clock::now();
     bool warned = false;
-    while (!c.is_done()) {
+    const bool on_main = is_main_thread();
+    while (!c.is_settled()) {
+        // Count already hit zero; the completing thread is finishing continuations and wakes.
+        if (c.is_done()) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (on_main && try_run_main_one()) continue;
         if (try_run_one()) continue;
+        if (spin_for_work(&c)) continue;
         if (!warned) {
             const auto now = std::chrono::steady_clock::now();
             const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now - start).count();
-            const std::uint32_t pending = pending_high_.load(std::memory_order_relaxed) + pending_norm_.load(std::memory_order_relaxed) + pending_low_.load(std::memory_order_relaxed);
-            if (pending == 0 && ms > 250) {
+            if (pending_jobs() == 0 && (!on_main || main_pending_.load(std::memory_order_relaxed) == 0) && ms > 250) {
                 warned = true;
                 LOG_WARN("Jobs", "Possible deadlock waiting on counter");
             }
         }
-        std::unique_lock lk(c.wait_m);
-        if (c.is_done()) break;
-        c.wait_cv.wait_for(lk, 1ms);
+        c.state.fetch_add(Counter::WAITER, std::memory_order_seq_cst);
+        if (on_main) main_waiters_.fetch_add(1, std::memory_order_seq_cst);
+        const EventCount::Key key = waiter_parker_.prepare_wait();
+        if (c.is_done() || pending_jobs() > 0 || (on_main && main_pending_.load(std::memory_order_relaxed) > 0)) waiter_parker_.cancel_wait(key);
+        else waiter_parker_.commit_wait(key, warned ? 0u : 100u);
+        if (on_main) main_waiters_.fetch_sub(1, std::memory_order_relaxed);
+        c.state.fetch_sub(Counter::WAITER, std::memory_order_release);
     }
 }
 
 void JobSystem::wake_one() {
-    wake_cv_.notify_one();
+    parker_.notify_one();
+    wake_blocked_waiter();
+}
+
+void JobSystem::wake_blocked_waiter() {
+    // Runs after a parker_ notify, whose fence orders this against the waiter's prepare_wait. With no
+    // idle worker to take new work, a thread blocked in wait() runs it instead.
+    if (parker_.waiters() == 0 && waiter_parker_.waiters() > 0) waiter_parker_.notify_one();
+}
+
+bool JobSystem::spin_for_work(const Counter* c) const {
+    for (std::uint32_t i = 0; i < cfg_.spin_before_park; ++i) {
+        if (pending_jobs() > 0 || stop_.load(std::memory_order_relaxed)) return true;
+        if (c && c->is_done()) return true;
+        cpu_relax();
+    }
+    return false;
 }
 
 void JobSystem::worker_main(std::uint32_t worker_index) {
     tls_is_worker_ = true;
+    tls_owner_ = this;
+    tls_current_ = this;
+    tls_worker_index_ = worker_index;
+    tls_scratch_ = &scratch_[worker_index];
+    mem::set_thread_scratch(&tls_scratch_->stack);
+    mem::MemTagScope mem_tag(mem::MemCategory::Jobs);
+    char thread_name[16];
+    std::snprintf(thread_name, sizeof(thread_name), "cube-job-%u", worker_index);
+    set_current_thread_name(thread_name);
+    if (worker_index < worker_cpus_.size()) pin_current_thread({worker_cpus_[worker_index]});
     using clock = std::chrono::steady_clock;
     auto last = clock::now();
     for (;;) {
@@ -258,11 +585,11 @@ void JobSystem::worker_main(std::uint32_t worker_index) {
             const auto dt = std::chrono::duration_cast<std::chrono::nanoseconds>(now - last).count();
             worker_counters_[worker_index].total_ns.fetch_add((std::uint64_t)dt, std::memory_order_relaxed);
             last = now;
-            std::unique_lock lk(wake_m_);
-            wake_cv_.wait_for(lk, std::chrono::milliseconds(2), [this] {
-                return stop_.load(std::memory_order_relaxed) ||
-                    (pending_high_.load(std::memory_order_relaxed) + pending_norm_.load(std::memory_order_relaxed) + pending_low_.load(std::memory_order_relaxed)) > 0;
-            });
+            if (spin_for_work(nullptr)) continue;
+            detail::flush_task_frame_cache();
+            const EventCount::Key key = parker_.prepare_wait();
+            if (stop_.load(std::memory_order_relaxed) || pending_jobs() > 0) parker_.cancel_wait(key);
+            else parker_.commit_wait(key);
             continue;
         }
 
@@ -271,37 +598,110 @@ void JobSystem::worker_main(std::uint32_t worker_index) {
         worker_counters_[worker_index].total_ns.fetch_add((std::uint64_t)dt, std::memory_order_relaxed);
         last = now;
 
-        const auto t0 = clock::now();
-        const char* nm = j.name ? j.name : "job";
-        CUBE_PROFILE_SCOPE_N("job");
-        j.fn(j.data);
-        const auto t1 = clock::now();
-        const auto busy = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
-        worker_counters_[worker_index].busy_ns.fetch_add((std::uint64_t)busy, std::memory_order_relaxed);
-
-        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(t1 - t0).count();
-        if ((std::uint64_t)ms > cfg_.stall_warn_ms) {
-            stall_warnings_.fetch_add(1, std::memory_order_relaxed);
-            LOG_WARN("Jobs", "Job '%s' stall: %lldms", nm, (long long)ms);
-        }
-        if (j.counter) j.counter->done();
+        const std::uint64_t busy = run_job(j, worker_index);
+        worker_counters_[worker_index].busy_ns.fetch_add(busy, std::memory_order_relaxed);
     }
     tls_is_worker_ = false;
+    tls_owner_ = nullptr;
+    tls_current_ = nullptr;
+    tls_scratch_ = nullptr;
+    mem::set_thread_scratch(nullptr);
+}
+
+void JobSystem::snapshot_scratch(std::vector<ScratchStats>& out) const {
+    out.clear();
+    for (std::uint32_t i = 0; scratch_ && i < scratch_count_; ++i) {
+        out.push_back(ScratchStats{scratch_[i].stack.capacity(), scratch_[i].peak.load(std::memory_order_relaxed)});
+    }
+}
+
+JobSystem::JobTypeSlot& JobSystem::job_type_slot(const char* name) {
+    // Open addressing on the name pointer; names are string literals, so pointer identity is the
+    // common case and equal strings at different addresses are merged when snapshotting.
+    const std::uintptr_t h = (std::uintptr_t)name;
+    std::uint32_t i = (std::uint32_t)((h >> 3) ^ (h >> 11)) & (MAX_JOB_TYPES - 1u);
+    for (std::uint32_t probe = 0; probe < MAX_JOB_TYPES; ++probe, i = (i + 1u) & (MAX_JOB_TYPES - 1u)) {
+        JobTypeSlot& s = job_types_[i];
+        const char* cur = s.name.load(std::memory_order_acquire);
+        if (cur == name) return s;
+        if (!cur) {
+            if (s.name.compare_exchange_strong(cur, name, std::memory_order_acq_rel)) return s;
+            if (cur == name) return s;
+        }
+    }
+    return job_types_[MAX_JOB_TYPES];
+}
+
+void JobSystem::snapshot_job_types(std::vector<JobTypeStats>& out) const {
+    out.clear();
+    if (!job_types_) return;
+    for (std::uint32_t i = 0; i <= MAX_JOB_TYPES; ++i) {
+        const JobTypeSlot& s = job_types_[i];
+        const char* name = i == MAX_JOB_TYPES ? "other" : s.name.load(std::memory_order_acquire);
+        if (!name) continue;
+        JobTypeStats t{name, s.wait.snapshot(), s.run.snapshot()};
+        if (t.run.count == 0) continue;
+        auto it = std::find_if(out.begin(), out.end(), [&](const JobTypeStats& o) { return std::strcmp(o.name, name) == 0; });
+        if (it == out.end()) {
+            out.push_back(t);
+        } else {
+            it->wait.merge(t.wait);
+            it->run.merge(t.run);
+        }
+    }
+    std::sort(out.begin(), out.end(), [](const JobTypeStats& a, const JobTypeStats& b) { return std::strcmp(a.name, b.name) < 0; });
+}
+
+void JobSystem::begin_frame() {
+    const std::uint64_t now = JobTrace::now_ns();
+    const std::uint64_t prev = frame_start_ns_.exchange(now, std::memory_order_relaxed);
+    if (prev && now > prev) frame_period_ns_.store(std::min<std::uint64_t>(now - prev, 250000000ull), std::memory_order_relaxed);
+    if (is_main_thread() && scratch_ && tls_scratch_ == &scratch_[scratch_count_ - 1]) {
+        ScratchArena& a = *tls_scratch_;
+        a.peak.store(a.stack.stats().peak_bytes_in_use, std::memory_order_relaxed);
+        a.stack.reset();
+    }
+}
+
+std::uint64_t JobSystem::frame_deadline(std::uint32_t frames_ahead) const {
+    std::uint64_t start = frame_start_ns_.load(std::memory_order_relaxed);
+    if (!start) start = JobTrace::now_ns();
+    return start + frame_period_ns_.load(std::memory_order_relaxed) * frames_ahead;
+}
+
+std::uint32_t JobSystem::pending_jobs() const {
+    std::uint32_t n = 0;
+    for (const auto& lane : lanes_) n += lane.pending.load(std::memory_order_relaxed);
+    return n;
 }
 
 JobSystem::Stats JobSystem::snapshot_stats() {
     Stats s{};
     s.worker_count = (std::uint32_t)worker_counters_.size();
-    s.pending_high = pending_high_.load(std::memory_order_relaxed);
-    s.pending_normal = pending_norm_.load(std::memory_order_relaxed);
-    s.pending_low = pending_low_.load(std::memory_order_relaxed);
+    s.pending_high = lanes_[(std::size_t)Priority::High].pending.load(std::memory_order_relaxed);
+    s.pending_normal = lanes_[(std::size_t)Priority::Normal].pending.load(std::memory_order_relaxed);
+    s.pending_low = lanes_[(std::size_t)Priority::Low].pending.load(std::memory_order_relaxed);
     s.stall_warnings = stall_warnings_.load(std::memory_order_relaxed);
+    for (const auto& lane : lanes_) s.overflow_pending += lane.overflow_size.load(std::memory_order_relaxed);
+    s.overflow_peak = overflow_peak_.load(std::memory_order_relaxed);
+    s.overflow_events = overflow_events_.load(std::memory_order_relaxed);
+    for (std::size_t i = 0; i < lanes_.size(); ++i) {
+        s.missed_deadlines[i] = lanes_[i].missed.load(std::memory_order_relaxed);
+        s.max_queue_age_us[i] = (float)((double)lanes_[i].max_age_ns.exchange(0, std::memory_order_relaxed) / 1000.0);
+    }
+    s.main_pending = main_pending_.load(std::memory_order_relaxed);
+    s.main_ran = main_ran_.exchange(0, std::memory_order_relaxed);
+    const std::uint64_t lat_sum = main_latency_sum_ns_.exchange(0, std::memory_order_relaxed);
+    s.main_latency_avg_us = s.main_ran ? (float)((double)lat_sum / (double)s.main_ran / 1000.0) : 0.0f;
+    s.main_latency_max_us = (float)((double)main_latency_max_ns_.exchange(0, std::memory_order_relaxed) / 1000.0);
     const std::size_t n = std::min<std::size_t>(worker_counters_.size(), s.worker_utilization.size());
     for (std::size_t i = 0; i < n; ++i) {
         const std::uint64_t busy = worker_counters_[i].busy_ns.exchange(0, std::memory_order_relaxed);
         const std::uint64_t total = worker_counters_[i].total_ns.exchange(0, std::memory_order_relaxed);
         s.worker_utilization[i] = total ? (float)((double)busy * 100.0 / (double)total) : 0.0f;
     }
+    s.scratch_bytes = cfg_.scratch_bytes;
+    for (std::uint32_t i = 0; scratch_ && i < scratch_count_; ++i) s.scratch_peak_bytes = std::max(s.scratch_peak_bytes, scratch_[i].peak.load(std::memory_order_relaxed));
     return s;
 }
 
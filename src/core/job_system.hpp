@@ -2,13 +2,22 @@
 
 #include "core/profile.hpp"
 #include "core/log.hpp"
+#include "core/event_count.hpp"
+#include "core/job_trace.hpp"
+#include "core/latency_histogram.hpp"
+#include "core/mpmc_queue.hpp"
+#include "memory/concurrent_pool.hpp"
+#include "memory/thread_scratch.hpp"
 
 #include <atomic>
 #include <array>
 #include <cstddef>
 #include <cstdint>
-#include <condition_variable>
 #include <chrono>
+#include <deque>
+#include <memory>
+#include <new>
+#include <type_traits>
 #include <mutex>
 #include <thread>
 #include <vector>
@@ -23,12 +32,33 @@ public:
 
     struct Counter;
 
+    // Pooled counter reference. The generation detects handles that outlive their release.
+    struct CounterHandle {
+        std::uint32_t index{};
+        std::uint32_t generation{};
+        explicit operator bool() const { return generation != 0; }
+    };
+
     struct Job {
+        // Captures of the typed submit(lambda) overload live here, so the job carries its own context.
+        // 48 bytes keeps a queue Cell (sequence + Job) within two cache lines.
+        static constexpr std::size_t INLINE_BYTES = 48;
+        static constexpr std::uint8_t FLAG_INLINE = 1u << 0;
+
         JobFn fn{};
         void* data{};
         Counter* counter{};
         Counter* dependency{};
         const char* name{};
+        // Steady-clock ns (JobTrace::now_ns() / frame_deadline()); 0 = best effort. Deadline jobs run
+        // earliest-deadline-first ahead of best-effort jobs of the same priority.
+        std::uint64_t deadline_ns{};
+        std::uint64_t enqueue_ns{};
+        Priority prio{};
+        std::uint8_t flags{};
+        alignas(8) std::byte inline_data[INLINE_BYTES]{};
+
+        void* context() { return (flags & FLAG_INLINE) ? static_cast<void*>(inline_data) : data; }
     };
 
     struct Stats {
@@ -37,28 +67,123 @@ public:
         std::uint32_t pending_normal{};
         std::uint32_t pending_low{};
         std::uint32_t stall_warnings{};
+        std::uint32_t overflow_pending{};
+        std::uint32_t overflow_peak{};
+        std::uint64_t overflow_events{};
+        std::uint32_t main_pending{};
+        std::uint32_t main_ran{};
+        float main_latency_avg_us{};
+        float main_latency_max_us{};
+        std::array<std::uint32_t, 3> missed_deadlines{};
+        std::array<float, 3> max_queue_age_us{};
         std::array<float, 64> worker_utilization{};
+        std::size_t scratch_bytes{};
+        std::size_t scratch_peak_bytes{};
     };
 
+    // One entry per worker arena, then the init() thread's arena last.
+    struct ScratchStats {
+        std::size_t capacity{};
+        std::size_t peak_bytes{};
+    };
+
+    // Cumulative per-name queue-wait and run-time histograms. Diff two snapshots (Snapshot::since) for
+    // a window; jobs without a name are reported as "job".
+    struct JobTypeStats {
+        const char* name{};
+        LatencyHistogram::Snapshot wait;
+        LatencyHistogram::Snapshot run;
+    };
+    static constexpr std::uint32_t MAX_JOB_TYPES = 64;
+
     struct Config {
         std::uint32_t thread_count{};
         std::uint32_t queue_capacity{4096};
         std::uint32_t stall_warn_ms{100};
+        std::uint32_t spin_before_park{512};
+        std::uint32_t trace_events_per_thread{16384};
+        // Linux only: pin workers to one hardware thread per physical core (SMT siblings last) and keep
+        // the init() thread on the first reserved_cores cores. With thread_count == 0 the worker count
+        // becomes the number of unreserved physical cores.
+        bool pin_workers{false};
+        std::uint32_t reserved_cores{1};
+        // A non-empty lane that has not been served for this long is promoted one priority step, and
+        // one more step for each further interval; 0 disables aging.
+        std::uint32_t aging_ms{50};
+        // Per-thread scratch arena behind jobs::scratch(), for workers and the init() thread.
+        std::size_t scratch_bytes{256 * 1024};
     };
 
-    JobSystem() = default;
+    JobSystem();
     JobSystem(const JobSystem&) = delete;
     JobSystem& operator=(const JobSystem&) = delete;
 
-    bool init(const Config& cfg = {});
+    bool init(const Config& cfg);
+    bool init() { return init(Config{}); }
     void shutdown();
 
     void init_counter(Counter& c, std::int32_t initial = 0);
+    // Recyclable counters for code that needs many short-lived ones (one per chunk per stage).
+    // resolve() returns nullptr for stale handles; release_counter() refuses counters still in flight.
+    CounterHandle acquire_counter(std::int32_t initial = 0);
+    Counter* resolve(CounterHandle h);
+    bool release_counter(CounterHandle h);
+    std::uint32_t pooled_counters() const { return counter_pool_live_.load(std::memory_order_relaxed); }
     void submit(JobFn fn, void* data, Priority prio = Priority::Normal, Counter* counter = nullptr, Counter* dependency = nullptr, const char* name = nullptr);
+    // Uses job.counter / job.dependency / job.deadline_ns as given.
+    void submit(const Job& job, Priority prio = Priority::Normal);
+
+    // Stores the closure inside the Job itself: no context object to keep alive and no allocation.
+    // Captures must fit Job::INLINE_BYTES and be trivially copyable (pointers, references, PODs),
+    // because jobs are moved through the queues by plain copies and never destroyed.
+    template <class F>
+        requires std::is_invocable_v<std::decay_t<F>&>
+    void submit(F&& fn, Priority prio = Priority::Normal, Counter* counter = nullptr, Counter* dependency = nullptr, const char* name = nullptr) {
+        using Fn = std::decay_t<F>;
+        static_assert(sizeof(Fn) <= Job::INLINE_BYTES, "JobSystem::submit: closure too large for Job inline storage; capture a pointer instead");
+        static_assert(alignof(Fn) <= 8, "JobSystem::submit: closure over-aligned for Job inline storage");
+        static_assert(std::is_trivially_copyable_v<Fn> && std::is_trivially_destructible_v<Fn>, "JobSystem::submit: closure must be trivially copyable and destructible");
+        Job j{};
+        j.fn = +[](void* p) { (*static_cast<Fn*>(p))(); };
+        ::new (static_cast<void*>(j.inline_data)) Fn(std::forward<F>(fn));
+        j.flags = Job::FLAG_INLINE;
+        j.counter = counter;
+        j.dependency = dependency;
+        j.name = name;
+        submit(j, prio);
+    }
     void submit_batch(const Job* jobs, std::size_t n, Priority prio = Priority::Normal, Counter* counter = nullptr, Counter* dependency = nullptr);
     void wait(Counter& c);
 
+    // Jobs that must run on the thread that called init() (Vulkan uploads, window calls). They only
+    // run inside run_main_thread_jobs() or a wait() issued from that thread; counters gate them on
+    // worker jobs and vice versa exactly like regular jobs.
+    void submit_main(JobFn fn, void* data, Counter* counter = nullptr, Counter* dependency = nullptr, const char* name = nullptr);
+    // Runs queued main-thread jobs until the queue is empty or budget_ns has elapsed (at least one job
+    // runs if any is queued). Returns the number of jobs run.
+    std::uint32_t run_main_thread_jobs(std::uint64_t budget_ns);
+    bool is_main_thread() const { return std::this_thread::get_id() == main_thread_; }
+    // The system whose worker is running the calling thread, or the one this thread init()ed.
+    static JobSystem* current() { return tls_current_; }
+    // The calling thread's scratch arena (mem::thread_scratch(), installed per worker and on the
+    // init() thread). Everything a job allocates from it is popped when the job returns; allocations
+    // made on the init() thread outside jobs live until begin_frame().
+    static mem::StackAllocator& scratch() { return mem::thread_scratch(); }
+
+    // Call once per frame; frame_deadline(n) is the expected end of the n-th frame from now, based on
+    // the last measured frame period.
+    void begin_frame();
+    std::uint64_t frame_deadline(std::uint32_t frames_ahead = 1) const;
+
+    std::uint32_t worker_count() const { return (std::uint32_t)workers_.size(); }
+    std::uint32_t pending_jobs() const;
     Stats snapshot_stats();
+    // Merges entries whose names compare equal; names beyond MAX_JOB_TYPES are reported as "other".
+    void snapshot_job_types(std::vector<JobTypeStats>& out) const;
+    void snapshot_scratch(std::vector<ScratchStats>& out) const;
+
+    JobTrace& trace() { return trace_; }
+    const JobTrace& trace() const { return trace_; }
 
 private:
     struct alignas(64) WorkerCounters {
@@ -79,64 +204,70 @@ private:
         WorkerCounters& operator=(WorkerCounters&& o) noexcept { return (*this = o); }
     };
 
-    template <class T>
-    class MpmcQueue {
-    public:
-        bool init(std::uint32_t capacity_pow2);
-        bool enqueue(const T& v);
-        bool dequeue(T& out);
-        void reset();
-        std::uint32_t capacity() const { return mask_ ? (mask_ + 1u) : 0u; }
-
-    private:
-        struct alignas(64) Cell {
-            std::atomic<std::size_t> seq{};
-            T data{};
-
-            Cell() = default;
-            Cell(const Cell& o) {
-                seq.store(o.seq.load(std::memory_order_relaxed), std::memory_order_relaxed);
-                data = o.data;
-            }
-            Cell& operator=(const Cell& o) {
-                seq.store(o.seq.load(std::memory_order_relaxed), std::memory_order_relaxed);
-                data = o.data;
-                return *this;
-            }
-            Cell(Cell&& o) noexcept : Cell(o) {}
-            Cell& operator=(Cell&& o) noexcept { return (*this = o); }
-        };
-
-        std::vector<Cell> buf_;
-        std::size_t mask_{};
-        alignas(64) std::atomic<std::size_t> head_{0};
-        alignas(64) std::atomic<std::size_t> tail_{0};
+    // One per priority. The ring is the fast path; when it is full, jobs spill into a mutex-protected
+    // FIFO instead of blocking the submitter. While anything sits in overflow, new jobs follow it there
+    // so ring entries are always older and dequeue can drain ring first. Jobs with a deadline go to a
+    // min-heap that is served before either.
+    struct Lane {
+        MpmcQueue<Job> ring;
+        std::mutex overflow_m;
+        std::deque<Job> overflow;
+        std::atomic<std::uint32_t> overflow_size{0};
+        std::mutex deadline_m;
+        std::vector<Job> deadline_heap;
+        std::atomic<std::uint32_t> deadline_size{0};
+        std::atomic<std::uint32_t> pending{0};
+        std::atomic<std::uint64_t> served_ns{0};
+        std::atomic<std::uint64_t> max_age_ns{0};
+        std::atomic<std::uint32_t> missed{0};
     };
 
     struct Continuation {
         Job job{};
         Priority prio{};
+        bool main_thread{};
         Continuation* next{};
     };
 
 public:
     struct Counter {
+        // state: [flags:16 | waiters:16 | remaining:32]. The final done() zeroes the count and sets
+        // FINISHING in one CAS and clears it once continuations and wakes are out, so wait() never
+        // returns (and the counter is never recycled) while the completing thread still touches it.
+        static constexpr std::uint64_t COUNT_MASK = 0xffffffffull;
+        static constexpr std::uint64_t WAITER = 1ull << 32;
+        static constexpr std::uint64_t WAITER_MASK = 0xffffull << 32;
+        static constexpr std::uint64_t FINISHING = 1ull << 48;
+
         JobSystem* js{};
-        std::atomic<std::int32_t> remaining{0};
+        std::atomic<std::uint64_t> state{0};
         std::atomic<Continuation*> conts{nullptr};
-        std::mutex wait_m;
-        std::condition_variable wait_cv;
+        std::uint32_t id{};
+        std::atomic<std::uint32_t> generation{0};
 
         void add(std::int32_t n);
         void done();
-        bool is_done() const { return remaining.load(std::memory_order_acquire) <= 0; }
+        bool is_done() const { return (std::int32_t)(std::uint32_t)(state.load(std::memory_order_acquire) & COUNT_MASK) <= 0; }
+        bool is_settled() const {
+            const std::uint64_t v = state.load(std::memory_order_acquire);
+            return (std::int32_t)(std::uint32_t)(v & COUNT_MASK) <= 0 && !(v & FINISHING);
+        }
+        std::uint32_t waiters() const { return (std::uint32_t)((state.load(std::memory_order_relaxed) & WAITER_MASK) >> 32); }
     };
 
 private:
     bool enqueue_job(const Job& j, Priority p);
+    void enqueue_jobs(Job* jobs, std::size_t n, Priority p);
+    bool dequeue_lane(Lane& lane, Job& out, std::uint64_t now);
+    void enqueue_main(const Job& j);
+    bool try_run_main_one();
+    void defer(Counter& dependency, const Job& j, Priority p, bool main_thread);
     bool try_dequeue(Job& out);
     bool try_run_one();
+    std::uint64_t run_job(Job& j, std::uint32_t trace_slot);
     void wake_one();
+    void wake_blocked_waiter();
+    bool spin_for_work(const Counter* c) const;
     void worker_main(std::uint32_t worker_index);
     void schedule_continuations(Counter& c);
 
@@ -144,24 +275,67 @@ private:
     std::atomic<bool> running_{false};
     std::atomic<bool> stop_{false};
 
-    MpmcQueue<Job> q_high_;
-    MpmcQueue<Job> q_norm_;
-    MpmcQueue<Job> q_low_;
+    struct JobTypeSlot {
+        std::atomic<const char*> name{nullptr};
+        LatencyHistogram wait;
+        LatencyHistogram run;
+    };
+    JobTypeSlot& job_type_slot(const char* name);
 
-    std::atomic<std::uint32_t> pending_high_{0};
-    std::atomic<std::uint32_t> pending_norm_{0};
-    std::atomic<std::uint32_t> pending_low_{0};
+    std::array<Lane, 3> lanes_;
+    std::unique_ptr<JobTypeSlot[]> job_types_;
 
     std::atomic<std::uint32_t> stall_warnings_{0};
-
-    std::mutex wake_m_;
-    std::condition_variable wake_cv_;
+    std::atomic<std::uint32_t> overflow_peak_{0};
+    std::atomic<std::uint64_t> overflow_events_{0};
+    std::atomic<std::uint64_t> frame_start_ns_{0};
+    std::atomic<std::uint64_t> frame_period_ns_{16666667};
+    std::atomic<std::uint32_t> next_counter_id_{0};
+
+    std::thread::id main_thread_{};
+    std::mutex main_m_;
+    std::deque<Job> main_q_;
+    std::atomic<std::uint32_t> main_pending_{0};
+    std::atomic<std::uint32_t> main_ran_{0};
+    std::atomic<std::uint64_t> main_latency_sum_ns_{0};
+    std::atomic<std::uint64_t> main_latency_max_ns_{0};
+
+    // Idle workers park on parker_ and are woken by job arrival. Threads blocked in wait() park on
+    // waiter_parker_: counter completions, main-thread jobs and work no idle worker can take wake them.
+    EventCount parker_;
+    EventCount waiter_parker_;
+    std::atomic<std::uint32_t> main_waiters_{0};
+    mem::ConcurrentPool continuations_;
+
+    static constexpr std::uint32_t COUNTER_BLOCK = 1024;
+    static constexpr std::uint32_t COUNTER_BLOCKS = 256;
+    std::mutex counter_pool_m_;
+    std::unique_ptr<Counter[]> counter_blocks_[COUNTER_BLOCKS];
+    std::atomic<std::uint32_t> counter_block_count_{0};
+    std::vector<std::uint32_t> counter_free_;
+    std::atomic<std::uint32_t> counter_pool_live_{0};
+
+    struct ScratchArena {
+        std::unique_ptr<std::byte[]> memory;
+        mem::StackAllocator stack;
+        std::atomic<std::size_t> peak{0};
+    };
+    std::unique_ptr<ScratchArena[]> scratch_;
+    std::uint32_t scratch_count_{};
 
     std::vector<std::thread> workers_;
     std::vector<WorkerCounters> worker_counters_;
+    std::vector<std::uint32_t> worker_cpus_;
+    JobTrace trace_;
 
     static thread_local bool tls_is_worker_;
+    static thread_local const JobSystem* tls_owner_;
+    static thread_local JobSystem* tls_current_;
+    static thread_local std::uint32_t tls_worker_index_;
+    static thread_local ScratchArena* tls_scratch_;
 };
 
+inline mem::StackAllocator& scratch() { return JobSystem::scratch(); }
+
 }
 
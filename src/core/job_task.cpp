@@ -0,0 +1,166 @@
+#include "job_task.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace cube::jobs {
+
+namespace {
+
+constexpr std::size_t CLASS_COUNT = 6;
+constexpr std::array<std::size_t, CLASS_COUNT> CLASS_BYTES{128, 256, 512, 1024, 2048, 4096};
+constexpr std::size_t LOCAL_MAX = 64;
+constexpr std::size_t BATCH = LOCAL_MAX / 2;
+constexpr std::size_t MAX_GROW = 1024;
+
+std::atomic<std::uint64_t> g_heap_allocs{0};
+std::atomic<std::uint64_t> g_pooled_allocs{0};
+std::atomic<std::int64_t> g_live{0};
+std::array<std::atomic<std::int64_t>, CLASS_COUNT> g_class_live{};
+std::atomic<std::uint32_t> g_caches{0};
+
+int class_of(std::size_t bytes) {
+    for (std::size_t i = 0; i < CLASS_COUNT; ++i) if (bytes <= CLASS_BYTES[i]) return (int)i;
+    return -1;
+}
+
+struct SharedPool {
+    std::mutex m;
+    std::array<std::vector<void*>, CLASS_COUNT> free;
+    std::array<std::size_t, CLASS_COUNT> owned{}; // frames ever taken from the heap, per class
+};
+
+SharedPool& shared() {
+    static SharedPool* p = new SharedPool();  // leaked: thread caches may flush into it during exit
+    return *p;
+}
+
+struct ThreadCache {
+    std::array<std::vector<void*>, CLASS_COUNT> free;
+
+    ThreadCache() {
+        for (auto& f : free) f.reserve(LOCAL_MAX + 1);
+        g_caches.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    ~ThreadCache() {
+        flush();
+        g_caches.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    void flush() {
+        auto& sp = shared();
+        std::scoped_lock lk(sp.m);
+        for (std::size_t i = 0; i < CLASS_COUNT; ++i) {
+            sp.free[i].insert(sp.free[i].end(), free[i].begin(), free[i].end());
+            free[i].clear();
+        }
+    }
+
+    bool empty() const {
+        for (const auto& f : free) if (!f.empty()) return false;
+        return true;
+    }
+};
+
+ThreadCache& cache() {
+    thread_local ThreadCache c;
+    return c;
+}
+
+}
+
+namespace detail {
+
+void* task_frame_alloc(std::size_t bytes) {
+    g_live.fetch_add(1, std::memory_order_relaxed);
+    const int cls = class_of(bytes);
+    if (cls < 0) {
+        g_heap_allocs.fetch_add(1, std::memory_order_relaxed);
+        return ::operator new(bytes);
+    }
+    g_class_live[(std::size_t)cls].fetch_add(1, std::memory_order_relaxed);
+    auto& local = cache().free[(std::size_t)cls];
+    bool grew = false;
+    if (local.empty()) {
+        auto& sp = shared();
+        std::scoped_lock lk(sp.m);
+        auto& g = sp.free[(std::size_t)cls];
+        if (g.empty()) {
+            // Free frames of a class may all sit in other threads' caches (up to LOCAL_MAX each; the
+            // init() thread runs jobs but never parks to flush). Grow so the class covers what is live
+            // plus every cache's worth, and at least double it, so a round with more frames live than
+            // the warm-up rounds had still finds them pooled.
+            const std::size_t owned = sp.owned[(std::size_t)cls];
+            const std::size_t live = (std::size_t)std::max<std::int64_t>(0, g_class_live[(std::size_t)cls].load(std::memory_order_relaxed));
+            const std::size_t target = live + (std::size_t)g_caches.load(std::memory_order_relaxed) * LOCAL_MAX + BATCH;
+            std::size_t grow = std::clamp(owned, BATCH, MAX_GROW);
+            if (owned + grow < target) grow = target - owned;
+            g.reserve(grow);
+            for (std::size_t i = 0; i < grow; ++i) {
+                g.push_back(::operator new(CLASS_BYTES[(std::size_t)cls]));
+                sp.owned[(std::size_t)cls]++;
+            }
+            g_heap_allocs.fetch_add(grow, std::memory_order_relaxed);
+            grew = true;
+        }
+        const std::size_t take = std::min(BATCH, g.size());
+        local.insert(local.end(), g.end() - (std::ptrdiff_t)take, g.end());
+        g.resize(g.size() - take);
+    }
+    if (!grew) g_pooled_allocs.fetch_add(1, std::memory_order_relaxed);
+    void* p = local.back();
+    local.pop_back();
+    return p;
+}
+
+void task_frame_free(void* p, std::size_t bytes) {
+    if (!p) return;
+    g_live.fetch_sub(1, std::memory_order_relaxed);
+    const int cls = class_of(bytes);
+    if (cls < 0) {
+        ::operator delete(p);
+        return;
+    }
+    g_class_live[(std::size_t)cls].fetch_sub(1, std::memory_order_relaxed);
+    auto& local = cache().free[(std::size_t)cls];
+    local.push_back(p);
+    if (local.size() > LOCAL_MAX) {
+        auto& sp = shared();
+        std::scoped_lock lk(sp.m);
+        auto& g = sp.free[(std::size_t)cls];
+        g.insert(g.end(), local.end() - (std::ptrdiff_t)BATCH, local.end());
+        local.resize(local.size() - BATCH);
+    }
+}
+
+void flush_task_frame_cache() {
+    ThreadCache& c = cache();
+    if (!c.empty()) c.flush();
+}
+
+void resume_job(void* handle_address) {
+    std::coroutine_handle<>::from_address(handle_address).resume();
+}
+
+Detached run_detached(JobSystem& js, Task<void> task, JobSystem::Counter* done, Priority prio) {
+    co_await schedule(js, prio);
+    co_await std::move(task);
+    if (done) done->done();
+}
+
+}
+
+TaskFrameStats task_frame_stats() {
+    TaskFrameStats s{};
+    s.heap_allocs = g_heap_allocs.load(std::memory_order_relaxed);
+    s.pooled_allocs = g_pooled_allocs.load(std::memory_order_relaxed);
+    const std::int64_t live = g_live.load(std::memory_order_relaxed);
+    s.live_frames = live > 0 ? (std::uint64_t)live : 0;
+    return s;
+}
+
+}
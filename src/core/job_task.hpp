@@ -0,0 +1,181 @@
+#pragma once
+
+#include "core/job_system.hpp"
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace cube::jobs {
+
+namespace detail {
+
+// Coroutine frames come from per-thread size-class free lists backed by a shared pool that doubles a
+// class whenever it runs dry, so a steady stream of tasks stops touching the heap once it has warmed up.
+void* task_frame_alloc(std::size_t bytes);
+void task_frame_free(void* p, std::size_t bytes);
+// Returns the calling thread's cached frames to the shared pool. Workers call it before parking, so
+// frames freed on a worker stay reachable from the thread that spawns the next batch.
+void flush_task_frame_cache();
+
+void resume_job(void* handle_address);
+
+template <class T>
+struct TaskResult {
+    alignas(T) unsigned char storage[sizeof(T)];
+    bool has_value{false};
+
+    template <class U>
+    void return_value(U&& v) {
+        ::new (static_cast<void*>(storage)) T(std::forward<U>(v));
+        has_value = true;
+    }
+    T take() { return std::move(*std::launder(reinterpret_cast<T*>(storage))); }
+    ~TaskResult() { if (has_value) std::launder(reinterpret_cast<T*>(storage))->~T(); }
+};
+
+template <>
+struct TaskResult<void> {
+    void return_void() {}
+    void take() {}
+};
+
+struct FramePooled {
+    static void* operator new(std::size_t bytes) { return task_frame_alloc(bytes); }
+    static void operator delete(void* p, std::size_t bytes) { task_frame_free(p, bytes); }
+};
+
+}
+
+struct TaskFrameStats {
+    std::uint64_t heap_allocs{}; // frames taken from the heap; an empty size class grows by a batch or more
+    std::uint64_t pooled_allocs{};
+    std::uint64_t live_frames{};
+};
+TaskFrameStats task_frame_stats();
+
+// Lazily started coroutine. Awaiting a Task starts it and resumes the awaiter when it finishes (via
+// symmetric transfer, no extra job). Use spawn() to start a top-level Task<void> on the job system.
+template <class T = void>
+class [[nodiscard]] Task {
+public:
+    struct promise_type : detail::FramePooled, detail::TaskResult<T> {
+        std::coroutine_handle<> continuation{};
+        std::exception_ptr error{};
+
+        Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        auto final_suspend() noexcept {
+            struct Final {
+                bool await_ready() noexcept { return false; }
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                    auto next = h.promise().continuation;
+                    return next ? next : std::noop_coroutine();
+                }
+                void await_resume() noexcept {}
+            };
+            return Final{};
+        }
+        void unhandled_exception() { error = std::current_exception(); }
+    };
+
+    Task() = default;
+    Task(Task&& o) noexcept : h_(std::exchange(o.h_, {})) {}
+    Task& operator=(Task&& o) noexcept {
+        if (this != &o) {
+            if (h_) h_.destroy();
+            h_ = std::exchange(o.h_, {});
+        }
+        return *this;
+    }
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+    ~Task() { if (h_) h_.destroy(); }
+
+    bool valid() const { return (bool)h_; }
+
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            std::coroutine_handle<promise_type> h;
+            bool await_ready() noexcept { return !h || h.done(); }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept {
+                h.promise().continuation = awaiting;
+                return h;
+            }
+            T await_resume() {
+                if (h.promise().error) std::rethrow_exception(h.promise().error);
+                return h.promise().take();
+            }
+        };
+        return Awaiter{h_};
+    }
+
+private:
+    explicit Task(std::coroutine_handle<promise_type> h) : h_(h) {}
+    std::coroutine_handle<promise_type> h_{};
+};
+
+// co_await js.schedule(prio) equivalent that does not need JobSystem to know about coroutines.
+struct ScheduleAwaiter {
+    JobSystem* js;
+    Priority prio;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) const { js->submit(&detail::resume_job, h.address(), prio, nullptr, nullptr, "task"); }
+    void await_resume() const noexcept {}
+};
+
+struct CounterAwaiter {
+    JobSystem::Counter* counter;
+    Priority prio;
+    bool await_ready() const noexcept { return counter->is_done(); }
+    void await_suspend(std::coroutine_handle<> h) const { counter->js->submit(&detail::resume_job, h.address(), prio, nullptr, counter, "task"); }
+    void await_resume() const noexcept {}
+};
+
+struct MainThreadAwaiter {
+    JobSystem* js;
+    bool await_ready() const noexcept { return js->is_main_thread(); }
+    void await_suspend(std::coroutine_handle<> h) const { js->submit_main(&detail::resume_job, h.address(), nullptr, nullptr, "task"); }
+    void await_resume() const noexcept {}
+};
+
+// `co_await counter` suspends until the counter reaches zero and resumes on a worker. The counter
+// must have been initialised with JobSystem::init_counter.
+inline CounterAwaiter operator co_await(JobSystem::Counter& c) { return CounterAwaiter{&c, Priority::Normal}; }
+inline CounterAwaiter resume_after(JobSystem::Counter& c, Priority prio) { return CounterAwaiter{&c, prio}; }
+
+inline ScheduleAwaiter schedule(JobSystem& js, Priority prio = Priority::Normal) { return ScheduleAwaiter{&js, prio}; }
+
+// Resumes on the thread that called JobSystem::init(); JobSystem::current() picks the system the
+// calling job belongs to.
+inline MainThreadAwaiter main_thread() { return MainThreadAwaiter{JobSystem::current()}; }
+inline MainThreadAwaiter main_thread(JobSystem& js) { return MainThreadAwaiter{&js}; }
+
+namespace detail {
+
+struct Detached {
+    struct promise_type : FramePooled {
+        Detached get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+Detached run_detached(JobSystem& js, Task<void> task, JobSystem::Counter* done, Priority prio);
+
+}
+
+// Starts `task` on a worker and signals `done` (if given) when it finishes. The task owns its frame;
+// nothing has to outlive it except what it references.
+inline void spawn(JobSystem& js, Task<void> task, JobSystem::Counter* done = nullptr, Priority prio = Priority::Normal) {
+    if (done) done->add(1);
+    detail::run_detached(js, std::move(task), done, prio);
+}
+
+}
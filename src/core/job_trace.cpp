@@ -0,0 +1,147 @@
+#include "job_trace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace cube::jobs {
+
+namespace {
+
+std::atomic<std::uint32_t> g_trace_instances{0};
+
+struct ExternalSlotCache {
+    std::uint32_t instance{};
+    std::uint32_t slot{~0u};
+};
+
+thread_local ExternalSlotCache tls_external{};
+
+void write_json_string(std::FILE* f, const char* s) {
+    std::fputc('"', f);
+    for (; s && *s; ++s) {
+        const char c = *s;
+        if (c == '"' || c == '\\') { std::fputc('\\', f); std::fputc(c, f); }
+        else if ((unsigned char)c < 0x20) std::fprintf(f, "\\u%04x", (unsigned)(unsigned char)c);
+        else std::fputc(c, f);
+    }
+    std::fputc('"', f);
+}
+
+}
+
+std::uint64_t JobTrace::now_ns() {
+    return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void JobTrace::init(std::uint32_t worker_slots, std::uint32_t events_per_thread) {
+    shutdown();
+    if (events_per_thread < 2) return;
+    std::uint32_t cap = 1;
+    while ((cap << 1) && (cap << 1) <= events_per_thread) cap <<= 1;
+
+    const std::uint32_t slots = worker_slots + EXTERNAL_SLOTS;
+    rings_storage_ = std::make_unique<Ring[]>(slots);
+    rings_.resize(slots);
+    for (std::uint32_t i = 0; i < slots; ++i) {
+        rings_storage_[i].events = std::make_unique<Slot[]>(cap);
+        rings_[i] = &rings_storage_[i];
+    }
+    worker_slots_ = worker_slots;
+    mask_ = cap - 1u;
+    instance_ = g_trace_instances.fetch_add(1, std::memory_order_relaxed) + 1u;
+    next_external_.store(0, std::memory_order_relaxed);
+}
+
+void JobTrace::shutdown() {
+    rings_.clear();
+    rings_storage_.reset();
+    worker_slots_ = 0;
+    mask_ = 0;
+    instance_ = 0;
+}
+
+std::uint32_t JobTrace::external_slot() {
+    if (!enabled()) return ~0u;
+    if (tls_external.instance == instance_) return tls_external.slot;
+    const std::uint32_t i = next_external_.fetch_add(1, std::memory_order_relaxed);
+    tls_external.instance = instance_;
+    tls_external.slot = (i < EXTERNAL_SLOTS) ? (worker_slots_ + i) : ~0u;
+    return tls_external.slot;
+}
+
+void JobTrace::record(std::uint32_t slot, const TraceEvent& e) {
+    if (slot >= rings_.size()) return;
+    Ring& r = *rings_[slot];
+    const std::uint64_t h = r.head.load(std::memory_order_relaxed);
+    Slot& s = r.events[h & mask_];
+    s.seq.store(2 * h + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    s.name.store(e.name, std::memory_order_relaxed);
+    s.start_ns.store(e.start_ns, std::memory_order_relaxed);
+    s.end_ns.store(e.end_ns, std::memory_order_relaxed);
+    s.queue_ns.store(e.queue_ns, std::memory_order_relaxed);
+    s.counter_id.store(e.counter_id, std::memory_order_relaxed);
+    s.seq.store(2 * h + 2, std::memory_order_release);
+    r.head.store(h + 1, std::memory_order_release);
+}
+
+void JobTrace::collect(std::uint64_t since_ns, std::vector<TraceEvent>& out) const {
+    const std::uint64_t cap = (std::uint64_t)mask_ + 1u;
+    for (std::uint32_t t = 0; t < (std::uint32_t)rings_.size(); ++t) {
+        const Ring* r = rings_[t];
+        const std::uint64_t head = r->head.load(std::memory_order_acquire);
+        const std::uint64_t first = head > cap ? head - cap : 0;
+        for (std::uint64_t i = first; i < head; ++i) {
+            // Keep event i only if its slot held it, complete, both before and after the copy.
+            const Slot& s = r->events[i & mask_];
+            const std::uint64_t seq = s.seq.load(std::memory_order_acquire);
+            if (seq != 2 * i + 2) continue;
+            TraceEvent e{};
+            e.name = s.name.load(std::memory_order_relaxed);
+            e.start_ns = s.start_ns.load(std::memory_order_relaxed);
+            e.end_ns = s.end_ns.load(std::memory_order_relaxed);
+            e.queue_ns = s.queue_ns.load(std::memory_order_relaxed);
+            e.counter_id = s.counter_id.load(std::memory_order_relaxed);
+            e.thread = t;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.seq.load(std::memory_order_relaxed) != seq) continue;
+            out.push_back(e);
+        }
+    }
+    out.erase(std::remove_if(out.begin(), out.end(), [since_ns](const TraceEvent& e) { return e.end_ns < since_ns; }), out.end());
+    std::sort(out.begin(), out.end(), [](const TraceEvent& a, const TraceEvent& b) { return a.start_ns < b.start_ns; });
+}
+
+bool JobTrace::write_chrome_json(const std::string& path, double last_seconds) const {
+    std::vector<TraceEvent> ev;
+    const std::uint64_t now = now_ns();
+    const std::uint64_t window = (std::uint64_t)(std::max(0.0, last_seconds) * 1e9);
+    collect(window < now ? now - window : 0, ev);
+
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    const std::uint64_t origin = ev.empty() ? now : ev.front().start_ns;
+    std::fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    bool first = true;
+    for (std::uint32_t i = 0; i < (std::uint32_t)rings_.size(); ++i) {
+        char tname[32];
+        if (i < worker_slots_) std::snprintf(tname, sizeof(tname), "job worker %u", i);
+        else std::snprintf(tname, sizeof(tname), "external %u", i - worker_slots_);
+        std::fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s\"}}", first ? "" : ",\n", i, tname);
+        first = false;
+    }
+    for (const TraceEvent& e : ev) {
+        std::fprintf(f, ",\n{\"name\":");
+        write_json_string(f, e.name ? e.name : "job");
+        std::fprintf(f, ",\"cat\":\"job\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"counter\":%u,\"queue_us\":%.3f}}",
+                     e.thread, (double)(e.start_ns - origin) / 1000.0, (double)(e.end_ns - e.start_ns) / 1000.0,
+                     e.counter_id, (double)e.queue_ns / 1000.0);
+    }
+    std::fprintf(f, "\n]}\n");
+    const bool ok = std::ferror(f) == 0;
+    std::fclose(f);
+    return ok;
+}
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace cube::jobs {
+
+struct TraceEvent {
+    const char* name{};
+    std::uint64_t start_ns{};
+    std::uint64_t end_ns{};
+    std::uint64_t queue_ns{};
+    std::uint32_t counter_id{};
+    std::uint32_t thread{};
+};
+
+// Always-on job timeline. Every thread that runs jobs owns a fixed ring of events it alone writes;
+// readers copy a ring and drop anything the writer lapped while they were copying, detected with a
+// per-slot sequence number. Names are stored as pointers, so job names must be string literals or
+// otherwise outlive the trace.
+class JobTrace {
+public:
+    static constexpr std::uint32_t EXTERNAL_SLOTS = 4;
+
+    JobTrace() = default;
+    JobTrace(const JobTrace&) = delete;
+    JobTrace& operator=(const JobTrace&) = delete;
+
+    // worker_slots rings for job workers plus EXTERNAL_SLOTS for other threads that help in wait().
+    // events_per_thread is rounded down to a power of two; 0 disables recording.
+    void init(std::uint32_t worker_slots, std::uint32_t events_per_thread);
+    void shutdown();
+    bool enabled() const { return !rings_.empty(); }
+
+    // Slot for the calling thread when it is not a worker; ~0u if every external slot is taken.
+    std::uint32_t external_slot();
+    void record(std::uint32_t slot, const TraceEvent& e);
+
+    // Events that ended at or after since_ns, sorted by start time.
+    void collect(std::uint64_t since_ns, std::vector<TraceEvent>& out) const;
+    bool write_chrome_json(const std::string& path, double last_seconds) const;
+
+    static std::uint64_t now_ns();
+
+private:
+    // Event i of a ring lives in slot i & mask_. seq is 2i+1 while the owner writes it and 2i+2 once
+    // it is complete; the fields are relaxed atomics so a reader racing the owner is not a data race.
+    struct Slot {
+        std::atomic<std::uint64_t> seq{0};
+        std::atomic<const char*> name{};
+        std::atomic<std::uint64_t> start_ns{};
+        std::atomic<std::uint64_t> end_ns{};
+        std::atomic<std::uint64_t> queue_ns{};
+        std::atomic<std::uint32_t> counter_id{};
+    };
+
+    struct alignas(64) Ring {
+        std::unique_ptr<Slot[]> events;
+        std::atomic<std::uint64_t> head{0};
+    };
+
+    std::unique_ptr<Ring[]> rings_storage_;
+    std::vector<Ring*> rings_;
+    std::uint32_t worker_slots_{};
+    std::uint32_t mask_{};
+    std::uint32_t instance_{};
+    std::atomic<std::uint32_t> next_external_{0};
+};
+
+}
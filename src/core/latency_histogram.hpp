@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+
+namespace cube::jobs {
+
+// Lock-free log-linear histogram of nanosecond values: 8 linear sub-buckets per power of two, so any
+// reported percentile is within 12.5% of the true value. Writers only do relaxed fetch_adds; readers
+// take cumulative snapshots and diff them, so no reader ever resets what another reader sees.
+class LatencyHistogram {
+public:
+    static constexpr std::uint32_t SUB_BITS = 3;
+    static constexpr std::uint32_t SUB = 1u << SUB_BITS;
+    static constexpr std::uint32_t BUCKETS = (64 - SUB_BITS + 1) * SUB;
+
+    struct Snapshot {
+        std::array<std::uint64_t, BUCKETS> buckets{};
+        std::uint64_t count{};
+        std::uint64_t sum_ns{};
+        std::uint64_t max_ns{};
+
+        // Midpoint of the bucket holding the q-th value (q in [0,1]), clamped to max_ns.
+        std::uint64_t percentile(double q) const {
+            if (!count) return 0;
+            std::uint64_t rank = (std::uint64_t)(q * (double)count);
+            if (rank >= count) rank = count - 1;
+            std::uint64_t seen = 0;
+            for (std::uint32_t b = 0; b < BUCKETS; ++b) {
+                seen += buckets[b];
+                if (seen > rank) {
+                    const std::uint64_t lo = bucket_floor(b);
+                    const std::uint64_t hi = b + 1 < BUCKETS ? bucket_floor(b + 1) : lo;
+                    const std::uint64_t mid = lo + (hi - lo) / 2;
+                    return mid < max_ns ? mid : max_ns;
+                }
+            }
+            return max_ns;
+        }
+        double mean_ns() const { return count ? (double)sum_ns / (double)count : 0.0; }
+
+        // Window between two cumulative snapshots. The exact max is not recoverable, so it becomes the
+        // top of the highest bucket that gained samples (capped by the cumulative max).
+        Snapshot since(const Snapshot& older) const {
+            Snapshot d{};
+            std::int32_t top = -1;
+            for (std::uint32_t b = 0; b < BUCKETS; ++b) {
+                d.buckets[b] = buckets[b] - older.buckets[b];
+                if (d.buckets[b]) top = (std::int32_t)b;
+            }
+            d.count = count - older.count;
+            d.sum_ns = sum_ns - older.sum_ns;
+            if (top >= 0) {
+                const std::uint64_t hi = (std::uint32_t)top + 1 < BUCKETS ? bucket_floor((std::uint32_t)top + 1) - 1 : max_ns;
+                d.max_ns = hi < max_ns ? hi : max_ns;
+            }
+            return d;
+        }
+
+        void merge(const Snapshot& o) {
+            for (std::uint32_t b = 0; b < BUCKETS; ++b) buckets[b] += o.buckets[b];
+            count += o.count;
+            sum_ns += o.sum_ns;
+            if (o.max_ns > max_ns) max_ns = o.max_ns;
+        }
+    };
+
+    static std::uint32_t bucket_of(std::uint64_t v) {
+        if (v < SUB) return (std::uint32_t)v;
+        const std::uint32_t e = 63u - (std::uint32_t)std::countl_zero(v);
+        const std::uint32_t sub = (std::uint32_t)(v >> (e - SUB_BITS)) & (SUB - 1u);
+        return (e - SUB_BITS + 1u) * SUB + sub;
+    }
+
+    static std::uint64_t bucket_floor(std::uint32_t b) {
+        if (b < SUB) return b;
+        const std::uint32_t e = b / SUB + SUB_BITS - 1u;
+        return ((std::uint64_t)SUB + (b % SUB)) << (e - SUB_BITS);
+    }
+
+    void record(std::uint64_t ns) {
+        buckets_[bucket_of(ns)].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(ns, std::memory_order_relaxed);
+        std::uint64_t m = max_.load(std::memory_order_relaxed);
+        while (ns > m && !max_.compare_exchange_weak(m, ns, std::memory_order_relaxed)) {}
+    }
+
+    Snapshot snapshot() const {
+        Snapshot s{};
+        for (std::uint32_t b = 0; b < BUCKETS; ++b) s.buckets[b] = buckets_[b].load(std::memory_order_relaxed);
+        s.count = 0;
+        for (std::uint32_t b = 0; b < BUCKETS; ++b) s.count += s.buckets[b];
+        s.sum_ns = sum_.load(std::memory_order_relaxed);
+        s.max_ns = max_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    std::array<std::atomic<std::uint64_t>, BUCKETS> buckets_{};
+    std::atomic<std::uint64_t> sum_{0};
+    std::atomic<std::uint64_t> max_{0};
+};
+
+}
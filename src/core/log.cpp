@@ -1,18 +1,99 @@
 #include "log.hpp"
+#include "event_count.hpp"
+#include "mpmc_queue.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cstdio>
+#include <cstring>
 #include <mutex>
+#include <thread>
+#include <unordered_map>
 
 namespace cube::log {
 
+namespace detail {
+std::atomic<unsigned char> g_level_mask{0xFF};
+}
+
 namespace {
 
+constexpr std::size_t RECORD_PAYLOAD = 448;
+
+// Fixed-size queue record: the call site's static strings by pointer plus the encoded arguments (or
+// message text when fmt is null). Payloads that do not fit inline live on the heap and the pointer
+// travels with the record; whoever takes the record out of circulation frees it.
+struct Record {
+    std::int64_t time_ms{};
+    const char* category{};
+    const char* file{};
+    const char* fmt{};
+    std::byte* long_payload{};
+    std::uint32_t line{};
+    std::uint32_t len{};
+    Level level{};
+    std::byte payload[RECORD_PAYLOAD];
+
+    const std::byte* data() const { return long_payload ? long_payload : payload; }
+};
+
+// Sequence word plus record fill one 512-byte queue cell.
+static_assert(sizeof(Record) + sizeof(std::size_t) <= 512, "log Record no longer fits a 512-byte queue cell");
+
+void release(Record& r) {
+    delete[] r.long_payload;
+    r.long_payload = nullptr;
+}
+
+// History slot. text is kept when a text sink already formatted the line, otherwise it is built on
+// first read; the string's capacity is reused when the slot is overwritten.
+struct Stored {
+    Record rec;
+    std::string text;
+};
+
+constexpr std::size_t WRITER_BATCH = 256;
+
 struct State {
     Config cfg{};
     std::FILE* file{};
-    std::mutex m;
-    std::vector<Entry> entries;
+    std::FILE* binary{};
+    std::mutex m;    // history ring and config
+    std::mutex io_m; // file handles, sink buffers and binary string ids
+    // Fixed-capacity history: line seq lives in slot seq % size. Lines below first_seq were cleared.
+    std::vector<Stored> history;
+    std::uint64_t next_seq{0};
+    std::uint64_t first_seq{0};
+    std::string text_buf;
+    std::vector<std::size_t> line_ends;
+    std::string binary_buf;
+    std::unordered_map<const void*, std::uint32_t> binary_ids;
+
+    jobs::MpmcQueue<Record> queue;
+    jobs::EventCount wake;  // writer parks here
+    jobs::EventCount space; // producers blocked on a full queue park here
+    std::thread writer;
+    std::atomic<bool> running{false};
+    std::atomic<bool> stop{false};
+    std::atomic<bool> block_when_full{false};
+    std::atomic<std::uint32_t> producers{0}; // log_encoded calls between their running check and enqueue
+
+    std::atomic<std::size_t> emitted{0}; // queue head position the writer has emitted up to
+    std::atomic<std::uint64_t> written{0};
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<std::uint64_t> blocked{0};
+    std::atomic<std::uint64_t> suppressed{0};
+
+    ~State() {
+        // Destroying a joinable std::thread terminates, so a writer still running at exit is stopped here.
+        if (writer.joinable()) {
+            stop.store(true, std::memory_order_release);
+            wake.notify_all();
+            writer.join();
+        }
+        for (auto& e : history) release(e.rec);
+    }
 };
 
 State& s() {
@@ -20,140 +101,420 @@ State& s() {
     return st;
 }
 
-const char* level_str(Level l) {
-    switch (l) {
-        case Level::Info: return "INFO";
-        case Level::Warn: return "WARN";
-        case Level::Error: return "ERROR";
+std::int64_t now_ms() {
+    using clock = std::chrono::system_clock;
+    return std::chrono::duration_cast<std::chrono::milliseconds>(clock::now().time_since_epoch()).count();
+}
+
+void fill_record(Record& r, Level level, const char* category, std::source_location loc, const char* fmt, const void* data, std::size_t len) {
+    r.time_ms = now_ms();
+    r.category = category;
+    r.file = loc.file_name();
+    r.fmt = fmt;
+    r.line = loc.line();
+    r.len = (std::uint32_t)len;
+    r.level = level;
+    r.long_payload = nullptr;
+    if (len <= RECORD_PAYLOAD) {
+        if (len) std::memcpy(r.payload, data, len);
+    } else {
+        r.long_payload = new std::byte[len];
+        std::memcpy(r.long_payload, data, len);
     }
-    return "INFO";
 }
 
-unsigned char level_bit(Level l) {
-    switch (l) {
-        case Level::Info: return 1u << 0;
-        case Level::Warn: return 1u << 1;
-        case Level::Error: return 1u << 2;
+void append_text(std::string& out, const Record& r) {
+    if (!r.fmt) {
+        format_line(out, r.level, r.time_ms, r.category, r.file, r.line, std::string_view((const char*)r.data(), r.len));
+        return;
     }
-    return 1u << 0;
+    static thread_local std::string msg;
+    msg.clear();
+    format_args(msg, r.fmt, r.data(), r.len);
+    format_line(out, r.level, r.time_ms, r.category, r.file, r.line, msg);
 }
 
-void localtime_safe(std::time_t t, std::tm& out) {
-#if defined(_WIN32)
-    localtime_s(&out, &t);
-#else
-    localtime_r(&t, &out);
-#endif
+void put_u32(std::string& out, std::uint32_t v) {
+    out.append((const char*)&v, sizeof(v));
 }
 
-std::string timestamp_now() {
-    using clock = std::chrono::system_clock;
-    auto now = clock::now();
-    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
-    std::time_t tt = clock::to_time_t(now);
-    std::tm tm{};
-    localtime_safe(tt, tm);
-    char buf[32];
-    std::snprintf(buf, sizeof(buf), "%02d:%02d:%02d.%03d",
-                  tm.tm_hour, tm.tm_min, tm.tm_sec, static_cast<int>(ms.count()));
-    return buf;
+// Caller holds io_m.
+std::uint32_t binary_string_id(const char* str) {
+    auto& st = s();
+    auto [it, inserted] = st.binary_ids.try_emplace(str, (std::uint32_t)st.binary_ids.size() + 1);
+    if (inserted) {
+        const std::uint32_t len = (std::uint32_t)std::strlen(str);
+        st.binary_buf += (char)BinaryBlock::String;
+        put_u32(st.binary_buf, it->second);
+        put_u32(st.binary_buf, len);
+        st.binary_buf.append(str, len);
+    }
+    return it->second;
 }
 
-void write_sinks(const std::string& line) {
-    std::fwrite(line.data(), 1, line.size(), stdout);
-    std::fwrite("\n", 1, 1, stdout);
-    std::fflush(stdout);
+// Caller holds io_m.
+void append_binary(const Record& r) {
+    auto& st = s();
+    const std::uint32_t category = binary_string_id(r.category);
+    const std::uint32_t file = binary_string_id(r.file);
+    const std::uint32_t fmt = r.fmt ? binary_string_id(r.fmt) : 0;
+    std::string& out = st.binary_buf;
+    out += (char)BinaryBlock::Record;
+    out += (char)r.level;
+    out.append((const char*)&r.time_ms, sizeof(r.time_ms));
+    put_u32(out, category);
+    put_u32(out, file);
+    put_u32(out, r.line);
+    put_u32(out, fmt);
+    put_u32(out, r.len);
+    out.append((const char*)r.data(), r.len);
+}
 
+// Caller holds io_m.
+void flush_sinks() {
     auto& st = s();
-    if (!st.file) return;
-    std::fwrite(line.data(), 1, line.size(), st.file);
-    std::fwrite("\n", 1, 1, st.file);
-    std::fflush(st.file);
+    if (st.cfg.write_stdout) std::fflush(stdout);
+    if (st.file) std::fflush(st.file);
+    if (st.binary) std::fflush(st.binary);
 }
 
+// Caller holds m.
+void resize_history(std::size_t capacity) {
+    auto& st = s();
+    capacity = std::max<std::size_t>(capacity, 1);
+    if (st.history.size() == capacity) return;
+    for (auto& e : st.history) release(e.rec);
+    st.history.clear();
+    st.history.resize(capacity);
+    st.first_seq = st.next_seq;
 }
 
-void init(const Config& cfg) {
+// Caller holds m. Takes ownership of the record's payload.
+void store_line(const Record& r, std::string_view text) {
+    auto& st = s();
+    if (st.history.empty()) resize_history(st.cfg.max_entries);
+    Stored& slot = st.history[st.next_seq % st.history.size()];
+    release(slot.rec);
+    slot.rec = r;
+    slot.text.assign(text);
+    st.next_seq++;
+}
+
+// Writes a batch to every sink, formatting text only if a text sink is open, then moves the records
+// (and their payload ownership) into the history ring.
+void emit(std::vector<Record>& batch, bool flush_now) {
+    auto& st = s();
+    std::scoped_lock lk(st.io_m);
+    const bool text = st.cfg.write_stdout || st.file;
+    st.text_buf.clear();
+    st.line_ends.clear();
+    st.binary_buf.clear();
+    for (const Record& r : batch) {
+        if (text) {
+            append_text(st.text_buf, r);
+            st.line_ends.push_back(st.text_buf.size());
+            st.text_buf += '\n';
+        }
+        if (st.binary) append_binary(r);
+    }
+    if (st.cfg.write_stdout) std::fwrite(st.text_buf.data(), 1, st.text_buf.size(), stdout);
+    if (st.file) std::fwrite(st.text_buf.data(), 1, st.text_buf.size(), st.file);
+    if (st.binary) std::fwrite(st.binary_buf.data(), 1, st.binary_buf.size(), st.binary);
+    if (flush_now) flush_sinks();
+
+    std::scoped_lock hk(st.m);
+    std::size_t at = 0;
+    for (std::size_t i = 0; i < batch.size(); ++i) {
+        std::string_view line;
+        if (text) {
+            line = std::string_view(st.text_buf).substr(at, st.line_ends[i] - at);
+            at = st.line_ends[i] + 1;
+        }
+        store_line(batch[i], line);
+    }
+    batch.clear();
+}
+
+// Dequeues up to WRITER_BATCH records into batch. Returns how many were taken.
+std::size_t drain_batch(std::vector<Record>& batch, std::uint64_t& reported_drops, bool& urgent) {
+    auto& st = s();
+    std::size_t n = 0;
+    Record r;
+    while (n < WRITER_BATCH && st.queue.dequeue(r)) {
+        urgent |= r.level == Level::Error;
+        batch.push_back(r);
+        n++;
+    }
+    if (n) st.space.notify_all();
+
+    const std::uint64_t drops = st.dropped.load(std::memory_order_relaxed);
+    if (drops != reported_drops) {
+        const unsigned long long count = drops - reported_drops;
+        std::byte args[16];
+        encode_args(args, count);
+        Record& note = batch.emplace_back();
+        fill_record(note, Level::Warn, "Log", std::source_location::current(), "Queue full: dropped %llu lines", args, encoded_size(count));
+        reported_drops = drops;
+    }
+    return n;
+}
+
+void writer_main() {
+    auto& st = s();
+    const auto interval = std::chrono::milliseconds(std::max<std::uint32_t>(1, st.cfg.flush_interval_ms));
+    auto last_flush = std::chrono::steady_clock::now();
+    std::vector<Record> batch;
+    batch.reserve(WRITER_BATCH + 1);
+    std::uint64_t reported_drops = st.dropped.load(std::memory_order_relaxed);
+    bool dirty = false;
+
+    for (;;) {
+        bool urgent = false;
+        const std::size_t n = drain_batch(batch, reported_drops, urgent);
+        const auto now = std::chrono::steady_clock::now();
+        if (!batch.empty() || dirty) {
+            const bool flush_now = urgent || now - last_flush >= interval;
+            if (!batch.empty()) {
+                emit(batch, flush_now);
+            } else if (flush_now) {
+                std::scoped_lock lk(st.io_m);
+                flush_sinks();
+            }
+            if (flush_now) last_flush = now;
+            dirty = !flush_now;
+        }
+        if (n) {
+            st.written.fetch_add(n, std::memory_order_relaxed);
+            st.emitted.store(st.queue.head_position(), std::memory_order_release);
+        }
+        if (n == WRITER_BATCH) continue;
+        if (st.stop.load(std::memory_order_acquire) && st.queue.size_approx() == 0) break;
+
+        const jobs::EventCount::Key key = st.wake.prepare_wait();
+        if (st.queue.size_approx() != 0 || st.stop.load(std::memory_order_acquire)) {
+            st.wake.cancel_wait(key);
+            continue;
+        }
+        st.wake.commit_wait(key, dirty ? (std::uint32_t)interval.count() : 0);
+    }
+
+    std::scoped_lock lk(st.io_m);
+    flush_sinks();
+}
+
+// Synchronous path used before init, after shutdown and with Config::async off.
+void write_now(Level level, const char* category, std::source_location loc, const char* fmt, const void* data, std::size_t len) {
+    std::vector<Record> batch(1);
+    fill_record(batch[0], level, category, loc, fmt, data, len);
+    emit(batch, true);
+    s().written.fetch_add(1, std::memory_order_relaxed);
+}
+
+void stop_writer() {
+    auto& st = s();
+    if (!st.writer.joinable()) return;
+    st.running.store(false, std::memory_order_seq_cst);
+    st.stop.store(true, std::memory_order_release);
+    st.wake.notify_all();
+    st.writer.join();
+    st.stop.store(false, std::memory_order_relaxed);
+
+    // Producers that saw running just before it cleared may still be queueing; once they are out,
+    // everything they queued is drained here and later calls write synchronously.
+    while (st.producers.load(std::memory_order_seq_cst) != 0) std::this_thread::yield();
+    std::vector<Record> batch;
+    std::uint64_t reported_drops = st.dropped.load(std::memory_order_relaxed);
+    bool urgent = false;
+    for (;;) {
+        const std::size_t n = drain_batch(batch, reported_drops, urgent);
+        if (!batch.empty()) emit(batch, true);
+        if (!n) break;
+        st.written.fetch_add(n, std::memory_order_relaxed);
+        st.emitted.store(st.queue.head_position(), std::memory_order_release);
+    }
+}
+
+// Caller holds io_m.
+void close_files() {
     auto& st = s();
-    std::scoped_lock lk(st.m);
-    st.cfg = cfg;
-    st.entries.reserve(cfg.max_entries);
     if (st.file) {
         std::fclose(st.file);
         st.file = nullptr;
     }
-    if (!st.cfg.file_path.empty()) {
-        st.file = std::fopen(st.cfg.file_path.c_str(), "a");
-        if (!st.file) write_sinks(std::string("WARN [Log] Failed to open log file: ") + st.cfg.file_path);
+    if (st.binary) {
+        std::fclose(st.binary);
+        st.binary = nullptr;
     }
+    st.binary_ids.clear();
+}
+
+}
+
+void init(const Config& cfg) {
+    auto& st = s();
+    stop_writer();
+    {
+        std::scoped_lock lk(st.m, st.io_m);
+        st.cfg = cfg;
+        resize_history(cfg.max_entries);
+        detail::g_level_mask.store(cfg.level_mask, std::memory_order_relaxed);
+        st.block_when_full.store(cfg.overflow == OverflowPolicy::Block, std::memory_order_relaxed);
+        close_files();
+        if (!cfg.file_path.empty()) st.file = std::fopen(cfg.file_path.c_str(), "a");
+        if (!cfg.binary_path.empty()) {
+            st.binary = std::fopen(cfg.binary_path.c_str(), "ab");
+            // String ids restart with every session; the decoder takes the latest definition of an id.
+            if (st.binary && std::fseek(st.binary, 0, SEEK_END) == 0 && std::ftell(st.binary) == 0) {
+                std::fwrite(BINARY_LOG_MAGIC, 1, sizeof(BINARY_LOG_MAGIC), st.binary);
+            }
+        }
+    }
+    if (!st.file && !cfg.file_path.empty()) LOG_WARN("Log", "Failed to open log file: %s", cfg.file_path.c_str());
+    if (!st.binary && !cfg.binary_path.empty()) LOG_WARN("Log", "Failed to open binary log file: %s", cfg.binary_path.c_str());
+
+    if (!cfg.async || !st.queue.init(std::max<std::uint32_t>(cfg.queue_capacity, 2))) return;
+    st.emitted.store(0, std::memory_order_relaxed);
+    st.running.store(true, std::memory_order_release);
+    st.writer = std::thread(writer_main);
 }
 
 void shutdown() {
     auto& st = s();
-    std::scoped_lock lk(st.m);
-    if (st.file) {
-        std::fclose(st.file);
-        st.file = nullptr;
+    stop_writer();
+    std::scoped_lock lk(st.io_m);
+    close_files();
+}
+
+void flush() {
+    auto& st = s();
+    if (st.running.load(std::memory_order_acquire)) {
+        // The tail covers every line whose log call returned before this one. The writer takes cells in
+        // order, so a cell still being filled in holds it back instead of being counted past.
+        const std::size_t target = st.queue.tail_position();
+        st.wake.notify_one();
+        while (st.emitted.load(std::memory_order_acquire) < target && st.running.load(std::memory_order_acquire)) std::this_thread::yield();
     }
+    std::scoped_lock lk(st.io_m);
+    flush_sinks();
 }
 
 void set_level_mask(unsigned char mask) {
     auto& st = s();
     std::scoped_lock lk(st.m);
     st.cfg.level_mask = mask;
+    detail::g_level_mask.store(mask, std::memory_order_relaxed);
 }
 
 unsigned char level_mask() {
-    auto& st = s();
-    std::scoped_lock lk(st.m);
-    return st.cfg.level_mask;
+    return detail::g_level_mask.load(std::memory_order_relaxed);
 }
 
-void log_line(Level level, std::string_view category, std::source_location loc, std::string msg) {
+void log_encoded(Level level, const char* category, std::source_location loc, const char* fmt, const std::byte* args, std::size_t len) {
     auto& st = s();
-    const unsigned char bit = level_bit(level);
-
-    std::scoped_lock lk(st.m);
-    if ((st.cfg.level_mask & bit) == 0) return;
+    if (!enabled(level)) return;
+    // Paired with the seq_cst store in stop_writer: either this call sees running cleared, or
+    // stop_writer sees it counted and waits for its record before the final drain.
+    st.producers.fetch_add(1, std::memory_order_seq_cst);
+    if (!st.running.load(std::memory_order_seq_cst)) {
+        st.producers.fetch_sub(1, std::memory_order_release);
+        write_now(level, category, loc, fmt, args, len);
+        return;
+    }
 
-    std::string ts = timestamp_now();
+    Record r;
+    fill_record(r, level, category, loc, fmt, args, len);
+    bool waited = false;
+    while (!st.queue.enqueue(r)) {
+        if (!st.block_when_full.load(std::memory_order_relaxed)) {
+            release(r);
+            st.dropped.fetch_add(1, std::memory_order_relaxed);
+            st.producers.fetch_sub(1, std::memory_order_release);
+            return;
+        }
+        if (!st.running.load(std::memory_order_acquire)) {
+            // Shutting down with the queue still full: write it here rather than lose it.
+            release(r);
+            st.producers.fetch_sub(1, std::memory_order_release);
+            write_now(level, category, loc, fmt, args, len);
+            return;
+        }
+        if (!waited) {
+            st.blocked.fetch_add(1, std::memory_order_relaxed);
+            waited = true;
+        }
+        st.wake.notify_one();
+        const jobs::EventCount::Key key = st.space.prepare_wait();
+        if (st.queue.size_approx() < st.queue.capacity()) {
+            st.space.cancel_wait(key);
+            continue;
+        }
+        st.space.commit_wait(key, 1);
+    }
+    st.producers.fetch_sub(1, std::memory_order_release);
+    st.wake.notify_one();
+}
 
-    char loc_buf[512];
-    std::snprintf(loc_buf, sizeof(loc_buf), "%s:%u", loc.file_name(), loc.line());
+bool rate_limit_pass(RateLimit& rl, Level level, const char* category, std::source_location loc, std::uint32_t burst, std::uint32_t window_ms) {
+    const std::int64_t now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    return rate_limit_pass_at(rl, level, category, loc, burst, window_ms, now);
+}
 
-    std::string line;
-    line.reserve(ts.size() + msg.size() + category.size() + 64);
-    line += ts;
-    line += " [";
-    line += level_str(level);
-    line += "] [";
-    line += category;
-    line += "] ";
-    line += loc_buf;
-    line += " ";
-    line += msg;
+bool rate_limit_pass_at(RateLimit& rl, Level level, const char* category, std::source_location loc, std::uint32_t burst, std::uint32_t window_ms, std::int64_t now) {
+    std::int64_t start = rl.window_start_ms.load(std::memory_order_relaxed);
+    if (now - start < (std::int64_t)window_ms || !rl.window_start_ms.compare_exchange_strong(start, now, std::memory_order_relaxed)) {
+        return rl.count.fetch_add(1, std::memory_order_relaxed) < burst;
+    }
 
-    st.entries.push_back(Entry{level, std::string(category), line});
-    if (st.entries.size() > st.cfg.max_entries) {
-        size_t drop = st.entries.size() - st.cfg.max_entries;
-        st.entries.erase(st.entries.begin(), st.entries.begin() + static_cast<std::ptrdiff_t>(drop));
+    // This call opened a new window: report what the last one swallowed, then log as usual.
+    const std::uint32_t prev = rl.count.exchange(1, std::memory_order_relaxed);
+    if (prev > burst) {
+        const unsigned long long repeats = prev - burst;
+        s().suppressed.fetch_add(repeats, std::memory_order_relaxed);
+        log(level, category, loc, "Previous message repeated %llu more times in %.1fs", repeats, (double)(now - start) / 1000.0);
     }
+    return burst > 0;
+}
 
-    write_sinks(line);
+void log_line(Level level, const char* category, std::source_location loc, std::string_view msg) {
+    log_encoded(level, category, loc, nullptr, (const std::byte*)msg.data(), msg.size());
 }
 
-std::vector<Entry> snapshot() {
+std::uint64_t read_since(std::uint64_t cursor, const std::function<void(const LineView&)>& fn) {
     auto& st = s();
     std::scoped_lock lk(st.m);
-    return st.entries;
+    if (st.history.empty() || !fn) return st.next_seq;
+    const std::uint64_t capacity = st.history.size();
+    const std::uint64_t oldest = std::max(st.first_seq, st.next_seq > capacity ? st.next_seq - capacity : 0);
+    for (std::uint64_t seq = std::max(cursor, oldest); seq < st.next_seq; ++seq) {
+        Stored& e = st.history[seq % capacity];
+        if (e.text.empty()) append_text(e.text, e.rec);
+        fn(LineView{seq, e.rec.level, e.rec.category, e.text});
+    }
+    return st.next_seq;
+}
+
+std::vector<Entry> snapshot() {
+    std::vector<Entry> out;
+    read_since(0, [&](const LineView& l) { out.push_back(Entry{l.level, std::string(l.category), std::string(l.text)}); });
+    return out;
 }
 
 void clear() {
     auto& st = s();
     std::scoped_lock lk(st.m);
-    st.entries.clear();
+    st.first_seq = st.next_seq;
 }
 
+Stats stats() {
+    auto& st = s();
+    Stats out{};
+    out.written = st.written.load(std::memory_order_relaxed);
+    out.dropped = st.dropped.load(std::memory_order_relaxed);
+    out.blocked = st.blocked.load(std::memory_order_relaxed);
+    out.suppressed = st.suppressed.load(std::memory_order_relaxed);
+    out.queued = (std::uint32_t)st.queue.size_approx();
+    out.queue_capacity = st.queue.capacity();
+    return out;
 }
 
-
+}
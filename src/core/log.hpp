@@ -1,14 +1,29 @@
 #pragma once
 
+#include "core/log_format.hpp"
+
 #include <source_location>
+#include <atomic>
+#include <cstdint>
 #include <cstdio>
+#include <functional>
 #include <string>
 #include <string_view>
 #include <vector>
 
+// Calls below these levels are compiled out (0 info, 1 warn, 2 error). CUBE_LOG_CATEGORY_LEVELS
+// overrides the floor per category, e.g. "Jobs=1,Render=2".
+#ifndef CUBE_LOG_MIN_LEVEL
+  #define CUBE_LOG_MIN_LEVEL 0
+#endif
+#ifndef CUBE_LOG_CATEGORY_LEVELS
+  #define CUBE_LOG_CATEGORY_LEVELS ""
+#endif
+
 namespace cube::log {
 
-enum class Level : unsigned char { Info, Warn, Error };
+// What a producer does when the writer thread has fallen behind and the record queue is full.
+enum class OverflowPolicy : unsigned char { Drop, Block };
 
 struct Entry {
     Level level;
@@ -16,44 +31,149 @@ struct Entry {
     std::string text;
 };
 
+// A history line as seen by read_since; the views are only valid inside the callback.
+struct LineView {
+    std::uint64_t seq;
+    Level level;
+    std::string_view category;
+    std::string_view text;
+};
+
 struct Config {
     std::string file_path{"cube.log"};
+    // Raw records (format pointer, call site, encoded arguments) for tools/log_decode; empty disables.
+    std::string binary_path{};
+    // Lines kept for read_since; older ones are overwritten.
     size_t max_entries{5000};
     unsigned char level_mask{0xFF};
+    bool write_stdout{true};
+    // Hand lines to a background writer thread; when false every call writes synchronously.
+    bool async{true};
+    // Records between producers and the writer thread; rounded down to a power of two.
+    std::uint32_t queue_capacity{4096};
+    OverflowPolicy overflow{OverflowPolicy::Drop};
+    // Sinks are flushed at least this often while there is output, and right after any error line.
+    std::uint32_t flush_interval_ms{100};
 };
 
+struct Stats {
+    std::uint64_t written{};
+    std::uint64_t dropped{};
+    std::uint64_t blocked{}; // producers that had to wait for queue space
+    std::uint64_t suppressed{}; // rate-limited calls, counted when their summary line is written
+    std::uint32_t queued{};
+    std::uint32_t queue_capacity{};
+};
+
+// Starts the background writer (cfg.async). Until init and after shutdown lines are written synchronously.
 void init(const Config& cfg = {});
+// Drains queued lines, stops the writer and closes the files.
 void shutdown();
+// Blocks until every line logged before the call has reached the sinks.
+void flush();
 
 void set_level_mask(unsigned char mask);
 unsigned char level_mask();
 
-void log_line(Level level, std::string_view category, std::source_location loc, std::string msg);
+namespace detail {
+extern std::atomic<unsigned char> g_level_mask;
+}
+
+inline bool enabled(Level level) {
+    return (detail::g_level_mask.load(std::memory_order_relaxed) & (1u << (unsigned)level)) != 0;
+}
+
+// Compile-time floor for a category given an override list ("Name=level,...") and a global floor.
+constexpr int category_min_level(std::string_view category, std::string_view overrides, int global) {
+    while (!overrides.empty()) {
+        const std::size_t comma = overrides.find(',');
+        const std::string_view item = overrides.substr(0, comma);
+        overrides = comma == std::string_view::npos ? std::string_view{} : overrides.substr(comma + 1);
+        const std::size_t eq = item.find('=');
+        if (eq == std::string_view::npos || eq + 1 >= item.size()) continue;
+        if (item.substr(0, eq) == category) return item[eq + 1] - '0';
+    }
+    return global;
+}
+
+constexpr bool compiled_in(Level level, std::string_view category) {
+    return (int)level >= category_min_level(category, CUBE_LOG_CATEGORY_LEVELS, CUBE_LOG_MIN_LEVEL);
+}
+
+// category, loc.file_name() and fmt must have static storage duration (string literals); records keep
+// the pointers and format on the writer thread, or never if no text sink wants the line.
+void log_encoded(Level level, const char* category, std::source_location loc, const char* fmt, const std::byte* args, std::size_t len);
+// Already formatted text; the message is copied.
+void log_line(Level level, const char* category, std::source_location loc, std::string_view msg);
+// Calls fn for each history line with seq >= cursor, oldest first, and returns the cursor for the next
+// call. Lines overwritten before the reader got to them are skipped. fn runs under the history lock and
+// must not log. An empty fn just returns the current end, to start a reader at "now".
+std::uint64_t read_since(std::uint64_t cursor, const std::function<void(const LineView&)>& fn);
+// Copy of the whole history; read_since is the incremental form.
 std::vector<Entry> snapshot();
+// Hides current history from later reads.
 void clear();
+Stats stats();
+
+// Per call site state for the *_LIMITED macros; lives in a function-local static.
+struct RateLimit {
+    std::atomic<std::int64_t> window_start_ms{INT64_MIN / 2};
+    std::atomic<std::uint32_t> count{0};
+};
+
+inline constexpr std::uint32_t RATE_LIMIT_BURST = 10;
+inline constexpr std::uint32_t RATE_LIMIT_WINDOW_MS = 5000;
+
+// Lets the first `burst` calls of each window through. The first call of a new window first logs how
+// many calls the previous one suppressed, at the same call site. Counts are approximate under
+// contention; a site that goes quiet reports its last window on its next call.
+bool rate_limit_pass(RateLimit& rl, Level level, const char* category, std::source_location loc, std::uint32_t burst, std::uint32_t window_ms);
+// rate_limit_pass at an explicit time on the steady clock, in milliseconds.
+bool rate_limit_pass_at(RateLimit& rl, Level level, const char* category, std::source_location loc, std::uint32_t burst, std::uint32_t window_ms, std::int64_t now);
 
 template <class... Args>
-inline void log(Level level, std::string_view category, std::source_location loc, const char* fmt, Args&&... args) {
-    char stack_buf[1024];
-    int n = std::snprintf(stack_buf, sizeof(stack_buf), fmt, static_cast<Args&&>(args)...);
-    if (n < 0) {
-        log_line(level, category, loc, std::string(fmt));
-        return;
+inline void log(Level level, const char* category, std::source_location loc, const char* fmt, const Args&... args) {
+    if constexpr (sizeof...(Args) == 0) {
+        log_encoded(level, category, loc, fmt, nullptr, 0);
+    } else {
+        const std::size_t len = encoded_size(args...);
+        std::byte stack_buf[256];
+        std::byte* buf = len <= sizeof(stack_buf) ? stack_buf : new std::byte[len];
+        encode_args(buf, args...);
+        log_encoded(level, category, loc, fmt, buf, len);
+        if (buf != stack_buf) delete[] buf;
     }
-    if (static_cast<size_t>(n) < sizeof(stack_buf)) {
-        log_line(level, category, loc, std::string(stack_buf, stack_buf + n));
-        return;
-    }
-    std::string out;
-    out.resize(static_cast<size_t>(n));
-    std::snprintf(out.data(), out.size() + 1, fmt, static_cast<Args&&>(args)...);
-    log_line(level, category, loc, static_cast<std::string&&>(out));
 }
 
 }
 
-#define LOG_INFO(category, ...) ::cube::log::log(::cube::log::Level::Info, (category), std::source_location::current(), __VA_ARGS__)
-#define LOG_WARN(category, ...) ::cube::log::log(::cube::log::Level::Warn, (category), std::source_location::current(), __VA_ARGS__)
-#define LOG_ERROR(category, ...) ::cube::log::log(::cube::log::Level::Error, (category), std::source_location::current(), __VA_ARGS__)
+// The level checks come first: a filtered call never evaluates its arguments.
+#define CUBE_LOG_AT(level, category, ...) \
+    do { \
+        if constexpr (::cube::log::compiled_in((level), (category))) { \
+            if (::cube::log::enabled(level)) ::cube::log::log((level), (category), std::source_location::current(), __VA_ARGS__); \
+        } \
+    } while (0)
+
+#define LOG_INFO(category, ...) CUBE_LOG_AT(::cube::log::Level::Info, category, __VA_ARGS__)
+#define LOG_WARN(category, ...) CUBE_LOG_AT(::cube::log::Level::Warn, category, __VA_ARGS__)
+#define LOG_ERROR(category, ...) CUBE_LOG_AT(::cube::log::Level::Error, category, __VA_ARGS__)
 
+// For hot paths: at most `burst` lines per `window_ms` from this call site, then a repeat count.
+#define CUBE_LOG_LIMITED_AT(level, category, burst, window_ms, ...) \
+    do { \
+        if constexpr (::cube::log::compiled_in((level), (category))) { \
+            static ::cube::log::RateLimit cube_log_rate_limit_; \
+            if (::cube::log::enabled(level) && \
+                ::cube::log::rate_limit_pass(cube_log_rate_limit_, (level), (category), std::source_location::current(), (burst), (window_ms))) { \
+                ::cube::log::log((level), (category), std::source_location::current(), __VA_ARGS__); \
+            } \
+        } \
+    } while (0)
 
+#define LOG_INFO_LIMITED(category, ...) \
+    CUBE_LOG_LIMITED_AT(::cube::log::Level::Info, category, ::cube::log::RATE_LIMIT_BURST, ::cube::log::RATE_LIMIT_WINDOW_MS, __VA_ARGS__)
+#define LOG_WARN_LIMITED(category, ...) \
+    CUBE_LOG_LIMITED_AT(::cube::log::Level::Warn, category, ::cube::log::RATE_LIMIT_BURST, ::cube::log::RATE_LIMIT_WINDOW_MS, __VA_ARGS__)
+#define LOG_ERROR_LIMITED(category, ...) \
+    CUBE_LOG_LIMITED_AT(::cube::log::Level::Error, category, ::cube::log::RATE_LIMIT_BURST, ::cube::log::RATE_LIMIT_WINDOW_MS, __VA_ARGS__)
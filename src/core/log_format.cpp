@@ -0,0 +1,276 @@
+#include "log_format.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <unordered_map>
+#include <vector>
+
+namespace cube::log {
+
+namespace {
+
+void localtime_safe(std::time_t t, std::tm& out) {
+#if defined(_WIN32)
+    localtime_s(&out, &t);
+#else
+    localtime_r(&t, &out);
+#endif
+}
+
+// Caches the broken-down time for the current second.
+struct TimestampCache {
+    std::int64_t second{-1};
+    std::tm tm{};
+
+    void format(std::int64_t ms, char (&buf)[16]) {
+        const std::int64_t sec = ms / 1000;
+        if (sec != second) {
+            localtime_safe((std::time_t)sec, tm);
+            second = sec;
+        }
+        std::snprintf(buf, sizeof(buf), "%02d:%02d:%02d.%03d", tm.tm_hour, tm.tm_min, tm.tm_sec, (int)(ms % 1000));
+    }
+};
+
+struct ArgReader {
+    const std::byte* p;
+    const std::byte* end;
+
+    bool next(ArgTag& tag, std::uint64_t& word, std::string_view& str) {
+        if (p >= end) return false;
+        tag = (ArgTag)*p++;
+        if (tag == ArgTag::String) {
+            std::uint32_t n = 0;
+            if ((std::size_t)(end - p) < sizeof(n)) return false;
+            std::memcpy(&n, p, sizeof(n));
+            p += sizeof(n);
+            if ((std::size_t)(end - p) < n) return false;
+            str = std::string_view((const char*)p, n);
+            p += n;
+            return true;
+        }
+        if ((std::size_t)(end - p) < 8) return false;
+        std::memcpy(&word, p, 8);
+        p += 8;
+        return true;
+    }
+};
+
+template <class T>
+void append_printf(std::string& out, const char* spec, T v) {
+    char buf[128];
+    const int n = std::snprintf(buf, sizeof(buf), spec, v);
+    if (n < 0) return;
+    if ((std::size_t)n < sizeof(buf)) {
+        out.append(buf, (std::size_t)n);
+        return;
+    }
+    const std::size_t at = out.size();
+    out.resize(at + (std::size_t)n);
+    std::vector<char> big((std::size_t)n + 1);
+    std::snprintf(big.data(), big.size(), spec, v);
+    std::memcpy(out.data() + at, big.data(), (std::size_t)n);
+}
+
+// Integer-ish value of an argument, for '*' widths and %c.
+bool as_int(ArgTag tag, std::uint64_t word, long long& out) {
+    if (tag != ArgTag::Int && tag != ArgTag::UInt) return false;
+    out = (long long)word;
+    return true;
+}
+
+bool read_u32(const std::byte*& p, const std::byte* end, std::uint32_t& v) {
+    if ((std::size_t)(end - p) < sizeof(v)) return false;
+    std::memcpy(&v, p, sizeof(v));
+    p += sizeof(v);
+    return true;
+}
+
+}
+
+const char* level_name(Level l) {
+    switch (l) {
+        case Level::Info: return "INFO";
+        case Level::Warn: return "WARN";
+        case Level::Error: return "ERROR";
+    }
+    return "INFO";
+}
+
+void format_args(std::string& out, const char* fmt, const std::byte* args, std::size_t len) {
+    ArgReader in{args, args + len};
+    const char* p = fmt;
+    while (*p) {
+        if (*p != '%') {
+            const char* q = p;
+            while (*q && *q != '%') q++;
+            out.append(p, (std::size_t)(q - p));
+            p = q;
+            continue;
+        }
+        if (p[1] == '%') {
+            out += '%';
+            p += 2;
+            continue;
+        }
+
+        // Rebuild the conversion with a fixed length modifier: integers print as long long, floats as
+        // double, whatever the call site wrote.
+        char spec[96];
+        std::size_t n = 0;
+        bool bad = false;
+        spec[n++] = *p++;
+        while (*p && std::strchr("-+ #0", *p) && n < 8) spec[n++] = *p++;
+        for (int part = 0; part < 2; ++part) {
+            if (part == 1) {
+                if (*p != '.') break;
+                spec[n++] = *p++;
+            }
+            if (*p == '*') {
+                p++;
+                ArgTag tag{};
+                std::uint64_t word = 0;
+                std::string_view str;
+                long long v = 0;
+                if (!in.next(tag, word, str) || !as_int(tag, word, v)) bad = true;
+                n += (std::size_t)std::max(0, std::snprintf(spec + n, sizeof(spec) - n, "%lld", v));
+            } else {
+                while (*p >= '0' && *p <= '9' && n < 64) spec[n++] = *p++;
+            }
+        }
+        while (*p && std::strchr("hljztL", *p)) p++;
+        const char conv = *p;
+        if (!conv) break;
+        p++;
+
+        ArgTag tag{};
+        std::uint64_t word = 0;
+        std::string_view str;
+        if (bad || !in.next(tag, word, str)) {
+            out += "<?>";
+            continue;
+        }
+        switch (conv) {
+            case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': {
+                if (tag != ArgTag::Int && tag != ArgTag::UInt && tag != ArgTag::Pointer) break;
+                spec[n++] = 'l';
+                spec[n++] = 'l';
+                spec[n++] = conv;
+                spec[n] = '\0';
+                append_printf(out, spec, (long long)word);
+                continue;
+            }
+            case 'c': {
+                long long v = 0;
+                if (!as_int(tag, word, v)) break;
+                spec[n++] = conv;
+                spec[n] = '\0';
+                append_printf(out, spec, (int)v);
+                continue;
+            }
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A': {
+                if (tag != ArgTag::Double) break;
+                double d = 0.0;
+                std::memcpy(&d, &word, sizeof(d));
+                spec[n++] = conv;
+                spec[n] = '\0';
+                append_printf(out, spec, d);
+                continue;
+            }
+            case 's': {
+                if (tag != ArgTag::String) break;
+                const std::string text(str);
+                spec[n++] = conv;
+                spec[n] = '\0';
+                if (n == 2) out += text;
+                else append_printf(out, spec, text.c_str());
+                continue;
+            }
+            case 'p': {
+                if (tag != ArgTag::Pointer && tag != ArgTag::UInt) break;
+                spec[n++] = conv;
+                spec[n] = '\0';
+                append_printf(out, spec, (void*)(std::uintptr_t)word);
+                continue;
+            }
+            default:
+                break;
+        }
+        out += "<?>";
+    }
+}
+
+void format_line(std::string& out, Level level, std::int64_t time_ms, std::string_view category, std::string_view file, std::uint32_t line, std::string_view msg) {
+    static thread_local TimestampCache timestamps;
+    char ts[16];
+    timestamps.format(time_ms, ts);
+    char line_buf[16];
+    const int ln = std::snprintf(line_buf, sizeof(line_buf), ":%u ", line);
+
+    out.reserve(out.size() + msg.size() + category.size() + file.size() + 40);
+    out += ts;
+    out += " [";
+    out += level_name(level);
+    out += "] [";
+    out += category;
+    out += "] ";
+    out += file;
+    out.append(line_buf, (std::size_t)std::max(ln, 0));
+    out += msg;
+}
+
+std::string BinaryRecord::message() const {
+    if (!fmt) return std::string((const char*)payload, payload_len);
+    std::string out;
+    format_args(out, fmt, payload, payload_len);
+    return out;
+}
+
+bool read_binary_log(const std::byte* data, std::size_t size, const std::function<void(const BinaryRecord&)>& fn) {
+    if (size < sizeof(BINARY_LOG_MAGIC) || std::memcmp(data, BINARY_LOG_MAGIC, sizeof(BINARY_LOG_MAGIC)) != 0) return false;
+    const std::byte* p = data + sizeof(BINARY_LOG_MAGIC);
+    const std::byte* end = data + size;
+    std::unordered_map<std::uint32_t, std::string> strings;
+    auto lookup = [&](std::uint32_t id) -> const std::string* {
+        auto it = strings.find(id);
+        return it == strings.end() ? nullptr : &it->second;
+    };
+
+    while (p < end) {
+        const auto kind = (BinaryBlock)*p++;
+        if (kind == BinaryBlock::String) {
+            std::uint32_t id = 0, len = 0;
+            if (!read_u32(p, end, id) || !read_u32(p, end, len) || (std::size_t)(end - p) < len) return false;
+            strings[id].assign((const char*)p, len);
+            p += len;
+        } else if (kind == BinaryBlock::Record) {
+            if (p >= end) return false;
+            BinaryRecord r;
+            r.level = (Level)*p++;
+            if ((std::size_t)(end - p) < sizeof(r.time_ms)) return false;
+            std::memcpy(&r.time_ms, p, sizeof(r.time_ms));
+            p += sizeof(r.time_ms);
+            std::uint32_t category = 0, file = 0, fmt = 0;
+            if (!read_u32(p, end, category) || !read_u32(p, end, file) || !read_u32(p, end, r.line) ||
+                !read_u32(p, end, fmt) || !read_u32(p, end, r.payload_len) || (std::size_t)(end - p) < r.payload_len) {
+                return false;
+            }
+            const std::string* c = lookup(category);
+            const std::string* f = lookup(file);
+            const std::string* s = fmt ? lookup(fmt) : nullptr;
+            if (!c || !f || (fmt && !s)) return false;
+            r.category = *c;
+            r.file = *f;
+            r.fmt = s ? s->c_str() : nullptr;
+            r.payload = p;
+            p += r.payload_len;
+            fn(r);
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
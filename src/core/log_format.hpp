@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace cube::log {
+
+enum class Level : unsigned char { Info, Warn, Error };
+
+const char* level_name(Level l);
+
+// printf arguments captured as [tag][value] so a record can be formatted long after the call (or in
+// another process). Integers widen to 64 bits, floats to double, C strings are copied.
+enum class ArgTag : std::uint8_t { Int, UInt, Double, Pointer, String };
+
+namespace detail {
+
+template <class T>
+constexpr bool is_c_string = std::is_convertible_v<const T&, const char*>;
+
+template <class T>
+std::size_t arg_size(const T& v) {
+    if constexpr (is_c_string<T>) {
+        const char* s = v;
+        return 1 + sizeof(std::uint32_t) + (s ? std::strlen(s) : 6);
+    } else {
+        return 1 + 8;
+    }
+}
+
+inline std::byte* put_word(std::byte* out, ArgTag tag, const void* v) {
+    *out++ = (std::byte)tag;
+    std::memcpy(out, v, 8);
+    return out + 8;
+}
+
+template <class T>
+std::byte* put_arg(std::byte* out, const T& v) {
+    using U = std::remove_cv_t<std::remove_reference_t<T>>;
+    if constexpr (is_c_string<T>) {
+        const char* s = v;
+        if (!s) s = "(null)";
+        const std::uint32_t n = (std::uint32_t)std::strlen(s);
+        *out++ = (std::byte)ArgTag::String;
+        std::memcpy(out, &n, sizeof(n));
+        std::memcpy(out + sizeof(n), s, n);
+        return out + sizeof(n) + n;
+    } else if constexpr (std::is_floating_point_v<U>) {
+        const double d = (double)v;
+        return put_word(out, ArgTag::Double, &d);
+    } else if constexpr (std::is_pointer_v<U>) {
+        const std::uint64_t p = (std::uint64_t)(std::uintptr_t)v;
+        return put_word(out, ArgTag::Pointer, &p);
+    } else if constexpr (std::is_enum_v<U>) {
+        return put_arg(out, (std::underlying_type_t<U>)v);
+    } else {
+        static_assert(std::is_integral_v<U>, "unsupported log argument type");
+        if constexpr (std::is_signed_v<U>) {
+            const std::int64_t i = (std::int64_t)v;
+            return put_word(out, ArgTag::Int, &i);
+        } else {
+            const std::uint64_t u = (std::uint64_t)v;
+            return put_word(out, ArgTag::UInt, &u);
+        }
+    }
+}
+
+}
+
+template <class... Args>
+std::size_t encoded_size(const Args&... args) {
+    return (std::size_t(0) + ... + detail::arg_size(args));
+}
+
+// out must hold encoded_size(args...) bytes.
+template <class... Args>
+void encode_args(std::byte* out, const Args&... args) {
+    ((out = detail::put_arg(out, args)), ...);
+}
+
+// Formats a printf format against encoded arguments. A conversion without a usable argument prints "<?>".
+void format_args(std::string& out, const char* fmt, const std::byte* args, std::size_t len);
+
+// Appends "hh:mm:ss.mmm [LEVEL] [Category] file:line message" (local time).
+void format_line(std::string& out, Level level, std::int64_t time_ms, std::string_view category, std::string_view file, std::uint32_t line, std::string_view msg);
+
+// Binary log file: BINARY_LOG_MAGIC, then a stream of blocks in native byte order.
+//   String: [u8 kind][u32 id][u32 len][bytes]            category, file and format strings, sent once
+//   Record: [u8 kind][u8 level][i64 time_ms][u32 category][u32 file][u32 line][u32 fmt][u32 len][payload]
+// fmt 0 means the payload is already text; otherwise it holds encode_args output for that format.
+inline constexpr char BINARY_LOG_MAGIC[8] = {'C', 'U', 'B', 'E', 'L', 'O', 'G', '1'};
+enum class BinaryBlock : std::uint8_t { String = 1, Record = 2 };
+
+struct BinaryRecord {
+    Level level{};
+    std::int64_t time_ms{};
+    std::string_view category;
+    std::string_view file;
+    std::uint32_t line{};
+    const char* fmt{}; // null: payload is the message text
+    const std::byte* payload{};
+    std::uint32_t payload_len{};
+
+    std::string message() const;
+};
+
+// Walks a binary log and calls fn for each record. Returns false if the data is not a binary log or
+// ends in a truncated or malformed block; records before that point are still delivered.
+bool read_binary_log(const std::byte* data, std::size_t size, const std::function<void(const BinaryRecord&)>& fn);
+
+}
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "core/event_count.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace cube::jobs {
+
+// Bounded lock-free MPMC ring (Vyukov). Each cell carries a sequence number that tells producers and
+// consumers whose turn it is, so enqueue and dequeue are a CAS on tail/head plus one release store.
+template <class T>
+class MpmcQueue {
+public:
+    // Capacity is rounded down to a power of two; fails below 2.
+    bool init(std::uint32_t capacity_pow2);
+    bool enqueue(const T& v);
+    // Claims up to n cells with a single tail CAS and publishes them in order; returns how many
+    // were enqueued (fewer than n only when the ring is nearly full).
+    std::size_t enqueue_bulk(const T* items, std::size_t n);
+    bool dequeue(T& out);
+    void reset();
+    std::uint32_t capacity() const { return mask_ ? (std::uint32_t)(mask_ + 1u) : 0u; }
+    // Cells claimed by producers / taken by consumers since init() or reset(). Everything this thread
+    // enqueued before reading tail_position() sits below it.
+    std::size_t tail_position() const { return tail_.load(std::memory_order_acquire); }
+    std::size_t head_position() const { return head_.load(std::memory_order_acquire); }
+    // Approximate while producers or consumers are active.
+    std::size_t size_approx() const {
+        const std::size_t t = tail_.load(std::memory_order_relaxed);
+        const std::size_t h = head_.load(std::memory_order_relaxed);
+        return t > h ? t - h : 0;
+    }
+
+private:
+    struct alignas(64) Cell {
+        std::atomic<std::size_t> seq{};
+        T data{};
+
+        Cell() = default;
+        Cell(const Cell& o) {
+            seq.store(o.seq.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            data = o.data;
+        }
+        Cell& operator=(const Cell& o) {
+            seq.store(o.seq.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            data = o.data;
+            return *this;
+        }
+        Cell(Cell&& o) noexcept : Cell(o) {}
+        Cell& operator=(Cell&& o) noexcept { return (*this = o); }
+    };
+
+    std::vector<Cell> buf_;
+    std::size_t mask_{};
+    alignas(64) std::atomic<std::size_t> head_{0};
+    alignas(64) std::atomic<std::size_t> tail_{0};
+};
+
+template <class T>
+bool MpmcQueue<T>::init(std::uint32_t capacity_pow2) {
+    std::uint32_t cap = 0;
+    if (capacity_pow2 >= 2) {
+        cap = 1;
+        while ((cap << 1) && (cap << 1) <= capacity_pow2) cap <<= 1;
+    }
+    if (cap == 0) return false;
+    buf_.clear();
+    buf_.resize(cap);
+    mask_ = static_cast<std::size_t>(cap - 1u);
+    head_.store(0, std::memory_order_relaxed);
+    tail_.store(0, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < buf_.size(); ++i) buf_[i].seq.store(i, std::memory_order_relaxed);
+    return true;
+}
+
+template <class T>
+void MpmcQueue<T>::reset() {
+    head_.store(0, std::memory_order_relaxed);
+    tail_.store(0, std::memory_order_relaxed);
+    for (std::size_t i = 0; i < buf_.size(); ++i) buf_[i].seq.store(i, std::memory_order_relaxed);
+}
+
+template <class T>
+bool MpmcQueue<T>::enqueue(const T& v) {
+    if (buf_.empty()) return false;
+    Cell* cell = nullptr;
+    std::size_t pos = tail_.load(std::memory_order_relaxed);
+    for (;;) {
+        cell = &buf_[pos & mask_];
+        std::size_t seq = cell->seq.load(std::memory_order_acquire);
+        const std::intptr_t dif = (std::intptr_t)seq - (std::intptr_t)pos;
+        if (dif == 0) {
+            if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (dif < 0) {
+            return false;
+        } else {
+            pos = tail_.load(std::memory_order_relaxed);
+        }
+    }
+    cell->data = v;
+    cell->seq.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+template <class T>
+std::size_t MpmcQueue<T>::enqueue_bulk(const T* items, std::size_t n) {
+    if (n == 0 || buf_.empty()) return 0;
+    const std::size_t cap = mask_ + 1;
+    std::size_t pos = tail_.load(std::memory_order_relaxed);
+    std::size_t k = 0;
+    for (;;) {
+        // head only grows, so a stale head under-estimates free space and is safe. A stale pos can
+        // fall behind a head that consumers moved past it; reload the tail then.
+        const std::size_t head = head_.load(std::memory_order_acquire);
+        if ((std::intptr_t)(pos - head) < 0) {
+            pos = tail_.load(std::memory_order_relaxed);
+            continue;
+        }
+        const std::size_t used = pos - head;
+        if (used >= cap) return 0;
+        k = std::min(n, cap - used);
+        if (tail_.compare_exchange_weak(pos, pos + k, std::memory_order_relaxed)) break;
+    }
+    for (std::size_t i = 0; i < k; ++i) {
+        Cell& cell = buf_[(pos + i) & mask_];
+        // A consumer may have advanced head but not yet released this cell; it will shortly.
+        while (cell.seq.load(std::memory_order_acquire) != pos + i) cpu_relax();
+        cell.data = items[i];
+        cell.seq.store(pos + i + 1, std::memory_order_release);
+    }
+    return k;
+}
+
+template <class T>
+bool MpmcQueue<T>::dequeue(T& out) {
+    if (buf_.empty()) return false;
+    Cell* cell = nullptr;
+    std::size_t pos = head_.load(std::memory_order_relaxed);
+    for (;;) {
+        cell = &buf_[pos & mask_];
+        std::size_t seq = cell->seq.load(std::memory_order_acquire);
+        const std::intptr_t dif = (std::intptr_t)seq - (std::intptr_t)(pos + 1);
+        if (dif == 0) {
+            if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (dif < 0) {
+            return false;
+        } else {
+            pos = head_.load(std::memory_order_relaxed);
+        }
+    }
+    out = cell->data;
+    cell->seq.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+}
+
+}
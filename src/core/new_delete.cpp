@@ -0,0 +1,88 @@
+#include "profile.hpp"
+
+#include "memory/heap_profiler.hpp"
+
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+  #include <malloc.h>
+#endif
+
+// Global heap hooks: every build feeds the sampling heap profiler, Tracy builds also report each
+// allocation to Tracy. Profiler hooks run after the block exists and before it is released.
+
+void* operator new(std::size_t size) {
+    if (void* p = std::malloc(size ? size : 1)) {
+        CUBE_PROFILE_ALLOC(p, size);
+        cube::mem::heap_profile_alloc(p, size);
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    cube::mem::heap_profile_free(p);
+    CUBE_PROFILE_FREE(p);
+    std::free(p);
+}
+
+void* operator new[](std::size_t size) {
+    if (void* p = std::malloc(size ? size : 1)) {
+        CUBE_PROFILE_ALLOC(p, size);
+        cube::mem::heap_profile_alloc(p, size);
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete[](void* p) noexcept {
+    if (!p) return;
+    cube::mem::heap_profile_free(p);
+    CUBE_PROFILE_FREE(p);
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, std::size_t) noexcept { operator delete[](p); }
+
+// Over-aligned types. MSVC's free() cannot release _aligned_malloc blocks, so these keep their own
+// allocate/release pair. The nothrow forms route through these by default, like the plain ones.
+
+static void* aligned_block(std::size_t size, std::align_val_t al) {
+    const std::size_t a = (std::size_t)al;
+#if defined(_WIN32)
+    return _aligned_malloc(size ? size : 1, a);
+#else
+    // aligned_alloc wants a size that is a multiple of the alignment.
+    return std::aligned_alloc(a, ((size ? size : 1) + a - 1) & ~(a - 1));
+#endif
+}
+
+static void release_aligned(void* p) {
+    if (!p) return;
+    cube::mem::heap_profile_free(p);
+    CUBE_PROFILE_FREE(p);
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void* operator new(std::size_t size, std::align_val_t al) {
+    if (void* p = aligned_block(size, al)) {
+        CUBE_PROFILE_ALLOC(p, size);
+        cube::mem::heap_profile_alloc(p, size);
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t al) { return operator new(size, al); }
+
+void operator delete(void* p, std::align_val_t) noexcept { release_aligned(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { release_aligned(p); }
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept { release_aligned(p); }
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept { release_aligned(p); }
@@ -0,0 +1,50 @@
+#include "parallel_for.hpp"
+
+#include <algorithm>
+
+namespace cube::jobs {
+
+namespace {
+
+struct ForState {
+    JobSystem* js{};
+    RangeFn fn{};
+    void* ctx{};
+    std::size_t grain{};
+    Priority prio{};
+    const char* name{};
+    JobSystem::Counter counter;
+};
+
+bool worth_splitting(const ForState& st) {
+    const std::uint32_t workers = std::max(1u, st.js->worker_count());
+    return st.js->pending_jobs() < workers * 2u;
+}
+
+void run_range(ForState& st, std::size_t b, std::size_t e) {
+    while (e - b > st.grain && worth_splitting(st)) {
+        const std::size_t mid = b + (e - b) / 2;
+        ForState* sp = &st;
+        st.js->submit([sp, mid, e] { run_range(*sp, mid, e); }, st.prio, &st.counter, nullptr, st.name);
+        e = mid;
+    }
+    st.fn(st.ctx, b, e);
+}
+
+}
+
+void parallel_for_range(JobSystem& js, std::size_t begin, std::size_t end, std::size_t grain, RangeFn fn, void* ctx, Priority prio, const char* name) {
+    if (!fn || end <= begin) return;
+    ForState st;
+    st.js = &js;
+    st.fn = fn;
+    st.ctx = ctx;
+    st.grain = std::max<std::size_t>(1, grain);
+    st.prio = prio;
+    st.name = name ? name : "parallel_for";
+    js.init_counter(st.counter);
+    run_range(st, begin, end);
+    js.wait(st.counter);
+}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "core/job_system.hpp"
+
+#include <cstddef>
+#include <type_traits>
+
+namespace cube::jobs {
+
+using RangeFn = void(*)(void* ctx, std::size_t begin, std::size_t end);
+
+// Splits [begin, end) in halves until a piece is at most `grain` long, handing the upper half to the
+// job system each time. Splitting stops early once the queues already hold enough work to keep every
+// worker busy, so small ranges on a loaded system run inline instead of paying for scheduling.
+// Blocks (helping with other jobs) until every piece has run.
+void parallel_for_range(JobSystem& js, std::size_t begin, std::size_t end, std::size_t grain, RangeFn fn, void* ctx, Priority prio = Priority::Normal, const char* name = nullptr);
+
+// `fn` is either fn(std::size_t i) or fn(std::size_t begin, std::size_t end). It is referenced in
+// place, never copied, so captures cost nothing.
+template <class Fn>
+void parallel_for(JobSystem& js, std::size_t begin, std::size_t end, std::size_t grain, Fn&& fn, Priority prio = Priority::Normal, const char* name = nullptr) {
+    using F = std::remove_reference_t<Fn>;
+    RangeFn tramp = nullptr;
+    if constexpr (std::is_invocable_v<F&, std::size_t, std::size_t>) {
+        tramp = +[](void* ctx, std::size_t b, std::size_t e) { (*static_cast<F*>(ctx))(b, e); };
+    } else {
+        static_assert(std::is_invocable_v<F&, std::size_t>, "parallel_for: fn must take (i) or (begin, end)");
+        tramp = +[](void* ctx, std::size_t b, std::size_t e) {
+            F& f = *static_cast<F*>(ctx);
+            for (std::size_t i = b; i < e; ++i) f(i);
+        };
+    }
+    parallel_for_range(js, begin, end, grain, tramp, const_cast<void*>(static_cast<const void*>(&fn)), prio, name);
+}
+
+}
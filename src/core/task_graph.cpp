@@ -0,0 +1,99 @@
+#include "task_graph.hpp"
+
+namespace cube::jobs {
+
+void TaskGraph::reserve(std::size_t nodes, std::size_t edges) {
+    nodes_.reserve(nodes);
+    edges_.reserve(edges);
+    succ_.reserve(edges);
+    roots_.reserve(nodes);
+}
+
+void TaskGraph::precede(NodeId before, NodeId after) {
+    if (before >= nodes_.size() || after >= nodes_.size() || before == after) return;
+    edges_.push_back({before, after});
+    compiled_ = false;
+}
+
+bool TaskGraph::compile() {
+    for (auto& n : nodes_) {
+        n.graph = this;
+        n.first_succ = 0;
+        n.succ_count = 0;
+        n.indegree = 0;
+    }
+    for (const auto& [a, b] : edges_) {
+        nodes_[a].succ_count++;
+        nodes_[b].indegree++;
+    }
+    std::uint32_t at = 0;
+    for (auto& n : nodes_) {
+        n.first_succ = at;
+        at += n.succ_count;
+        n.succ_count = 0;
+    }
+    succ_.assign(edges_.size(), 0);
+    for (const auto& [a, b] : edges_) {
+        Node& n = nodes_[a];
+        succ_[n.first_succ + n.succ_count++] = b;
+    }
+
+    roots_.clear();
+    for (std::size_t i = 0; i < nodes_.size(); ++i) if (nodes_[i].indegree == 0) roots_.push_back((NodeId)i);
+
+    std::vector<std::uint32_t> indeg(nodes_.size());
+    std::vector<NodeId> ready(roots_);
+    for (std::size_t i = 0; i < nodes_.size(); ++i) indeg[i] = nodes_[i].indegree;
+    std::size_t visited = 0;
+    while (!ready.empty()) {
+        const NodeId id = ready.back();
+        ready.pop_back();
+        ++visited;
+        const Node& n = nodes_[id];
+        for (std::uint32_t s = 0; s < n.succ_count; ++s) {
+            const NodeId next = succ_[n.first_succ + s];
+            if (--indeg[next] == 0) ready.push_back(next);
+        }
+    }
+    if (visited != nodes_.size()) {
+        LOG_ERROR("Jobs", "TaskGraph has a cycle (%zu of %zu nodes reachable)", visited, nodes_.size());
+        return false;
+    }
+    compiled_ = true;
+    return true;
+}
+
+void TaskGraph::node_job(void* p) {
+    auto* n = static_cast<Node*>(p);
+    n->ops->invoke(n->storage);
+    TaskGraph& g = *n->graph;
+    for (std::uint32_t s = 0; s < n->succ_count; ++s) {
+        Node& next = g.nodes_[g.succ_[n->first_succ + s]];
+        if (next.pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            g.js_->submit(&TaskGraph::node_job, &next, next.prio, &g.done_, nullptr, next.name);
+        }
+    }
+}
+
+void TaskGraph::run(JobSystem& js) {
+    if (nodes_.empty()) return;
+    if (!compiled_ && !compile()) return;
+    js_ = &js;
+    for (auto& n : nodes_) n.pending.store(n.indegree, std::memory_order_relaxed);
+    js.init_counter(done_);
+    for (const NodeId id : roots_) {
+        Node& n = nodes_[id];
+        js.submit(&TaskGraph::node_job, &n, n.prio, &done_, nullptr, n.name);
+    }
+    js.wait(done_);
+}
+
+void TaskGraph::clear() {
+    nodes_.clear();
+    edges_.clear();
+    succ_.clear();
+    roots_.clear();
+    compiled_ = false;
+}
+
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "core/job_system.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cube::jobs {
+
+// A graph of jobs declared once and replayed every frame. Closures live inside the node (no heap),
+// edges are compiled into a flat successor array, and run() only touches preallocated state.
+class TaskGraph {
+public:
+    using NodeId = std::uint32_t;
+    static constexpr std::size_t INLINE_BYTES = 64;
+
+    TaskGraph() = default;
+    TaskGraph(const TaskGraph&) = delete;
+    TaskGraph& operator=(const TaskGraph&) = delete;
+    ~TaskGraph() { clear(); }
+
+    void reserve(std::size_t nodes, std::size_t edges);
+
+    template <class Fn>
+    NodeId add(const char* name, Fn&& fn, Priority prio = Priority::Normal) {
+        using F = std::decay_t<Fn>;
+        static_assert(sizeof(F) <= INLINE_BYTES, "TaskGraph: closure too large for inline storage");
+        static_assert(alignof(F) <= alignof(std::max_align_t), "TaskGraph: closure over-aligned");
+        static_assert(std::is_nothrow_move_constructible_v<F>, "TaskGraph: closure must be nothrow movable");
+        Node& n = nodes_.emplace_back();
+        ::new (static_cast<void*>(n.storage)) F(std::forward<Fn>(fn));
+        n.ops = &ops_for<F>;
+        n.name = name;
+        n.prio = prio;
+        compiled_ = false;
+        return (NodeId)(nodes_.size() - 1);
+    }
+
+    void precede(NodeId before, NodeId after);
+    bool compile();
+    void run(JobSystem& js);
+    void clear();
+
+    std::size_t node_count() const { return nodes_.size(); }
+    std::size_t edge_count() const { return edges_.size(); }
+
+private:
+    struct Ops {
+        void (*invoke)(void*);
+        void (*relocate)(void* dst, void* src);
+        void (*destroy)(void*);
+    };
+
+    template <class F>
+    static constexpr Ops ops_for{
+        +[](void* p) { (*static_cast<F*>(p))(); },
+        +[](void* dst, void* src) {
+            ::new (dst) F(std::move(*static_cast<F*>(src)));
+            static_cast<F*>(src)->~F();
+        },
+        +[](void* p) { static_cast<F*>(p)->~F(); }
+    };
+
+    struct Node {
+        alignas(std::max_align_t) std::byte storage[INLINE_BYTES];
+        const Ops* ops{};
+        TaskGraph* graph{};
+        const char* name{};
+        Priority prio{Priority::Normal};
+        std::uint32_t first_succ{};
+        std::uint32_t succ_count{};
+        std::uint32_t indegree{};
+        std::atomic<std::uint32_t> pending{0};
+
+        Node() = default;
+        Node(Node&& o) noexcept
+            : ops(o.ops), graph(o.graph), name(o.name), prio(o.prio),
+              first_succ(o.first_succ), succ_count(o.succ_count), indegree(o.indegree) {
+            if (ops) ops->relocate(storage, o.storage);
+            o.ops = nullptr;
+        }
+        Node& operator=(Node&&) = delete;
+        ~Node() { if (ops) ops->destroy(storage); }
+    };
+
+    static void node_job(void* p);
+
+    std::vector<Node> nodes_;
+    std::vector<std::pair<NodeId, NodeId>> edges_;
+    std::vector<NodeId> succ_;
+    std::vector<NodeId> roots_;
+    JobSystem* js_{};
+    JobSystem::Counter done_;
+    bool compiled_{false};
+};
+
+}
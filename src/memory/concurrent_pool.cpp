@@ -0,0 +1,213 @@
+#include "concurrent_pool.hpp"
+
+#include <algorithm>
+#include <new>
+
+namespace cube::mem {
+
+namespace {
+
+static_assert(sizeof(void*) == 8, "ConcurrentPool packs a 16-bit tag above a 48-bit pointer");
+
+constexpr std::uint64_t PTR_MASK = (1ull << 48) - 1ull;
+constexpr std::uint64_t TAG_ONE = 1ull << 48;
+constexpr std::uint32_t NO_SLOT = ~0u;
+static_assert(ConcurrentPool::MAX_MAGAZINE < (1u << 16));
+
+// Small dense thread index shared by every pool, recycled when a thread exits so long-running
+// programs that create and join threads keep landing on a bounded set of magazines.
+std::mutex g_slot_m;
+std::vector<std::uint32_t> g_free_slots;
+std::uint32_t g_next_slot = 0;
+
+struct ThreadSlot {
+    std::uint32_t index{NO_SLOT};
+
+    ~ThreadSlot() {
+        if (index == NO_SLOT) return;
+        std::scoped_lock lk(g_slot_m);
+        g_free_slots.push_back(index);
+    }
+};
+
+thread_local ThreadSlot t_slot;
+
+std::uint32_t thread_slot() {
+    if (t_slot.index != NO_SLOT) return t_slot.index;
+    std::scoped_lock lk(g_slot_m);
+    if (!g_free_slots.empty()) {
+        t_slot.index = g_free_slots.back();
+        g_free_slots.pop_back();
+    } else {
+        t_slot.index = g_next_slot++;
+    }
+    return t_slot.index;
+}
+
+}
+
+ConcurrentPool::~ConcurrentPool() {
+    release();
+}
+
+void ConcurrentPool::release() {
+    std::scoped_lock lk(slab_m_);
+    if (!slab_source_) {
+        for (void* s : slabs_) ::operator delete(s, std::align_val_t{align_});
+    }
+    slabs_.clear();
+    stack_.store(0, std::memory_order_relaxed);
+    block_count_.store(0, std::memory_order_relaxed);
+    for (auto& m : magazines_) {
+        m.head = nullptr;
+        m.count = 0;
+        m.allocs.store(0, std::memory_order_relaxed);
+        m.frees.store(0, std::memory_order_relaxed);
+    }
+    shared_allocs_.store(0, std::memory_order_relaxed);
+    shared_frees_.store(0, std::memory_order_relaxed);
+}
+
+bool ConcurrentPool::init(std::size_t block_size, std::size_t align, std::size_t slab_bytes, std::uint32_t magazine_size, std::size_t max_bytes) {
+    release();
+    if (block_size == 0 || align == 0 || (align & (align - 1)) != 0) return false;
+    align_ = std::max(align, alignof(FreeBlock));
+    block_size_ = align_up(std::max(block_size, sizeof(FreeBlock)), align_);
+    slab_bytes_ = std::max(slab_bytes, block_size_);
+    max_bytes_ = max_bytes;
+    magazine_size_ = std::clamp<std::uint32_t>(magazine_size, 1u, MAX_MAGAZINE);
+    return true;
+}
+
+ConcurrentPool::Magazine* ConcurrentPool::magazine() {
+    const std::uint32_t slot = thread_slot();
+    return slot < MAX_THREADS ? &magazines_[slot] : nullptr;
+}
+
+std::uint32_t ConcurrentPool::chain_count(const FreeBlock* head) {
+    return (std::uint32_t)(head->chain.load(std::memory_order_relaxed) >> 48);
+}
+
+void ConcurrentPool::push_chain(FreeBlock* head, std::uint32_t count) {
+    std::uint64_t old = stack_.load(std::memory_order_relaxed);
+    for (;;) {
+        head->chain.store((old & PTR_MASK) | ((std::uint64_t)count << 48), std::memory_order_relaxed);
+        const std::uint64_t next = (reinterpret_cast<std::uint64_t>(head) & PTR_MASK) | ((old & ~PTR_MASK) + TAG_ONE);
+        if (stack_.compare_exchange_weak(old, next, std::memory_order_release, std::memory_order_relaxed)) return;
+    }
+}
+
+ConcurrentPool::FreeBlock* ConcurrentPool::pop_chain() {
+    std::uint64_t old = stack_.load(std::memory_order_acquire);
+    for (;;) {
+        FreeBlock* head = reinterpret_cast<FreeBlock*>(old & PTR_MASK);
+        if (!head) return nullptr;
+        // head may already have been popped and handed out by another thread; slabs are never unmapped
+        // while the pool lives, so the read is safe and the tagged CAS below rejects the stale value.
+        const std::uint64_t next = head->chain.load(std::memory_order_relaxed) & PTR_MASK;
+        const std::uint64_t want = next | ((old & ~PTR_MASK) + TAG_ONE);
+        if (stack_.compare_exchange_weak(old, want, std::memory_order_acquire, std::memory_order_acquire)) return head;
+    }
+}
+
+ConcurrentPool::FreeBlock* ConcurrentPool::grow() {
+    std::scoped_lock lk(slab_m_);
+    // Another thread may have grown the pool or returned a chain while we waited for the lock.
+    if (FreeBlock* c = pop_chain()) return c;
+    if (!block_size_) return nullptr;
+    if (max_bytes_ && (slabs_.size() + 1) * slab_bytes_ > max_bytes_) return nullptr;
+    void* slab = slab_source_ ? slab_source_(slab_source_ctx_, slab_bytes_, align_) : ::operator new(slab_bytes_, std::align_val_t{align_}, std::nothrow);
+    if (!slab) return nullptr;
+    slabs_.push_back(slab);
+    const std::size_t n = slab_bytes_ / block_size_;
+    block_count_.fetch_add(n, std::memory_order_relaxed);
+
+    std::byte* base = static_cast<std::byte*>(slab);
+    FreeBlock* first = nullptr;
+    for (std::size_t i = 0; i < n; i += magazine_size_) {
+        const std::size_t end = std::min(n, i + magazine_size_);
+        FreeBlock* head = nullptr;
+        for (std::size_t j = end; j-- > i;) head = new (base + j * block_size_) FreeBlock{head, {0}};
+        if (!first) {
+            first = head;
+            first->chain.store((std::uint64_t)(end - i) << 48, std::memory_order_relaxed);
+        } else {
+            push_chain(head, (std::uint32_t)(end - i));
+        }
+    }
+    return first;
+}
+
+void* ConcurrentPool::alloc(std::size_t size, std::size_t align) {
+    if (size == 0 || size > block_size_ || align > align_) return nullptr;
+    Magazine* m = magazine();
+    if (!m) {
+        FreeBlock* c = pop_chain();
+        if (!c) c = grow();
+        if (!c) return nullptr;
+        // No magazine to park the rest of the chain in; give it straight back.
+        if (c->next) push_chain(c->next, chain_count(c) - 1);
+        shared_allocs_.fetch_add(1, std::memory_order_relaxed);
+        return c;
+    }
+    if (!m->count) {
+        FreeBlock* c = pop_chain();
+        if (!c) c = grow();
+        if (!c) return nullptr;
+        m->head = c;
+        m->count = chain_count(c);
+    }
+    FreeBlock* b = m->head;
+    m->head = b->next;
+    m->count--;
+    m->allocs.store(m->allocs.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return b;
+}
+
+void ConcurrentPool::free(void* p) {
+    if (!p) return;
+    FreeBlock* b = new (p) FreeBlock{nullptr, {0}};
+    Magazine* m = magazine();
+    if (!m) {
+        push_chain(b, 1);
+        shared_frees_.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    if (m->count >= magazine_size_) {
+        push_chain(m->head, m->count);
+        m->head = nullptr;
+        m->count = 0;
+    }
+    b->next = m->head;
+    m->head = b;
+    m->count++;
+    m->frees.store(m->frees.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+void ConcurrentPool::flush_thread_cache() {
+    Magazine* m = magazine();
+    if (!m || !m->count) return;
+    push_chain(m->head, m->count);
+    m->head = nullptr;
+    m->count = 0;
+}
+
+AllocStats ConcurrentPool::stats() const {
+    AllocStats s{};
+    s.alloc_count = shared_allocs_.load(std::memory_order_relaxed);
+    s.free_count = shared_frees_.load(std::memory_order_relaxed);
+    for (const auto& m : magazines_) {
+        s.alloc_count += m.allocs.load(std::memory_order_relaxed);
+        s.free_count += m.frees.load(std::memory_order_relaxed);
+    }
+    s.bytes_in_use = s.alloc_count > s.free_count ? (std::size_t)(s.alloc_count - s.free_count) * block_size_ : 0;
+    s.peak_bytes_in_use = slab_count() * slab_bytes_;
+    return s;
+}
+
+std::size_t ConcurrentPool::slab_count() const {
+    std::scoped_lock lk(slab_m_);
+    return slabs_.size();
+}
+
+} // namespace cube::mem
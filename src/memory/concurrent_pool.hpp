@@ -0,0 +1,100 @@
+#pragma once
+
+#include "allocator.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace cube::mem {
+
+// Fixed-size block pool that any thread may allocate from and free into. Each thread keeps a magazine
+// (a chain of up to magazine_size free blocks) and only touches the shared state when its magazine
+// runs dry or fills up, exchanging whole chains with a lock-free Treiber stack. The stack head packs
+// a 16-bit ABA tag above a 48-bit pointer. The pool grows by whole slabs and only returns memory when
+// destroyed; blocks freed on one thread are reused by whichever thread pops their chain.
+class ConcurrentPool final : public IAllocator {
+public:
+    static constexpr std::uint32_t MAX_MAGAZINE = 256;
+    static constexpr std::uint32_t DEFAULT_MAGAZINE = 64;
+    static constexpr std::size_t DEFAULT_SLAB_BYTES = 64 * 1024;
+    static constexpr std::uint32_t MAX_THREADS = 128;
+
+    // Optional slab provider (e.g. a shared reserved range). Slabs it returns are owned by the provider
+    // and are not freed by the pool; nullptr means out of memory.
+    using SlabSource = void* (*)(void* ctx, std::size_t bytes, std::size_t align);
+
+    ConcurrentPool() = default;
+    ConcurrentPool(std::size_t block_size, std::size_t align = alignof(std::max_align_t)) { init(block_size, align); }
+    ~ConcurrentPool() override;
+
+    ConcurrentPool(const ConcurrentPool&) = delete;
+    ConcurrentPool& operator=(const ConcurrentPool&) = delete;
+
+    // Not thread-safe; call before sharing the pool. max_bytes == 0 lets the pool grow without bound.
+    bool init(std::size_t block_size, std::size_t align = alignof(std::max_align_t), std::size_t slab_bytes = DEFAULT_SLAB_BYTES,
+              std::uint32_t magazine_size = DEFAULT_MAGAZINE, std::size_t max_bytes = 0);
+
+    // size and align must fit the configured block; p passed to free() must come from this pool.
+    void* alloc(std::size_t size, std::size_t align = alignof(std::max_align_t)) override;
+    void free(void* p) override;
+    // peak_bytes_in_use reports the slab footprint, the most the pool has ever needed to hold.
+    AllocStats stats() const override;
+
+    // Must be set before the first alloc().
+    void set_slab_source(SlabSource fn, void* ctx) {
+        slab_source_ = fn;
+        slab_source_ctx_ = ctx;
+    }
+
+    // Hands the calling thread's magazine back to the shared stack, e.g. before the thread exits.
+    void flush_thread_cache();
+
+    std::size_t block_size() const { return block_size_; }
+    std::size_t slab_count() const;
+    std::size_t block_count() const { return block_count_.load(std::memory_order_relaxed); }
+
+private:
+    // 16 bytes, so 16-byte blocks need no padding. chain packs the next chain on the shared stack
+    // (low 48 bits) with this chain's block count (high 16); only the head block of a chain uses it.
+    struct FreeBlock {
+        FreeBlock* next;
+        std::atomic<std::uint64_t> chain;
+    };
+
+    struct alignas(64) Magazine {
+        FreeBlock* head{};
+        std::uint32_t count{};
+        std::atomic<std::uint64_t> allocs{0};
+        std::atomic<std::uint64_t> frees{0};
+    };
+
+    Magazine* magazine();
+    static std::uint32_t chain_count(const FreeBlock* head);
+    void push_chain(FreeBlock* head, std::uint32_t count);
+    FreeBlock* pop_chain();
+    FreeBlock* grow();
+    void release();
+
+    std::size_t block_size_{};
+    std::size_t align_{};
+    std::size_t slab_bytes_{};
+    std::size_t max_bytes_{};
+    std::uint32_t magazine_size_{DEFAULT_MAGAZINE};
+
+    alignas(64) std::atomic<std::uint64_t> stack_{0};
+    alignas(64) std::atomic<std::size_t> block_count_{0};
+    std::atomic<std::uint64_t> shared_allocs_{0};
+    std::atomic<std::uint64_t> shared_frees_{0};
+
+    mutable std::mutex slab_m_;
+    std::vector<void*> slabs_;
+    SlabSource slab_source_{};
+    void* slab_source_ctx_{};
+
+    Magazine magazines_[MAX_THREADS];
+};
+
+} // namespace cube::mem
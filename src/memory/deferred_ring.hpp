@@ -0,0 +1,127 @@
+#pragma once
+
+#include "allocator.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+namespace cube::mem {
+
+// Ring allocator for data the GPU may still be reading. Allocations belong to the open epoch (a frame
+// number or timeline semaphore value) and are reclaimed together, oldest epoch first, once retire()
+// reports that epoch + latency has completed. free() is a no-op. Not thread-safe.
+class DeferredRing final : public IAllocator {
+public:
+    static constexpr std::uint32_t MAX_EPOCHS = 16;
+
+    struct EpochUsage {
+        std::uint64_t epoch{};
+        std::size_t bytes{};
+        std::uint32_t allocs{};
+    };
+
+    DeferredRing() = default;
+    DeferredRing(void* memory, std::size_t size, std::uint32_t latency = 0) { reset(memory, size, latency); }
+
+    void reset(void* memory, std::size_t size, std::uint32_t latency = 0) {
+        base_ = static_cast<std::byte*>(memory);
+        size_ = size;
+        latency_ = latency;
+        stats_ = {};
+        reset();
+    }
+
+    // Epochs must increase. Fails while MAX_EPOCHS are already in flight.
+    bool begin_epoch(std::uint64_t epoch) {
+        if (count_ == MAX_EPOCHS || (count_ && epoch <= newest().epoch)) return false;
+        epochs_[(first_ + count_) % MAX_EPOCHS] = Epoch{{epoch, 0, 0}, head_};
+        count_++;
+        return true;
+    }
+
+    // Reclaims every epoch e with e + latency <= completed.
+    void retire(std::uint64_t completed) {
+        while (count_ && epochs_[first_].use.epoch + latency_ <= completed) {
+            const Epoch& e = epochs_[first_];
+            tail_ = e.end;
+            used_ -= e.use.bytes;
+            stats_.free_count += e.use.allocs;
+            first_ = (first_ + 1) % MAX_EPOCHS;
+            count_--;
+        }
+        stats_.bytes_in_use = used_;
+        if (used_ == 0) {
+            // Empty: restart at the front so the next epoch gets the whole buffer contiguously.
+            head_ = tail_ = 0;
+            for (std::uint32_t i = 0; i < count_; ++i) epochs_[(first_ + i) % MAX_EPOCHS].end = 0;
+        }
+    }
+
+    void* alloc(std::size_t size, std::size_t align = alignof(std::max_align_t)) override {
+        if (!base_ || size == 0 || !count_) return nullptr;
+        std::size_t start = align_up(head_, align);
+        std::size_t consumed = 0;
+        if (head_ < tail_ || (head_ == tail_ && used_ != 0)) {
+            // Live data lies ahead of head: only the gap up to tail is free.
+            if (start > tail_ || size > tail_ - start) return nullptr;
+            consumed = start + size - head_;
+        } else if (start <= size_ && size <= size_ - start) {
+            consumed = start + size - head_;
+        } else {
+            // Skip the unusable end of the buffer and wrap; the skipped bytes count against this epoch.
+            start = 0;
+            if (size > tail_) return nullptr;
+            consumed = size_ - head_ + size;
+        }
+        head_ = start + size;
+        used_ += consumed;
+        Epoch& e = epochs_[(first_ + count_ - 1) % MAX_EPOCHS];
+        e.use.bytes += consumed;
+        e.use.allocs++;
+        e.end = head_;
+        stats_.alloc_count++;
+        stats_.bytes_in_use = used_;
+        stats_.peak_bytes_in_use = (std::max)(stats_.peak_bytes_in_use, stats_.bytes_in_use);
+        return base_ + start;
+    }
+
+    void free(void*) override {}
+
+    // Drops every epoch; only safe once the GPU is idle.
+    void reset() override {
+        head_ = tail_ = used_ = 0;
+        first_ = count_ = 0;
+        stats_.bytes_in_use = 0;
+    }
+
+    AllocStats stats() const override { return stats_; }
+
+    std::size_t capacity() const { return size_; }
+    std::size_t in_flight() const { return used_; }
+    std::uint32_t latency() const { return latency_; }
+    std::uint32_t epoch_count() const { return count_; }
+    // i = 0 is the oldest epoch still in flight.
+    EpochUsage epoch_usage(std::uint32_t i) const { return i < count_ ? epochs_[(first_ + i) % MAX_EPOCHS].use : EpochUsage{}; }
+
+private:
+    struct Epoch {
+        EpochUsage use;
+        std::size_t end{}; // head offset after the epoch's last allocation
+    };
+
+    const EpochUsage& newest() const { return epochs_[(first_ + count_ - 1) % MAX_EPOCHS].use; }
+
+    std::byte* base_{};
+    std::size_t size_{};
+    std::size_t head_{};
+    std::size_t tail_{};
+    std::size_t used_{};
+    std::uint32_t latency_{};
+    Epoch epochs_[MAX_EPOCHS]{};
+    std::uint32_t first_{};
+    std::uint32_t count_{};
+    AllocStats stats_{};
+};
+
+} // namespace cube::mem
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "allocator.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+
+namespace cube::mem {
+
+// Thread-safe malloc wrapper with AllocStats. A small header in front of each block records the
+// requested size and the malloc pointer, so over-aligned requests work everywhere.
+class HeapAllocator final : public IAllocator {
+public:
+    void* alloc(std::size_t size, std::size_t align = alignof(std::max_align_t)) override {
+        if (size == 0) return nullptr;
+        const std::size_t a = (std::max)(align, alignof(Header));
+        void* raw = std::malloc(size + sizeof(Header) + a - 1);
+        if (!raw) return nullptr;
+        const std::size_t user = align_up(reinterpret_cast<std::uintptr_t>(raw) + sizeof(Header), a);
+        auto* h = reinterpret_cast<Header*>(user - sizeof(Header));
+        h->raw = raw;
+        h->size = size;
+        alloc_count_.fetch_add(1, std::memory_order_relaxed);
+        const std::size_t in_use = in_use_.fetch_add(size, std::memory_order_relaxed) + size;
+        std::size_t peak = peak_.load(std::memory_order_relaxed);
+        while (in_use > peak && !peak_.compare_exchange_weak(peak, in_use, std::memory_order_relaxed)) {}
+        return reinterpret_cast<void*>(user);
+    }
+
+    void free(void* p) override {
+        if (!p) return;
+        const Header* h = reinterpret_cast<const Header*>(static_cast<std::byte*>(p) - sizeof(Header));
+        free_count_.fetch_add(1, std::memory_order_relaxed);
+        in_use_.fetch_sub(h->size, std::memory_order_relaxed);
+        std::free(h->raw);
+    }
+
+    AllocStats stats() const override {
+        AllocStats s{};
+        s.bytes_in_use = in_use_.load(std::memory_order_relaxed);
+        s.peak_bytes_in_use = peak_.load(std::memory_order_relaxed);
+        s.alloc_count = alloc_count_.load(std::memory_order_relaxed);
+        s.free_count = free_count_.load(std::memory_order_relaxed);
+        return s;
+    }
+
+private:
+    struct alignas(16) Header {
+        void* raw;
+        std::size_t size;
+    };
+
+    std::atomic<std::size_t> in_use_{0};
+    std::atomic<std::size_t> peak_{0};
+    std::atomic<std::uint64_t> alloc_count_{0};
+    std::atomic<std::uint64_t> free_count_{0};
+};
+
+} // namespace cube::mem
@@ -0,0 +1,318 @@
+#include "heap_profiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#if defined(_WIN32)
+  #include <windows.h>
+  #include <dbghelp.h>
+  #pragma comment(lib, "dbghelp.lib")
+#else
+  #if __has_include(<execinfo.h>)
+    #include <execinfo.h>
+    #define CUBE_HAVE_EXECINFO 1
+  #endif
+  #if __has_include(<cxxabi.h>)
+    #include <cxxabi.h>
+    #define CUBE_HAVE_CXXABI 1
+  #endif
+#endif
+
+namespace cube::mem {
+
+namespace detail {
+thread_local std::int64_t tls_sample_countdown = 0;
+std::atomic<std::uint16_t> g_sample_filter[std::size_t(1) << SAMPLE_FILTER_BITS]{};
+}
+
+namespace {
+
+constexpr std::size_t LIVE_CAPACITY = std::size_t(1) << 16;
+constexpr std::size_t LIVE_LIMIT = LIVE_CAPACITY / 4 * 3;
+constexpr std::size_t STACK_CAPACITY = std::size_t(1) << 12;
+constexpr std::uint32_t NO_STACK = (std::uint32_t)STACK_CAPACITY;
+// Countdown while sampling is off; the thread looks at the rate again after this many bytes.
+constexpr std::int64_t DISABLED_COUNTDOWN = std::int64_t(1) << 30;
+
+struct LiveSample {
+    void* p;
+    std::uint64_t weight;
+    std::uint32_t stack;
+    MemCategory cat;
+};
+
+struct StackEntry {
+    std::uint64_t hash;
+    std::uint32_t depth;
+    std::array<void*, HEAP_PROFILE_MAX_FRAMES> frames;
+};
+
+// Fixed tables so recording a sample never allocates; only touched pages get committed.
+std::mutex g_m;
+LiveSample g_live[LIVE_CAPACITY];
+std::size_t g_live_count = 0;
+StackEntry g_stacks[STACK_CAPACITY];
+std::uint64_t g_dropped = 0;
+
+std::atomic<std::size_t> g_rate{DEFAULT_HEAP_SAMPLE_BYTES};
+
+thread_local MemCategory tls_tag = MemCategory::General;
+thread_local bool tls_in_profiler = false;
+thread_local std::uint64_t tls_rng = 0;
+
+// Allocations made while the profiler itself runs (tables, snapshots, symbols) are not sampled.
+struct ProfilerGuard {
+    bool prev;
+    ProfilerGuard() : prev(tls_in_profiler) { tls_in_profiler = true; }
+    ~ProfilerGuard() { tls_in_profiler = prev; }
+};
+
+std::int64_t next_countdown(std::size_t rate) {
+    if (!rate) return DISABLED_COUNTDOWN;
+    if (!tls_rng) tls_rng = (std::uint64_t)(std::uintptr_t)&tls_rng ^ (std::uint64_t)std::chrono::steady_clock::now().time_since_epoch().count() ^ 0x9e3779b97f4a7c15ull;
+    tls_rng ^= tls_rng << 13;
+    tls_rng ^= tls_rng >> 7;
+    tls_rng ^= tls_rng << 17;
+    // Exponential gap with mean rate: sampling points form a Poisson process over allocated bytes.
+    const double u = ((double)(tls_rng >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+    return (std::int64_t)(-std::log(u) * (double)rate) + 1;
+}
+
+// Kept out of line so the frames to skip are always this function and sample_alloc.
+#if defined(_MSC_VER)
+__declspec(noinline)
+#else
+__attribute__((noinline))
+#endif
+std::uint32_t capture_stack(std::array<void*, HEAP_PROFILE_MAX_FRAMES>& frames) {
+    constexpr int SKIP = 2;
+#if defined(_WIN32)
+    return (std::uint32_t)RtlCaptureStackBackTrace(SKIP, (DWORD)HEAP_PROFILE_MAX_FRAMES, frames.data(), nullptr);
+#elif defined(CUBE_HAVE_EXECINFO)
+    void* tmp[HEAP_PROFILE_MAX_FRAMES + SKIP];
+    const int n = backtrace(tmp, (int)(HEAP_PROFILE_MAX_FRAMES + SKIP));
+    if (n <= SKIP) return 0;
+    std::copy(tmp + SKIP, tmp + n, frames.begin());
+    return (std::uint32_t)(n - SKIP);
+#else
+    (void)frames;
+    return 0;
+#endif
+}
+
+std::uint32_t intern_stack(const std::array<void*, HEAP_PROFILE_MAX_FRAMES>& frames, std::uint32_t depth) {
+    std::uint64_t h = 0xcbf29ce484222325ull ^ depth;
+    for (std::uint32_t i = 0; i < depth; ++i) h = (h ^ (std::uint64_t)(std::uintptr_t)frames[i]) * 0x100000001b3ull;
+    if (!h) h = 1;
+    for (std::size_t n = 0, i = (std::size_t)h & (STACK_CAPACITY - 1); n < STACK_CAPACITY; ++n, i = (i + 1) & (STACK_CAPACITY - 1)) {
+        StackEntry& e = g_stacks[i];
+        if (!e.hash) {
+            e.hash = h;
+            e.depth = depth;
+            e.frames = frames;
+            return (std::uint32_t)i;
+        }
+        if (e.hash == h && e.depth == depth && std::equal(frames.begin(), frames.begin() + depth, e.frames.begin())) return (std::uint32_t)i;
+    }
+    return NO_STACK;
+}
+
+std::size_t live_home(const void* p) {
+    return (std::size_t)((((std::uint64_t)(std::uintptr_t)p >> 4) * 0xff51afd7ed558ccdull) >> 48) & (LIVE_CAPACITY - 1);
+}
+
+void live_erase(std::size_t i) {
+    // Backward-shift deletion keeps linear probe chains intact without tombstones.
+    std::size_t j = i;
+    for (;;) {
+        j = (j + 1) & (LIVE_CAPACITY - 1);
+        if (!g_live[j].p) break;
+        const std::size_t home = live_home(g_live[j].p);
+        if (((j - home) & (LIVE_CAPACITY - 1)) >= ((j - i) & (LIVE_CAPACITY - 1))) {
+            g_live[i] = g_live[j];
+            i = j;
+        }
+    }
+    g_live[i] = LiveSample{};
+    --g_live_count;
+}
+
+}
+
+MemCategory current_mem_tag() { return tls_tag; }
+
+MemTagScope::MemTagScope(MemCategory c) : prev_(tls_tag) { tls_tag = c; }
+MemTagScope::~MemTagScope() { tls_tag = prev_; }
+
+void set_heap_sample_rate(std::size_t bytes) {
+    g_rate.store(bytes, std::memory_order_relaxed);
+    detail::tls_sample_countdown = next_countdown(bytes);
+}
+
+std::size_t heap_sample_rate() { return g_rate.load(std::memory_order_relaxed); }
+
+void detail::sample_alloc(void* p, std::size_t size, MemCategory c) {
+    const std::size_t rate = g_rate.load(std::memory_order_relaxed);
+    // A thread's first trip through here (countdown still zero, generator unseeded) only arms it.
+    const bool armed = tls_rng != 0;
+    tls_sample_countdown = next_countdown(rate);
+    if (!p || !rate || !armed || tls_in_profiler) return;
+    ProfilerGuard guard;
+
+    // Unbiased estimate of the bytes this sample stands for: size / P(sampled).
+    const double s = (double)size;
+    const double weight = s / -std::expm1(-s / (double)rate);
+
+    std::array<void*, HEAP_PROFILE_MAX_FRAMES> frames{};
+    const std::uint32_t depth = capture_stack(frames);
+
+    std::scoped_lock lk(g_m);
+    if (g_live_count >= LIVE_LIMIT) {
+        ++g_dropped;
+        return;
+    }
+    const std::uint32_t stack = intern_stack(frames, depth);
+    std::size_t i = live_home(p);
+    while (g_live[i].p) i = (i + 1) & (LIVE_CAPACITY - 1);
+    g_live[i] = LiveSample{p, (std::uint64_t)weight, stack, c};
+    ++g_live_count;
+    g_sample_filter[sample_filter_slot(p)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void detail::sample_free(void* p) {
+    std::scoped_lock lk(g_m);
+    for (std::size_t i = live_home(p); g_live[i].p; i = (i + 1) & (LIVE_CAPACITY - 1)) {
+        if (g_live[i].p != p) continue;
+        live_erase(i);
+        g_sample_filter[sample_filter_slot(p)].fetch_sub(1, std::memory_order_relaxed);
+        return;
+    }
+}
+
+HeapProfile heap_profile_snapshot() {
+    ProfilerGuard guard;
+    HeapProfile out;
+    out.sample_rate = heap_sample_rate();
+    std::vector<LiveSample> live;
+    {
+        std::scoped_lock lk(g_m);
+        live.reserve(g_live_count);
+        for (const LiveSample& s : g_live) if (s.p) live.push_back(s);
+        out.dropped_samples = g_dropped;
+    }
+    out.live_samples = (std::uint32_t)live.size();
+
+    // Interned stacks are never moved or rewritten, so they can be read after the lock is released.
+    std::unordered_map<std::uint64_t, std::size_t> by_site;
+    for (const LiveSample& s : live) {
+        out.total_bytes += s.weight;
+        out.category_bytes[(std::size_t)s.cat] += s.weight;
+        const std::uint64_t key = ((std::uint64_t)s.stack << 8) | (std::uint64_t)s.cat;
+        auto [it, inserted] = by_site.try_emplace(key, out.sites.size());
+        if (inserted) {
+            HeapProfileSite site;
+            site.category = s.cat;
+            if (s.stack != NO_STACK) {
+                site.depth = g_stacks[s.stack].depth;
+                site.frames = g_stacks[s.stack].frames;
+            }
+            out.sites.push_back(site);
+        }
+        HeapProfileSite& site = out.sites[it->second];
+        site.bytes += s.weight;
+        site.samples++;
+    }
+    std::sort(out.sites.begin(), out.sites.end(), [](const HeapProfileSite& a, const HeapProfileSite& b) { return a.bytes > b.bytes; });
+    return out;
+}
+
+std::string heap_profile_symbol(void* pc) {
+    ProfilerGuard guard;
+    static std::mutex m;
+    static std::unordered_map<void*, std::string> cache;
+    std::scoped_lock lk(m);
+    if (auto it = cache.find(pc); it != cache.end()) return it->second;
+
+    char buf[512];
+    std::snprintf(buf, sizeof(buf), "%p", pc);
+    std::string name = buf;
+#if defined(_WIN32)
+    static bool sym_ready = false;
+    HANDLE process = GetCurrentProcess();
+    if (!sym_ready) {
+        SymSetOptions(SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS | SYMOPT_LOAD_LINES);
+        sym_ready = SymInitialize(process, nullptr, TRUE) != FALSE;
+    }
+    alignas(SYMBOL_INFO) char sym_buf[sizeof(SYMBOL_INFO) + 256];
+    auto* sym = reinterpret_cast<SYMBOL_INFO*>(sym_buf);
+    sym->SizeOfStruct = sizeof(SYMBOL_INFO);
+    sym->MaxNameLen = 255;
+    DWORD64 disp = 0;
+    if (sym_ready && SymFromAddr(process, (DWORD64)(std::uintptr_t)pc, &disp, sym)) {
+        name = sym->Name;
+        IMAGEHLP_LINE64 line{};
+        line.SizeOfStruct = sizeof(line);
+        DWORD line_disp = 0;
+        if (SymGetLineFromAddr64(process, (DWORD64)(std::uintptr_t)pc, &line_disp, &line)) {
+            std::snprintf(buf, sizeof(buf), " (%s:%lu)", line.FileName, (unsigned long)line.LineNumber);
+            name += buf;
+        }
+    }
+#elif defined(CUBE_HAVE_EXECINFO)
+    if (char** syms = backtrace_symbols(&pc, 1)) {
+        name = syms[0];
+        // "module(symbol+0x1f) [0x...]": keep the (demangled) symbol when there is one.
+        const auto open = name.find('('), plus = name.find('+', open == std::string::npos ? 0 : open);
+        if (open != std::string::npos && plus != std::string::npos && plus > open + 1) {
+            const std::string symbol = name.substr(open + 1, plus - open - 1);
+            name = symbol;
+#if defined(CUBE_HAVE_CXXABI)
+            int status = 0;
+            if (char* d = abi::__cxa_demangle(symbol.c_str(), nullptr, nullptr, &status)) {
+                if (status == 0) name = d;
+                std::free(d);
+            }
+#endif
+        }
+        std::free(syms);
+    }
+#endif
+    cache.emplace(pc, name);
+    return name;
+}
+
+std::string heap_profile_call_site(const HeapProfileSite& s) {
+    static const char* const plumbing[] = {"operator new", "heap_profile", "cube::mem::", "std::", "__gnu_cxx::", "_Allocate", "malloc"};
+    for (std::uint32_t i = 0; i < s.depth; ++i) {
+        std::string name = heap_profile_symbol(s.frames[i]);
+        const bool skip = std::any_of(std::begin(plumbing), std::end(plumbing), [&](const char* p) { return name.find(p) != std::string::npos; });
+        if (!skip) return name;
+    }
+    return s.depth ? heap_profile_symbol(s.frames[0]) : std::string("<no stack>");
+}
+
+bool heap_profile_dump(const std::string& path) {
+    const HeapProfile prof = heap_profile_snapshot();
+    ProfilerGuard guard;
+    std::FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    std::fprintf(f, "# cube heap profile\n# sample_rate %zu bytes, live samples %u, dropped %llu, estimated live bytes %llu\n",
+        prof.sample_rate, prof.live_samples, (unsigned long long)prof.dropped_samples, (unsigned long long)prof.total_bytes);
+    for (std::size_t i = 0; i < MEM_CATEGORY_COUNT; ++i) {
+        std::fprintf(f, "# category %s %llu\n", category_name((MemCategory)i), (unsigned long long)prof.category_bytes[i]);
+    }
+    for (std::size_t i = 0; i < prof.sites.size(); ++i) {
+        const HeapProfileSite& s = prof.sites[i];
+        std::fprintf(f, "\nsite %zu: %llu bytes, %u samples, %s\n", i, (unsigned long long)s.bytes, s.samples, category_name(s.category));
+        for (std::uint32_t d = 0; d < s.depth; ++d) std::fprintf(f, "  #%u %s\n", d, heap_profile_symbol(s.frames[d]).c_str());
+    }
+    return std::fclose(f) == 0;
+}
+
+} // namespace cube::mem
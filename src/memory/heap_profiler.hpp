@@ -0,0 +1,91 @@
+#pragma once
+
+#include "memory_category.hpp"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cube::mem {
+
+// Sampling heap profiler. Each thread counts down a randomised byte budget (mean: the sample rate)
+// and only an allocation that exhausts it takes the slow path, which records a backtrace and the
+// thread's category tag in the live-sample table. Frees check a small counting filter before looking
+// anything up, so unsampled traffic never takes a lock.
+inline constexpr std::size_t HEAP_PROFILE_MAX_FRAMES = 16;
+inline constexpr std::size_t DEFAULT_HEAP_SAMPLE_BYTES = 512 * 1024;
+
+// Category the current thread's untagged allocations (global new) are filed under.
+MemCategory current_mem_tag();
+
+class MemTagScope {
+public:
+    explicit MemTagScope(MemCategory c);
+    ~MemTagScope();
+
+    MemTagScope(const MemTagScope&) = delete;
+    MemTagScope& operator=(const MemTagScope&) = delete;
+
+private:
+    MemCategory prev_;
+};
+
+// 0 disables sampling. A change reaches each thread when its current countdown runs out.
+void set_heap_sample_rate(std::size_t bytes);
+std::size_t heap_sample_rate();
+
+namespace detail {
+inline constexpr unsigned SAMPLE_FILTER_BITS = 16;
+extern thread_local std::int64_t tls_sample_countdown;
+extern std::atomic<std::uint16_t> g_sample_filter[std::size_t(1) << SAMPLE_FILTER_BITS];
+void sample_alloc(void* p, std::size_t size, MemCategory c);
+void sample_free(void* p);
+
+inline std::size_t sample_filter_slot(const void* p) {
+    return (std::size_t)((((std::uint64_t)(std::uintptr_t)p >> 4) * 0x9e3779b97f4a7c15ull) >> (64 - SAMPLE_FILTER_BITS));
+}
+}
+
+// Allocator hooks: call after a successful allocation and before the block is released.
+inline void heap_profile_alloc(void* p, std::size_t size, MemCategory c) {
+    if ((detail::tls_sample_countdown -= (std::int64_t)size) > 0) return;
+    detail::sample_alloc(p, size, c);
+}
+
+inline void heap_profile_alloc(void* p, std::size_t size) {
+    if ((detail::tls_sample_countdown -= (std::int64_t)size) > 0) return;
+    detail::sample_alloc(p, size, current_mem_tag());
+}
+
+inline void heap_profile_free(void* p) {
+    if (!p || !detail::g_sample_filter[detail::sample_filter_slot(p)].load(std::memory_order_relaxed)) return;
+    detail::sample_free(p);
+}
+
+struct HeapProfileSite {
+    std::uint64_t bytes{}; // estimated live bytes represented by the samples
+    std::uint32_t samples{};
+    MemCategory category{MemCategory::General};
+    std::uint32_t depth{};
+    std::array<void*, HEAP_PROFILE_MAX_FRAMES> frames{};
+};
+
+struct HeapProfile {
+    std::size_t sample_rate{};
+    std::uint64_t total_bytes{};
+    std::uint32_t live_samples{};
+    std::uint64_t dropped_samples{};
+    std::array<std::uint64_t, MEM_CATEGORY_COUNT> category_bytes{};
+    std::vector<HeapProfileSite> sites; // largest first
+};
+
+HeapProfile heap_profile_snapshot();
+std::string heap_profile_symbol(void* pc);
+// First frame outside the allocator plumbing (operator new, std containers, this profiler).
+std::string heap_profile_call_site(const HeapProfileSite& s);
+bool heap_profile_dump(const std::string& path);
+
+} // namespace cube::mem
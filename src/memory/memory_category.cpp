@@ -0,0 +1,71 @@
+#include "memory_category.hpp"
+
+#include "heap_allocator.hpp"
+#include "heap_profiler.hpp"
+#include "pmr.hpp"
+
+#include <array>
+#include <atomic>
+
+namespace cube::mem {
+
+namespace {
+
+std::array<HeapAllocator, MEM_CATEGORY_COUNT> g_heaps;
+std::array<std::atomic<IAllocator*>, MEM_CATEGORY_COUNT> g_override{};
+
+class CategoryResource final : public std::pmr::memory_resource {
+public:
+    MemCategory cat{MemCategory::General};
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t align) override {
+        void* p = category_allocator(cat).alloc(bytes ? bytes : 1, align);
+        if (!p) throw std::bad_alloc();
+        heap_profile_alloc(p, bytes, cat);
+        return p;
+    }
+    void do_deallocate(void* p, std::size_t, std::size_t) override {
+        heap_profile_free(p);
+        category_allocator(cat).free(p);
+    }
+    bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override { return this == &o; }
+};
+
+std::array<CategoryResource, MEM_CATEGORY_COUNT> make_resources() {
+    std::array<CategoryResource, MEM_CATEGORY_COUNT> r;
+    for (std::size_t i = 0; i < r.size(); ++i) r[i].cat = (MemCategory)i;
+    return r;
+}
+
+}
+
+const char* category_name(MemCategory c) {
+    switch (c) {
+        case MemCategory::General: return "General";
+        case MemCategory::Voxel: return "Voxel";
+        case MemCategory::Mesh: return "Mesh";
+        case MemCategory::Render: return "Render";
+        case MemCategory::Log: return "Log";
+        case MemCategory::Jobs: return "Jobs";
+        default: return "?";
+    }
+}
+
+IAllocator& category_allocator(MemCategory c) {
+    const std::size_t i = (std::size_t)c < MEM_CATEGORY_COUNT ? (std::size_t)c : 0;
+    IAllocator* a = g_override[i].load(std::memory_order_acquire);
+    return a ? *a : g_heaps[i];
+}
+
+void set_category_allocator(MemCategory c, IAllocator* a) {
+    if ((std::size_t)c >= MEM_CATEGORY_COUNT) return;
+    g_override[(std::size_t)c].store(a, std::memory_order_release);
+}
+
+std::pmr::memory_resource* category_resource(MemCategory c) {
+    static std::array<CategoryResource, MEM_CATEGORY_COUNT> resources = make_resources();
+    return &resources[(std::size_t)c < MEM_CATEGORY_COUNT ? (std::size_t)c : 0];
+}
+
+} // namespace cube::mem
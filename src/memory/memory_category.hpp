@@ -0,0 +1,35 @@
+#pragma once
+
+#include "allocator.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cube::mem {
+
+// Engine subsystems allocate through their category's allocator. Every category starts on its own
+// HeapAllocator (malloc with stats); the app can opt a category into something faster at startup.
+enum class MemCategory : std::uint8_t { General, Voxel, Mesh, Render, Log, Jobs, Count };
+inline constexpr std::size_t MEM_CATEGORY_COUNT = (std::size_t)MemCategory::Count;
+
+const char* category_name(MemCategory c);
+IAllocator& category_allocator(MemCategory c);
+// nullptr restores the category's default heap. Blocks must be freed through the allocator that
+// produced them, so switch before the subsystem allocates and switch back after it has released all.
+void set_category_allocator(MemCategory c, IAllocator* a);
+
+// Points a category at an allocator for the lifetime of the object. Declare it after the allocator and
+// before the containers that use the category, so they are destroyed while the switch is still in place.
+class ScopedCategoryAllocator {
+public:
+    ScopedCategoryAllocator(MemCategory c, IAllocator* a) : cat_(c) { set_category_allocator(c, a); }
+    ~ScopedCategoryAllocator() { set_category_allocator(cat_, nullptr); }
+
+    ScopedCategoryAllocator(const ScopedCategoryAllocator&) = delete;
+    ScopedCategoryAllocator& operator=(const ScopedCategoryAllocator&) = delete;
+
+private:
+    MemCategory cat_;
+};
+
+} // namespace cube::mem
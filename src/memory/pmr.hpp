@@ -0,0 +1,61 @@
+#pragma once
+
+#include "allocator.hpp"
+#include "memory_category.hpp"
+
+#include <cstddef>
+#include <list>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace cube::mem {
+
+// std::pmr::memory_resource over an IAllocator, so standard containers can allocate from any of our
+// allocators. The adapter must outlive every container using it; two adapters compare equal when they
+// wrap the same allocator.
+class AllocatorResource final : public std::pmr::memory_resource {
+public:
+    explicit AllocatorResource(IAllocator& a) : alloc_(&a) {}
+
+    IAllocator& allocator() const { return *alloc_; }
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t align) override {
+        void* p = alloc_->alloc(bytes ? bytes : 1, align);
+        if (!p) throw std::bad_alloc();
+        return p;
+    }
+    void do_deallocate(void* p, std::size_t, std::size_t) override { alloc_->free(p); }
+    bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override {
+        const auto* r = dynamic_cast<const AllocatorResource*>(&o);
+        return r && r->alloc_ == alloc_;
+    }
+
+    IAllocator* alloc_;
+};
+
+// Resource that forwards to category_allocator(c) on every call, so containers built before the app
+// picks a category's allocator still follow the switch (see set_category_allocator for the rules).
+std::pmr::memory_resource* category_resource(MemCategory c);
+
+namespace pmr {
+
+using allocator = std::pmr::polymorphic_allocator<std::byte>;
+
+template <class T>
+using vector = std::pmr::vector<T>;
+
+template <class T>
+using list = std::pmr::list<T>;
+
+template <class K, class V, class Hash = std::hash<K>, class Eq = std::equal_to<K>>
+using unordered_map = std::pmr::unordered_map<K, V, Hash, Eq>;
+
+using string = std::pmr::string;
+
+}
+
+} // namespace cube::mem
@@ -0,0 +1,101 @@
+#include "slab_allocator.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace cube::mem {
+
+static_assert(SlabAllocator::CLASS_COUNT < 255, "chunk map stores class + 1 in a byte");
+
+static std::size_t natural_align(std::uint32_t c) {
+    const std::size_t size = SlabAllocator::class_size(c);
+    return std::min<std::size_t>(size & (~size + 1), SlabAllocator::MAX_ALIGN);
+}
+
+std::uint32_t SlabAllocator::class_of(std::size_t size, std::size_t align) {
+    if (size > MAX_SMALL || align > MAX_ALIGN) return CLASS_COUNT;
+    std::uint32_t c = 0;
+    if (size > 16) {
+        // 2^(k-1) < size <= 2^k; the class in between is 1.5 * 2^(k-1).
+        const std::uint32_t k = (std::uint32_t)std::bit_width(size - 1);
+        c = size <= ((std::size_t)3 << (k - 2)) ? 2 * k - 9 : 2 * k - 8;
+    }
+    while (c < CLASS_COUNT && natural_align(c) < align) ++c;
+    return c;
+}
+
+bool SlabAllocator::init(std::size_t reserve_bytes, PageSize pages) {
+    if (!range_.init(align_up(reserve_bytes, CHUNK_BYTES), CHUNK_BYTES, VirtualArena::RETAIN_ALL, pages)) return false;
+    chunk_class_.assign(range_.capacity() / CHUNK_BYTES, 0);
+    for (std::uint32_t c = 0; c < CLASS_COUNT; ++c) {
+        const std::size_t size = class_size(c);
+        // Keep at least eight blocks per slab and cap what one thread can park per class at ~64 KB.
+        const std::size_t slab = std::max(CHUNK_BYTES, std::bit_ceil(size * 8));
+        const std::uint32_t magazine = (std::uint32_t)std::clamp<std::size_t>(CHUNK_BYTES / size, 4, ConcurrentPool::DEFAULT_MAGAZINE);
+        sources_[c] = ClassSource{this, (std::uint8_t)c};
+        classes_[c].init(size, natural_align(c), slab, magazine);
+        classes_[c].set_slab_source(&carve_slab, &sources_[c]);
+    }
+    return true;
+}
+
+void* SlabAllocator::carve_slab(void* ctx, std::size_t bytes, std::size_t align) {
+    (void)align;
+    auto* src = static_cast<ClassSource*>(ctx);
+    SlabAllocator& self = *src->owner;
+    std::scoped_lock lk(self.range_m_);
+    void* p = self.range_.alloc(bytes, CHUNK_BYTES);
+    if (!p) return nullptr;
+    const std::size_t first = (std::size_t)(static_cast<const std::byte*>(p) - self.range_.base()) / CHUNK_BYTES;
+    std::fill_n(self.chunk_class_.begin() + (std::ptrdiff_t)first, bytes / CHUNK_BYTES, (std::uint8_t)(src->cls + 1));
+    return p;
+}
+
+bool SlabAllocator::owns(const void* p) const {
+    const std::byte* b = static_cast<const std::byte*>(p);
+    return range_.base() && b >= range_.base() && b < range_.base() + range_.capacity();
+}
+
+void* SlabAllocator::alloc(std::size_t size, std::size_t align) {
+    if (size == 0) return nullptr;
+    const std::uint32_t c = class_of(size, align);
+    if (c < CLASS_COUNT && range_.base()) {
+        if (void* p = classes_[c].alloc(size, align)) return p;
+    }
+    return large_.alloc(size, align);
+}
+
+void SlabAllocator::free(void* p) {
+    if (!p) return;
+    if (!owns(p)) {
+        large_.free(p);
+        return;
+    }
+    const std::size_t chunk = (std::size_t)(static_cast<const std::byte*>(p) - range_.base()) / CHUNK_BYTES;
+    const std::uint8_t tag = chunk_class_[chunk];
+    if (tag) classes_[tag - 1].free(p);
+}
+
+AllocStats SlabAllocator::stats() const {
+    AllocStats s = large_.stats();
+    for (const auto& pool : classes_) {
+        const AllocStats c = pool.stats();
+        s.bytes_in_use += c.bytes_in_use;
+        s.peak_bytes_in_use += c.peak_bytes_in_use;
+        s.alloc_count += c.alloc_count;
+        s.free_count += c.free_count;
+    }
+    return s;
+}
+
+std::size_t SlabAllocator::committed() const {
+    std::scoped_lock lk(range_m_);
+    return range_.committed();
+}
+
+std::size_t SlabAllocator::huge_bytes() const {
+    std::scoped_lock lk(range_m_);
+    return range_.huge_bytes();
+}
+
+} // namespace cube::mem
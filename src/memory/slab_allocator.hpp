@@ -0,0 +1,70 @@
+#pragma once
+
+#include "allocator.hpp"
+#include "concurrent_pool.hpp"
+#include "heap_allocator.hpp"
+#include "virtual_arena.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace cube::mem {
+
+// General-purpose thread-safe allocator. Requests up to MAX_SMALL bytes are rounded to one of the
+// 2^k / 1.5*2^k size classes (16, 24, 32, 48, ... 32K) and served by a ConcurrentPool per class, so
+// each thread works out of its own magazines and hands blocks back to the shared pool in whole
+// chains. Slabs are carved from one reserved address range; a byte per 64 KB chunk of that range
+// records the class, which lets free() route a pointer without a per-block header. Larger or
+// over-aligned requests go to a HeapAllocator.
+class SlabAllocator final : public IAllocator {
+public:
+    static constexpr std::uint32_t CLASS_COUNT = 23;
+    static constexpr std::size_t MAX_SMALL = 32 * 1024;
+    static constexpr std::size_t MAX_ALIGN = 64;
+    static constexpr std::size_t CHUNK_BYTES = 64 * 1024;
+    static constexpr std::size_t DEFAULT_RESERVE = 16ull * 1024ull * 1024ull * 1024ull;
+
+    SlabAllocator() = default;
+    explicit SlabAllocator(std::size_t reserve_bytes, PageSize pages = PageSize::Default) { init(reserve_bytes, pages); }
+
+    SlabAllocator(const SlabAllocator&) = delete;
+    SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+    // Not thread-safe; call before sharing the allocator.
+    // With PageSize::Huge the slab range is committed in whole huge pages.
+    bool init(std::size_t reserve_bytes = DEFAULT_RESERVE, PageSize pages = PageSize::Default);
+
+    void* alloc(std::size_t size, std::size_t align = alignof(std::max_align_t)) override;
+    void free(void* p) override;
+    AllocStats stats() const override;
+
+    AllocStats class_stats(std::uint32_t c) const { return c < CLASS_COUNT ? classes_[c].stats() : AllocStats{}; }
+    AllocStats large_stats() const { return large_.stats(); }
+    bool owns(const void* p) const;
+    std::size_t committed() const;
+    std::size_t huge_bytes() const;
+
+    static std::size_t class_size(std::uint32_t c) { return (std::size_t)((c & 1u) ? 24u : 16u) << (c / 2u); }
+    // Smallest class that fits size with at least align alignment; CLASS_COUNT if none does.
+    static std::uint32_t class_of(std::size_t size, std::size_t align = 1);
+
+private:
+    struct ClassSource {
+        SlabAllocator* owner{};
+        std::uint8_t cls{};
+    };
+    static void* carve_slab(void* ctx, std::size_t bytes, std::size_t align);
+
+    ConcurrentPool classes_[CLASS_COUNT];
+    ClassSource sources_[CLASS_COUNT];
+    HeapAllocator large_;
+
+    mutable std::mutex range_m_;
+    VirtualArena range_;
+    // Class + 1 for every 64 KB chunk of range_ handed to a pool; 0 for chunks not yet carved.
+    std::vector<std::uint8_t> chunk_class_;
+};
+
+} // namespace cube::mem
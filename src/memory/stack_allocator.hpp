@@ -12,6 +12,19 @@ class StackAllocator final : public IAllocator {
 public:
     using Marker = std::size_t;
 
+    // Pops back to the marker taken at construction.
+    class Scope {
+    public:
+        explicit Scope(StackAllocator& a) : a_(a), m_(a.mark()) {}
+        ~Scope() { a_.pop(m_); }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        StackAllocator& a_;
+        Marker m_;
+    };
+
     StackAllocator() = default;
     StackAllocator(void* memory, std::size_t size) { reset(memory, size); }
 
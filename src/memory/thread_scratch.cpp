@@ -0,0 +1,23 @@
+#include "thread_scratch.hpp"
+
+namespace cube::mem {
+
+namespace {
+
+thread_local StackAllocator* tls_scratch = nullptr;
+
+}
+
+StackAllocator& thread_scratch() {
+    if (tls_scratch) return *tls_scratch;
+    thread_local StackAllocator none;
+    return none;
+}
+
+StackAllocator* set_thread_scratch(StackAllocator* s) {
+    StackAllocator* prev = tls_scratch;
+    tls_scratch = s;
+    return prev;
+}
+
+} // namespace cube::mem
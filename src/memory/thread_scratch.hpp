@@ -0,0 +1,15 @@
+#pragma once
+
+#include "stack_allocator.hpp"
+
+namespace cube::mem {
+
+// The calling thread's scratch stack, installed by whoever owns the thread (the job system installs
+// one per worker and one for its init() thread). Threads without one get an empty stack whose alloc()
+// returns nullptr, so callers fall back to the heap.
+StackAllocator& thread_scratch();
+
+// Installs s as the calling thread's scratch stack (nullptr removes it); returns the previous one.
+StackAllocator* set_thread_scratch(StackAllocator* s);
+
+} // namespace cube::mem
@@ -0,0 +1,120 @@
+#pragma once
+
+#include "allocator.hpp"
+#include "virtual_memory.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+
+namespace cube::mem {
+
+// Bump allocator over a reserved address range. Pages are committed in commit_step chunks as the
+// offset advances, so an allocation only fails past the reservation (or if the OS refuses to commit).
+// reset() decommits everything above retain_bytes; the default keeps all committed pages.
+// PageSize::Huge rounds the commit step and retain mark to whole huge pages so they can be used.
+class VirtualArena final : public IAllocator {
+public:
+    static constexpr std::size_t DEFAULT_COMMIT_STEP = 64 * 1024;
+    static constexpr std::size_t RETAIN_ALL = ~(std::size_t)0;
+
+    VirtualArena() = default;
+    VirtualArena(std::size_t reserve_bytes, std::size_t commit_step = DEFAULT_COMMIT_STEP, std::size_t retain_bytes = RETAIN_ALL, PageSize pages = PageSize::Default) {
+        init(reserve_bytes, commit_step, retain_bytes, pages);
+    }
+    ~VirtualArena() override { release(); }
+
+    VirtualArena(const VirtualArena&) = delete;
+    VirtualArena& operator=(const VirtualArena&) = delete;
+    VirtualArena(VirtualArena&& o) noexcept { *this = static_cast<VirtualArena&&>(o); }
+    VirtualArena& operator=(VirtualArena&& o) noexcept {
+        if (this == &o) return *this;
+        release();
+        base_ = o.base_;
+        reserved_ = o.reserved_;
+        committed_ = o.committed_;
+        offset_ = o.offset_;
+        step_ = o.step_;
+        retain_ = o.retain_;
+        pages_ = o.pages_;
+        stats_ = o.stats_;
+        o.base_ = nullptr;
+        o.reserved_ = o.committed_ = o.offset_ = 0;
+        o.stats_ = {};
+        return *this;
+    }
+
+    bool init(std::size_t reserve_bytes, std::size_t commit_step = DEFAULT_COMMIT_STEP, std::size_t retain_bytes = RETAIN_ALL, PageSize pages = PageSize::Default) {
+        release();
+        const std::size_t huge = pages == PageSize::Huge ? huge_page_size() : 0;
+        const std::size_t page = huge ? huge : page_size();
+        pages_ = pages;
+        step_ = align_up((std::max)(commit_step, page), page);
+        retain_ = retain_bytes == RETAIN_ALL ? RETAIN_ALL : align_up(retain_bytes, page);
+        reserved_ = align_up(reserve_bytes, page);
+        base_ = static_cast<std::byte*>(vm_reserve(reserved_, pages));
+        if (!base_) reserved_ = 0;
+        return base_ != nullptr;
+    }
+
+    void release() {
+        if (base_) vm_release(base_, reserved_);
+        base_ = nullptr;
+        reserved_ = committed_ = offset_ = 0;
+        stats_ = {};
+    }
+
+    void* alloc(std::size_t size, std::size_t align = alignof(std::max_align_t)) override {
+        if (!base_ || size == 0) return nullptr;
+        const std::size_t aligned = align_up(offset_, align);
+        if (aligned > reserved_ || size > reserved_ - aligned) return nullptr;
+        const std::size_t end = aligned + size;
+        if (end > committed_ && !grow(end)) return nullptr;
+        offset_ = end;
+        stats_.alloc_count++;
+        stats_.bytes_in_use = offset_;
+        stats_.peak_bytes_in_use = (std::max)(stats_.peak_bytes_in_use, stats_.bytes_in_use);
+        return base_ + aligned;
+    }
+
+    void free(void*) override {}
+
+    void reset() override {
+        offset_ = 0;
+        stats_.free_count++;
+        stats_.bytes_in_use = 0;
+        if (retain_ != RETAIN_ALL && committed_ > retain_) {
+            vm_decommit(base_ + retain_, committed_ - retain_);
+            committed_ = retain_;
+        }
+    }
+
+    AllocStats stats() const override { return stats_; }
+
+    const std::byte* base() const { return base_; }
+    std::size_t capacity() const { return reserved_; }
+    std::size_t committed() const { return committed_; }
+    std::size_t used() const { return offset_; }
+    PageSize pages() const { return pages_; }
+    // Committed bytes that ended up on huge pages; queries the OS, so not for per-frame use.
+    std::size_t huge_bytes() const { return vm_huge_bytes(base_, committed_); }
+
+private:
+    bool grow(std::size_t end) {
+        const std::size_t target = (std::min)(align_up(end, step_), reserved_);
+        if (!vm_commit(base_ + committed_, target - committed_)) return false;
+        committed_ = target;
+        return true;
+    }
+
+    std::byte* base_{};
+    std::size_t reserved_{};
+    std::size_t committed_{};
+    std::size_t offset_{};
+    std::size_t step_{DEFAULT_COMMIT_STEP};
+    std::size_t retain_{RETAIN_ALL};
+    PageSize pages_{PageSize::Default};
+    AllocStats stats_{};
+};
+
+} // namespace cube::mem
@@ -0,0 +1,148 @@
+#include "virtual_memory.hpp"
+
+#if defined(_WIN32)
+  #include <windows.h>
+  #include <psapi.h>
+  #pragma comment(lib, "psapi.lib")
+#else
+  #include <sys/mman.h>
+  #include <unistd.h>
+  #include <cstdio>
+  #include <cstdint>
+#endif
+
+namespace cube::mem {
+
+std::size_t page_size() {
+    static const std::size_t size = [] {
+#if defined(_WIN32)
+        SYSTEM_INFO si{};
+        GetSystemInfo(&si);
+        return (std::size_t)si.dwPageSize;
+#else
+        const long v = sysconf(_SC_PAGESIZE);
+        return v > 0 ? (std::size_t)v : (std::size_t)4096;
+#endif
+    }();
+    return size;
+}
+
+std::size_t huge_page_size() {
+#if defined(__linux__)
+    static const std::size_t size = [] {
+        std::size_t v = 0;
+        if (std::FILE* f = std::fopen("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r")) {
+            unsigned long long n = 0;
+            if (std::fscanf(f, "%llu", &n) == 1) v = (std::size_t)n;
+            std::fclose(f);
+        }
+        return v;
+    }();
+    return size;
+#else
+    return 0;
+#endif
+}
+
+void* vm_reserve(std::size_t size, PageSize pages) {
+    if (size == 0) return nullptr;
+#if defined(_WIN32)
+    (void)pages;
+    return VirtualAlloc(nullptr, size, MEM_RESERVE, PAGE_NOACCESS);
+#else
+    const std::size_t huge = pages == PageSize::Huge ? huge_page_size() : 0;
+    if (!huge) {
+        void* p = mmap(nullptr, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        return p == MAP_FAILED ? nullptr : p;
+    }
+    // Over-reserve and trim so the range starts on a huge page boundary; otherwise the kernel can only
+    // use huge pages for the aligned middle of it.
+    void* raw = mmap(nullptr, size + huge, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (raw == MAP_FAILED) return nullptr;
+    const std::uintptr_t start = (std::uintptr_t)raw;
+    const std::uintptr_t aligned = (start + huge - 1) & ~(std::uintptr_t)(huge - 1);
+    if (aligned > start) munmap(raw, aligned - start);
+    const std::uintptr_t tail = aligned + size;
+    if (start + size + huge > tail) munmap((void*)tail, start + size + huge - tail);
+#if defined(MADV_HUGEPAGE)
+    madvise((void*)aligned, size, MADV_HUGEPAGE);
+#endif
+    return (void*)aligned;
+#endif
+}
+
+bool vm_commit(void* p, std::size_t size) {
+    if (!p || size == 0) return true;
+#if defined(_WIN32)
+    return VirtualAlloc(p, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+#else
+    return mprotect(p, size, PROT_READ | PROT_WRITE) == 0;
+#endif
+}
+
+void vm_decommit(void* p, std::size_t size) {
+    if (!p || size == 0) return;
+#if defined(_WIN32)
+    VirtualFree(p, size, MEM_DECOMMIT);
+#else
+    madvise(p, size, MADV_DONTNEED);
+    mprotect(p, size, PROT_NONE);
+#endif
+}
+
+void vm_release(void* p, std::size_t size) {
+    if (!p) return;
+#if defined(_WIN32)
+    (void)size;
+    VirtualFree(p, 0, MEM_RELEASE);
+#else
+    munmap(p, size);
+#endif
+}
+
+std::size_t vm_huge_bytes(const void* p, std::size_t size) {
+#if defined(__linux__)
+    if (!p || size == 0) return 0;
+    std::FILE* f = std::fopen("/proc/self/smaps", "r");
+    if (!f) return 0;
+    const std::uintptr_t lo = (std::uintptr_t)p, hi = lo + size;
+    std::size_t total = 0;
+    std::uintptr_t vma_lo = 0, vma_hi = 0;
+    char line[512];
+    while (std::fgets(line, sizeof(line), f)) {
+        unsigned long long a = 0, b = 0, kb = 0;
+        if (std::sscanf(line, "%llx-%llx ", &a, &b) == 2) {
+            vma_lo = (std::uintptr_t)a;
+            vma_hi = (std::uintptr_t)b;
+        } else if (std::sscanf(line, "AnonHugePages: %llu kB", &kb) == 1 && kb && vma_lo < hi && vma_hi > lo) {
+            // Adjacent ranges with the same flags can share a VMA; count at most the overlapping part.
+            const std::uintptr_t overlap = (vma_hi < hi ? vma_hi : hi) - (vma_lo > lo ? vma_lo : lo);
+            const std::size_t bytes = (std::size_t)kb * 1024;
+            total += bytes < overlap ? bytes : (std::size_t)overlap;
+        }
+    }
+    std::fclose(f);
+    return total;
+#else
+    (void)p;
+    (void)size;
+    return 0;
+#endif
+}
+
+std::size_t process_rss() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS pmc{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return 0;
+    return (std::size_t)pmc.WorkingSetSize;
+#else
+    std::FILE* f = std::fopen("/proc/self/statm", "r");
+    if (!f) return 0;
+    unsigned long pages_total = 0, pages_resident = 0;
+    const int n = std::fscanf(f, "%lu %lu", &pages_total, &pages_resident);
+    std::fclose(f);
+    return n == 2 ? (std::size_t)pages_resident * page_size() : 0;
+#endif
+}
+
+} // namespace cube::mem
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace cube::mem {
+
+// Thin OS layer over address-space reservation (VirtualAlloc / mmap). Sizes and addresses passed to
+// commit/decommit must be page aligned; reserve and release take the whole range.
+std::size_t page_size();
+
+// Huge asks for 2 MB pages on the range: Linux aligns the reservation and marks it MADV_HUGEPAGE, so
+// transparent huge pages back it wherever the kernel can find them and 4 KB pages fill in otherwise.
+// Windows large pages need SeLockMemoryPrivilege and must be committed when reserved, which the lazily
+// committed ranges here cannot do, so the hint is ignored there.
+enum class PageSize : std::uint8_t { Default, Huge };
+
+// Huge page size the OS uses for PageSize::Huge, or 0 where the hint has no effect.
+std::size_t huge_page_size();
+void* vm_reserve(std::size_t size, PageSize pages = PageSize::Default);
+bool vm_commit(void* p, std::size_t size);
+// Returns the pages to the OS; the range stays reserved and reads back as zero after a re-commit.
+void vm_decommit(void* p, std::size_t size);
+void vm_release(void* p, std::size_t size);
+
+// Bytes of [p, p + size) currently backed by huge pages, or 0 where unavailable. Reads /proc/self/smaps
+// on Linux, so keep it out of hot paths.
+std::size_t vm_huge_bytes(const void* p, std::size_t size);
+
+// Resident set size of the process in bytes, or 0 where unavailable.
+std::size_t process_rss();
+
+} // namespace cube::mem
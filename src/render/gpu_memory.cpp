@@ -53,8 +53,8 @@ bool GpuMemoryTracker::can_allocate_vram(std::uint64_t bytes) const {
 void GpuMemoryTracker::note_vram_attempt(std::uint64_t bytes) const {
     if (!vram_budget_) return;
     const double next = static_cast<double>(vram_used_ + bytes) / static_cast<double>(vram_budget_);
-    if (next >= 0.95) LOG_ERROR("Memory", "VRAM budget exceeded (%.1f%%)", next * 100.0);
-    else if (next >= 0.80) LOG_WARN("Memory", "VRAM budget high (%.1f%%)", next * 100.0);
+    if (next >= 0.95) LOG_ERROR_LIMITED("Memory", "VRAM budget exceeded (%.1f%%)", next * 100.0);
+    else if (next >= 0.80) LOG_WARN_LIMITED("Memory", "VRAM budget high (%.1f%%)", next * 100.0);
 }
 
 void GpuMemoryTracker::on_alloc(GpuBudgetCategory cat, VmaAllocator allocator, VmaAllocation alloc, std::uint64_t size_bytes) {
@@ -4,10 +4,9 @@
 
 namespace cube::render {
 
-bool GpuUploader::init(VmaAllocator allocator, VkDeviceSize size_bytes) {
+bool GpuUploader::init(VmaAllocator allocator, VkDeviceSize size_bytes, std::size_t cpu_ring_bytes) {
     allocator_ = allocator;
     size_ = size_bytes;
-    offset_ = 0;
     head_ = nullptr;
     tail_ = nullptr;
 
@@ -24,7 +23,11 @@ bool GpuUploader::init(VmaAllocator allocator, VkDeviceSize size_bytes) {
     VmaAllocationInfo info{};
     if (vmaCreateBuffer(allocator, &bi, &ai, &staging_buffer_, &staging_alloc_, &info) != VK_SUCCESS) return false;
     mapped_ = info.pMappedData;
-    return mapped_ != nullptr;
+    if (!mapped_) return false;
+    staging_ring_.reset(mapped_, static_cast<std::size_t>(size_bytes));
+    cpu_backing_.assign(cpu_ring_bytes, std::byte{0});
+    cpu_ring_.reset(cpu_backing_.data(), cpu_backing_.size());
+    return true;
 }
 
 void GpuUploader::shutdown(VmaAllocator allocator) {
@@ -36,31 +39,39 @@ void GpuUploader::shutdown(VmaAllocator allocator) {
     }
     allocator_ = nullptr;
     size_ = 0;
-    offset_ = 0;
+    staging_ring_.reset(nullptr, 0);
+    cpu_ring_.reset(nullptr, 0);
+    cpu_backing_.clear();
+    cpu_backing_.shrink_to_fit();
     head_ = nullptr;
     tail_ = nullptr;
 }
 
-void GpuUploader::begin_frame() {
-    offset_ = 0;
+void GpuUploader::begin_frame(std::uint64_t frame) {
+    staging_ring_.begin_epoch(frame);
+    cpu_ring_.begin_epoch(frame);
     head_ = nullptr;
     tail_ = nullptr;
 }
 
-bool GpuUploader::enqueue_buffer_upload(void* ctx, void* (*alloc_fn)(void*, std::size_t, std::size_t), VkBuffer dst, VkDeviceSize dst_offset, const void* data, VkDeviceSize size) {
-    if (!mapped_ || !dst || !data || size == 0) return false;
-    const VkDeviceSize aligned = (offset_ + 15) & ~VkDeviceSize(15);
-    if (aligned + size > size_) return false;
-    std::memcpy(static_cast<std::byte*>(mapped_) + aligned, data, static_cast<std::size_t>(size));
+void GpuUploader::retire(std::uint64_t completed) {
+    staging_ring_.retire(completed);
+    cpu_ring_.retire(completed);
+}
 
-    if (!alloc_fn) return false;
-    auto* cmd = static_cast<UploadCmd*>(alloc_fn(ctx, sizeof(UploadCmd), alignof(UploadCmd)));
+bool GpuUploader::enqueue_buffer_upload(VkBuffer dst, VkDeviceSize dst_offset, const void* data, VkDeviceSize size) {
+    if (!mapped_ || !dst || !data || size == 0) return false;
+    auto* cmd = static_cast<UploadCmd*>(cpu_ring_.alloc(sizeof(UploadCmd), alignof(UploadCmd)));
     if (!cmd) return false;
-    *cmd = UploadCmd{dst, dst_offset, aligned, size, nullptr};
+    auto* staging = static_cast<std::byte*>(staging_ring_.alloc(static_cast<std::size_t>(size), 16));
+    if (!staging) return false;
+    std::memcpy(staging, data, static_cast<std::size_t>(size));
+
+    const VkDeviceSize src_offset = (VkDeviceSize)(staging - static_cast<std::byte*>(mapped_));
+    *cmd = UploadCmd{dst, dst_offset, src_offset, size, nullptr};
     if (!head_) head_ = cmd;
     else tail_->next = cmd;
     tail_ = cmd;
-    offset_ = aligned + size;
     return true;
 }
 
@@ -1,19 +1,29 @@
 #pragma once
 
+#include "memory/deferred_ring.hpp"
+
 #include <vk_mem_alloc.h>
 #include <vulkan/vulkan.h>
 
 #include <cstddef>
 #include <cstdint>
+#include <vector>
 
 namespace cube::render {
 
+// Staging uploads for buffers. Staging bytes and the pending command list live in deferred rings tagged
+// with the frame that recorded them, so they stay untouched until that frame's fence has signalled.
 class GpuUploader {
 public:
-    bool init(VmaAllocator allocator, VkDeviceSize size_bytes);
+    static constexpr std::size_t DEFAULT_CPU_RING_BYTES = 1024 * 1024;
+
+    bool init(VmaAllocator allocator, VkDeviceSize size_bytes, std::size_t cpu_ring_bytes = DEFAULT_CPU_RING_BYTES);
     void shutdown(VmaAllocator allocator);
 
-    void begin_frame();
+    // frame must increase every call; uploads and deferred allocations until the next call belong to it.
+    void begin_frame(std::uint64_t frame);
+    // Every frame up to and including completed has finished on the GPU.
+    void retire(std::uint64_t completed);
 
     struct UploadCmd {
         VkBuffer dst{};
@@ -23,13 +33,18 @@ public:
         UploadCmd* next{};
     };
 
-    bool enqueue_buffer_upload(void* ctx, void* (*alloc_fn)(void*, std::size_t, std::size_t), VkBuffer dst, VkDeviceSize dst_offset, const void* data, VkDeviceSize size);
+    bool enqueue_buffer_upload(VkBuffer dst, VkDeviceSize dst_offset, const void* data, VkDeviceSize size);
     void flush(VkCommandBuffer cmd);
 
+    // CPU memory that stays valid until the current frame retires (readback targets, descriptor writes).
+    void* alloc_deferred(std::size_t size, std::size_t align = alignof(std::max_align_t)) { return cpu_ring_.alloc(size, align); }
+
     VkBuffer staging_buffer() const { return staging_buffer_; }
     VmaAllocation staging_allocation() const { return staging_alloc_; }
     VkDeviceSize staging_capacity() const { return size_; }
-    VkDeviceSize staging_used() const { return offset_; }
+    VkDeviceSize staging_used() const { return (VkDeviceSize)staging_ring_.in_flight(); }
+    const mem::DeferredRing& staging_ring() const { return staging_ring_; }
+    const mem::DeferredRing& cpu_ring() const { return cpu_ring_; }
 
 private:
     VmaAllocator allocator_{};
@@ -37,10 +52,11 @@ private:
     VmaAllocation staging_alloc_{};
     void* mapped_{};
     VkDeviceSize size_{};
-    VkDeviceSize offset_{};
+    mem::DeferredRing staging_ring_;
+    std::vector<std::byte> cpu_backing_;
+    mem::DeferredRing cpu_ring_;
     UploadCmd* head_{};
     UploadCmd* tail_{};
 };
 
 } // namespace cube::render
-
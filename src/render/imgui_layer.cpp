@@ -1,11 +1,13 @@
 #include "imgui_layer.hpp"
 #include "../core/console.hpp"
 #include "../core/log.hpp"
+#include "memory/heap_profiler.hpp"
 #include "voxel/blocks.hpp"
 #include "voxel/chunk_manager.hpp"
 #include <cstdio>
 #include <iostream>
 #include <array>
+#include <deque>
 #include <string>
 
 std::string format_memory(size_t bytes) {
@@ -296,15 +298,33 @@ void ImGuiLayer::render(VkCommandBuffer cmd, uint32_t image_index, VkExtent2D ex
         ImGui::PushStyleColor(ImGuiCol_PlotHistogram, ImVec4(0.35f, 0.35f, 0.35f, 1.0f));
         ImGui::PushStyleColor(ImGuiCol_PlotHistogramHovered, ImVec4(0.45f, 0.45f, 0.45f, 1.0f));
         if (ImGui::Begin("Memory", nullptr, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoSavedSettings)) {
-            ImGui::Text("Frame arena: %s / %s (peak %s)",
+            ImGui::Text("Frame arena: %s / %s committed (peak %s)",
                 format_memory(debug_data.frame_arena_used).c_str(),
                 format_memory(debug_data.frame_arena_capacity).c_str(),
                 format_memory(debug_data.frame_arena_peak).c_str()
             );
+            ImGui::Text("Huge pages: frame arenas %s, voxel heap %s / %s",
+                format_memory(debug_data.frame_arena_huge).c_str(),
+                format_memory(debug_data.voxel_heap_huge).c_str(),
+                format_memory(debug_data.voxel_heap_committed).c_str()
+            );
             ImGui::Text("Staging ring: %s / %s",
                 format_memory((size_t)debug_data.staging_used).c_str(),
                 format_memory((size_t)debug_data.staging_capacity).c_str()
             );
+            for (std::uint32_t i = 0; i < debug_data.staging_frames; ++i) {
+                ImGui::Text("  frame -%u: %s in flight",
+                    debug_data.staging_frames - 1 - i,
+                    format_memory((size_t)debug_data.staging_frame_bytes[i]).c_str()
+                );
+            }
+            for (std::size_t i = 0; i < cube::mem::MEM_CATEGORY_COUNT; ++i) {
+                ImGui::Text("%s heap: %s, %.1f allocs/frame",
+                    cube::mem::category_name((cube::mem::MemCategory)i),
+                    format_memory(debug_data.mem_category_bytes[i]).c_str(),
+                    debug_data.mem_category_allocs_per_frame[i]
+                );
+            }
             ImGui::Separator();
             ImGui::Text("VMA: allocations=%u (%s) blocks=%u (%s)",
                 debug_data.vma_totals.allocation_count,
@@ -330,6 +350,16 @@ void ImGuiLayer::render(VkCommandBuffer cmd, uint32_t image_index, VkExtent2D ex
             ImGui::Text("Pending: high=%u normal=%u low=%u",
                 debug_data.job_pending_high, debug_data.job_pending_normal, debug_data.job_pending_low);
             ImGui::Text("Stall warnings: %u", debug_data.job_stall_warnings);
+            ImGui::Text("Overflow: pending=%u peak=%u total=%llu",
+                debug_data.job_overflow_pending, debug_data.job_overflow_peak, (unsigned long long)debug_data.job_overflow_events);
+            ImGui::Text("Main thread: pending=%u ran=%u latency avg=%.1fus max=%.1fus",
+                debug_data.job_main_pending, debug_data.job_main_ran, debug_data.job_main_latency_avg_us, debug_data.job_main_latency_max_us);
+            ImGui::Text("Missed deadlines: high=%u normal=%u low=%u",
+                debug_data.job_missed_deadlines[0], debug_data.job_missed_deadlines[1], debug_data.job_missed_deadlines[2]);
+            ImGui::Text("Max queue age: high=%.0fus normal=%.0fus low=%.0fus",
+                debug_data.job_max_queue_age_us[0], debug_data.job_max_queue_age_us[1], debug_data.job_max_queue_age_us[2]);
+            ImGui::Text("Scratch peak: %.1f / %.1f KB per thread",
+                (double)debug_data.job_scratch_peak_bytes / 1024.0, (double)debug_data.job_scratch_bytes / 1024.0);
             ImGui::Separator();
             const std::uint32_t n = debug_data.job_worker_count > 64 ? 64u : debug_data.job_worker_count;
             for (std::uint32_t i = 0; i < n; ++i) {
@@ -339,45 +369,117 @@ void ImGuiLayer::render(VkCommandBuffer cmd, uint32_t image_index, VkExtent2D ex
             }
         }
         ImGui::End();
+
+        ImGui::SetNextWindowPos(ImVec2(display_size.x - 8.0f, 664.0f), ImGuiCond_Always, ImVec2(1.0f, 0.0f));
+        ImGui::SetNextWindowSize(ImVec2(520, 220), ImGuiCond_Always);
+        if (ImGui::Begin("Job Types", nullptr, ImGuiWindowFlags_NoCollapse | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoSavedSettings)) {
+            const ImGuiTableFlags flags = ImGuiTableFlags_RowBg | ImGuiTableFlags_BordersInnerV | ImGuiTableFlags_ScrollY | ImGuiTableFlags_SizingStretchProp;
+            if (debug_data.job_types && ImGui::BeginTable("job_types", 7, flags)) {
+                ImGui::TableSetupScrollFreeze(0, 1);
+                ImGui::TableSetupColumn("Job");
+                ImGui::TableSetupColumn("Count");
+                ImGui::TableSetupColumn("Wait p50");
+                ImGui::TableSetupColumn("Wait p99");
+                ImGui::TableSetupColumn("Run p50");
+                ImGui::TableSetupColumn("Run p95");
+                ImGui::TableSetupColumn("Run p99/max");
+                ImGui::TableHeadersRow();
+                for (const auto& r : *debug_data.job_types) {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn(); ImGui::TextUnformatted(r.name);
+                    ImGui::TableNextColumn(); ImGui::Text("%llu", (unsigned long long)r.count);
+                    ImGui::TableNextColumn(); ImGui::Text("%.1fus", r.wait_us[0]);
+                    ImGui::TableNextColumn(); ImGui::Text("%.1fus", r.wait_us[2]);
+                    ImGui::TableNextColumn(); ImGui::Text("%.1fus", r.run_us[0]);
+                    ImGui::TableNextColumn(); ImGui::Text("%.1fus", r.run_us[1]);
+                    ImGui::TableNextColumn(); ImGui::Text("%.1f/%.1fus", r.run_us[2], r.run_us[3]);
+                }
+                ImGui::EndTable();
+            }
+        }
+        ImGui::End();
         ImGui::PopStyleColor(12);
     }
 
     if (debug_data.show_log_viewer) {
+        struct LogLine {
+            cube::log::Level level;
+            std::string text;
+        };
         static bool show_info = true;
         static bool show_warn = true;
         static bool show_error = true;
         static ImGuiTextFilter filter;
         static bool auto_scroll = true;
+        // Local copy of the history fed by read_since, and the indices that pass the current filter;
+        // only new lines are fetched and tested each frame.
+        static std::uint64_t cursor = 0;
+        static std::deque<LogLine> lines;
+        static std::deque<std::size_t> visible;
+        static std::size_t dropped_front = 0;
+        constexpr std::size_t MAX_LOG_LINES = 5000;
+
+        auto passes = [&](const LogLine& l) {
+            if (l.level == cube::log::Level::Info && !show_info) return false;
+            if (l.level == cube::log::Level::Warn && !show_warn) return false;
+            if (l.level == cube::log::Level::Error && !show_error) return false;
+            return filter.PassFilter(l.text.c_str());
+        };
 
         ImGui::SetNextWindowSize(ImVec2(900, 420), ImGuiCond_FirstUseEver);
         if (ImGui::Begin("Log", nullptr)) {
-            if (ImGui::Button("Clear")) cube::log::clear();
+            bool refilter = false;
+            if (ImGui::Button("Clear")) {
+                cube::log::clear();
+                dropped_front += lines.size();
+                lines.clear();
+                visible.clear();
+            }
             ImGui::SameLine();
             ImGui::Checkbox("Auto-scroll", &auto_scroll);
             ImGui::SameLine();
-            ImGui::Checkbox("INFO", &show_info);
+            refilter |= ImGui::Checkbox("INFO", &show_info);
             ImGui::SameLine();
-            ImGui::Checkbox("WARN", &show_warn);
+            refilter |= ImGui::Checkbox("WARN", &show_warn);
             ImGui::SameLine();
-            ImGui::Checkbox("ERROR", &show_error);
-            filter.Draw("Filter");
+            refilter |= ImGui::Checkbox("ERROR", &show_error);
+            refilter |= filter.Draw("Filter");
+            const cube::log::Stats log_stats = cube::log::stats();
+            if (log_stats.dropped || log_stats.blocked) {
+                ImGui::TextColored(ImVec4(1.0f, 0.85f, 0.25f, 1.0f), "Writer behind: %llu lines dropped, %llu producers blocked",
+                    (unsigned long long)log_stats.dropped, (unsigned long long)log_stats.blocked);
+            }
+            if (log_stats.suppressed) ImGui::TextDisabled("%llu repeated lines suppressed by rate limits", (unsigned long long)log_stats.suppressed);
+
+            // visible holds absolute indices (dropped_front + position in lines) so trimming the front
+            // does not renumber it.
+            const std::size_t before = lines.size();
+            cursor = cube::log::read_since(cursor, [](const cube::log::LineView& l) {
+                lines.push_back(LogLine{l.level, std::string(l.text)});
+            });
+            for (std::size_t i = before; i < lines.size(); ++i) {
+                if (!refilter && passes(lines[i])) visible.push_back(dropped_front + i);
+            }
+            while (lines.size() > MAX_LOG_LINES) {
+                lines.pop_front();
+                dropped_front++;
+            }
+            while (!visible.empty() && visible.front() < dropped_front) visible.pop_front();
+            if (refilter) {
+                visible.clear();
+                for (std::size_t i = 0; i < lines.size(); ++i) {
+                    if (passes(lines[i])) visible.push_back(dropped_front + i);
+                }
+            }
 
-            std::vector<cube::log::Entry> entries = cube::log::snapshot();
             ImGui::Separator();
             ImGui::BeginChild("log_scroller", ImVec2(0, 0), false, ImGuiWindowFlags_HorizontalScrollbar);
 
             ImGuiListClipper clipper;
-            clipper.Begin(static_cast<int>(entries.size()));
+            clipper.Begin(static_cast<int>(visible.size()));
             while (clipper.Step()) {
                 for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
-                    const auto& e = entries[static_cast<size_t>(i)];
-                    bool ok = true;
-                    if (e.level == cube::log::Level::Info && !show_info) ok = false;
-                    if (e.level == cube::log::Level::Warn && !show_warn) ok = false;
-                    if (e.level == cube::log::Level::Error && !show_error) ok = false;
-                    if (ok && !filter.PassFilter(e.text.c_str())) ok = false;
-                    if (!ok) continue;
-
+                    const auto& e = lines[visible[static_cast<size_t>(i)] - dropped_front];
                     if (e.level == cube::log::Level::Error) ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.35f, 0.35f, 1.0f));
                     else if (e.level == cube::log::Level::Warn) ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 0.85f, 0.25f, 1.0f));
                     ImGui::TextUnformatted(e.text.c_str());
@@ -435,6 +537,59 @@ void ImGuiLayer::render(VkCommandBuffer cmd, uint32_t image_index, VkExtent2D ex
         ImGui::End();
     }
 
+    if (debug_data.show_heap_profile) {
+        struct SiteRow {
+            std::string call_site;
+            std::uint64_t bytes;
+            std::uint32_t samples;
+            cube::mem::MemCategory category;
+        };
+        // Snapshots aggregate and symbolize every live sample, so refresh twice a second rather than per frame.
+        static cube::mem::HeapProfile profile;
+        static std::vector<SiteRow> rows;
+        static double last_refresh = -1.0;
+        const double now = ImGui::GetTime();
+        if (last_refresh < 0.0 || now - last_refresh >= 0.5) {
+            profile = cube::mem::heap_profile_snapshot();
+            rows.clear();
+            for (std::size_t i = 0; i < profile.sites.size() && i < 64; ++i) {
+                const auto& site = profile.sites[i];
+                rows.push_back(SiteRow{cube::mem::heap_profile_call_site(site), site.bytes, site.samples, site.category});
+            }
+            last_refresh = now;
+        }
+        ImGui::SetNextWindowSize(ImVec2(760, 460), ImGuiCond_FirstUseEver);
+        if (ImGui::Begin("Heap", nullptr)) {
+            ImGui::Text("Sampled live heap: %s from %u samples (1 per %s, %llu dropped)",
+                format_memory((size_t)profile.total_bytes).c_str(), profile.live_samples,
+                format_memory(profile.sample_rate).c_str(), (unsigned long long)profile.dropped_samples);
+            for (std::size_t i = 0; i < cube::mem::MEM_CATEGORY_COUNT; ++i) {
+                ImGui::Text("%-8s %s", cube::mem::category_name((cube::mem::MemCategory)i), format_memory((size_t)profile.category_bytes[i]).c_str());
+            }
+            ImGui::Separator();
+            if (ImGui::BeginTable("heap_sites", 4, ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY | ImGuiTableFlags_Resizable)) {
+                ImGui::TableSetupColumn("Bytes", ImGuiTableColumnFlags_WidthFixed, 90.0f);
+                ImGui::TableSetupColumn("Samples", ImGuiTableColumnFlags_WidthFixed, 60.0f);
+                ImGui::TableSetupColumn("Category", ImGuiTableColumnFlags_WidthFixed, 70.0f);
+                ImGui::TableSetupColumn("Call site");
+                ImGui::TableHeadersRow();
+                for (const auto& r : rows) {
+                    ImGui::TableNextRow();
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(format_memory((size_t)r.bytes).c_str());
+                    ImGui::TableNextColumn();
+                    ImGui::Text("%u", r.samples);
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(cube::mem::category_name(r.category));
+                    ImGui::TableNextColumn();
+                    ImGui::TextUnformatted(r.call_site.c_str());
+                }
+                ImGui::EndTable();
+            }
+        }
+        ImGui::End();
+    }
+
     // Render console if provided
     if (console && show_console) {
         console->render(show_console);
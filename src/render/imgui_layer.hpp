@@ -11,11 +11,19 @@
 #include <glm/glm.hpp>
 
 #include "math/math.hpp"
+#include "memory/memory_category.hpp"
 #include "render/gpu_memory.hpp"
 
 class Console;
 namespace cube::voxel { class BlockRegistry; class ChunkManager; }
 
+struct JobTypeRow {
+    const char* name;
+    std::uint64_t count;
+    std::array<float, 4> wait_us; // p50, p95, p99, max
+    std::array<float, 4> run_us;
+};
+
 struct DebugData {
     float fps;
     float frame_time_ms;
@@ -31,8 +39,16 @@ struct DebugData {
     std::size_t frame_arena_used;
     std::size_t frame_arena_capacity;
     std::size_t frame_arena_peak;
+    std::size_t frame_arena_huge;
+    std::size_t voxel_heap_committed;
+    std::size_t voxel_heap_huge;
+    std::array<std::size_t, cube::mem::MEM_CATEGORY_COUNT> mem_category_bytes;
+    std::array<float, cube::mem::MEM_CATEGORY_COUNT> mem_category_allocs_per_frame;
     std::uint64_t staging_used;
     std::uint64_t staging_capacity;
+    static constexpr std::uint32_t MAX_STAGING_FRAMES = 4;
+    std::array<std::uint64_t, MAX_STAGING_FRAMES> staging_frame_bytes; // oldest frame in flight first
+    std::uint32_t staging_frames;
     float cpu_usage;
     float gpu_usage;
     std::uint32_t job_worker_count;
@@ -40,10 +56,23 @@ struct DebugData {
     std::uint32_t job_pending_normal;
     std::uint32_t job_pending_low;
     std::uint32_t job_stall_warnings;
+    std::uint32_t job_overflow_pending;
+    std::uint32_t job_overflow_peak;
+    std::uint64_t job_overflow_events;
+    std::uint32_t job_main_pending;
+    std::uint32_t job_main_ran;
+    float job_main_latency_avg_us;
+    float job_main_latency_max_us;
+    std::array<std::uint32_t, 3> job_missed_deadlines;
+    std::array<float, 3> job_max_queue_age_us;
     std::array<float, 64> job_worker_utilization;
+    size_t job_scratch_bytes;
+    size_t job_scratch_peak_bytes;
+    const std::vector<JobTypeRow>* job_types;
     bool show_overlay;
     bool show_log_viewer;
     bool show_voxel_debug;
+    bool show_heap_profile;
     const cube::voxel::BlockRegistry* block_registry;
     const cube::voxel::ChunkManager* chunk_manager;
 };
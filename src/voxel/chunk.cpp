@@ -1,5 +1,8 @@
 #include "voxel/chunk.hpp"
 
+#include "memory/thread_scratch.hpp"
+
+#include <algorithm>
 #include <limits>
 
 namespace cube::voxel {
@@ -52,7 +55,7 @@ static std::uint8_t bits_for_palette(std::size_t n) {
     return b ? b : 1;
 }
 
-static std::uint32_t read_index(const std::vector<std::uint64_t>& packed, std::uint8_t bits, std::uint32_t i) {
+static std::uint32_t read_index(const mem::pmr::vector<std::uint64_t>& packed, std::uint8_t bits, std::uint32_t i) {
     const std::uint64_t mask = (bits == 64) ? ~0ULL : ((1ULL << bits) - 1ULL);
     const std::uint64_t bit = (std::uint64_t)i * (std::uint64_t)bits;
     const std::size_t w = (std::size_t)(bit >> 6);
@@ -63,7 +66,7 @@ static std::uint32_t read_index(const std::vector<std::uint64_t>& packed, std::u
     return (std::uint32_t)((a | b) & mask);
 }
 
-static void write_index(std::vector<std::uint64_t>& packed, std::uint8_t bits, std::uint32_t i, std::uint32_t v) {
+static void write_index(mem::pmr::vector<std::uint64_t>& packed, std::uint8_t bits, std::uint32_t i, std::uint32_t v) {
     const std::uint64_t mask = (bits == 64) ? ~0ULL : ((1ULL << bits) - 1ULL);
     const std::uint64_t bit = (std::uint64_t)i * (std::uint64_t)bits;
     const std::size_t w = (std::size_t)(bit >> 6);
@@ -79,10 +82,19 @@ static void write_index(std::vector<std::uint64_t>& packed, std::uint8_t bits, s
     packed[w + 1] |= (vv >> (64 - o)) & hmask;
 }
 
-static void repack(std::vector<std::uint64_t>& packed, std::uint8_t& bits, std::uint32_t volume, std::uint8_t new_bits) {
+// Temporary index buffer from the calling thread's scratch stack, or the heap when it is full.
+static std::uint32_t* scratch_indices(std::size_t n, std::vector<std::uint32_t>& fallback) {
+    void* p = mem::thread_scratch().alloc(n * sizeof(std::uint32_t), alignof(std::uint32_t));
+    if (p) return static_cast<std::uint32_t*>(p);
+    fallback.resize(n);
+    return fallback.data();
+}
+
+static void repack(mem::pmr::vector<std::uint64_t>& packed, std::uint8_t& bits, std::uint32_t volume, std::uint8_t new_bits) {
     if (new_bits == bits) return;
-    std::vector<std::uint32_t> tmp;
-    tmp.resize(volume);
+    mem::StackAllocator::Scope scope(mem::thread_scratch());
+    std::vector<std::uint32_t> heap;
+    std::uint32_t* tmp = scratch_indices(volume, heap);
     for (std::uint32_t i = 0; i < volume; ++i) tmp[i] = read_index(packed, bits, i);
     bits = new_bits ? new_bits : 1;
     const std::size_t total_bits = (std::size_t)volume * (std::size_t)bits;
@@ -98,7 +110,6 @@ static void maybe_collapse_or_compact(detail::SubChunk& s) {
         if (s.counts[i]) {
             ++live;
             live_idx = i;
-            if (live > 1) break;
         }
     }
     if (live == 0) {
@@ -119,11 +130,16 @@ static void maybe_collapse_or_compact(detail::SubChunk& s) {
         s.bits = 0;
         return;
     }
-
-    std::vector<std::uint32_t> remap;
-    remap.resize(s.palette.size(), std::numeric_limits<std::uint32_t>::max());
-    std::vector<BlockID> new_pal;
-    std::vector<std::uint16_t> new_cnt;
+    // Every palette entry still in use: compacting would rebuild the same palette at the same width.
+    if (live == s.counts.size()) return;
+
+    mem::StackAllocator::Scope scope(mem::thread_scratch());
+    std::vector<std::uint32_t> remap_heap;
+    std::uint32_t* remap = scratch_indices(s.palette.size(), remap_heap);
+    std::fill_n(remap, s.palette.size(), std::numeric_limits<std::uint32_t>::max());
+    // Built on the subchunk's resource so the move-assignments below just take the buffers.
+    mem::pmr::vector<BlockID> new_pal(s.palette.get_allocator());
+    mem::pmr::vector<std::uint16_t> new_cnt(s.counts.get_allocator());
     new_pal.reserve(s.palette.size());
     new_cnt.reserve(s.counts.size());
     for (std::size_t i = 0; i < s.palette.size(); ++i) {
@@ -133,8 +149,8 @@ static void maybe_collapse_or_compact(detail::SubChunk& s) {
         new_cnt.push_back(s.counts[i]);
     }
 
-    std::vector<std::uint32_t> tmp;
-    tmp.resize(SUBCHUNK_VOLUME);
+    std::vector<std::uint32_t> heap;
+    std::uint32_t* tmp = scratch_indices(SUBCHUNK_VOLUME, heap);
     for (std::uint32_t i = 0; i < (std::uint32_t)SUBCHUNK_VOLUME; ++i) tmp[i] = remap[read_index(s.packed, s.bits, i)];
 
     s.palette = std::move(new_pal);
@@ -200,16 +216,8 @@ std::size_t detail::SubChunk::payload_bytes() const {
     return palette.size() * sizeof(BlockID) + counts.size() * sizeof(std::uint16_t) + packed.size() * sizeof(std::uint64_t) + 1;
 }
 
-Chunk::Chunk(ChunkCoord coord, BlockID fill) : coord_(coord) {
-    subs_.resize(SUBCHUNK_COUNT);
-    for (auto& s : subs_) {
-        s.kind = detail::SubChunk::Kind::Uniform;
-        s.uniform = fill;
-        s.palette.clear();
-        s.counts.clear();
-        s.packed.clear();
-        s.bits = 0;
-    }
+Chunk::Chunk(ChunkCoord coord, BlockID fill, std::pmr::memory_resource* resource) : coord_(coord), subs_(SUBCHUNK_COUNT, resource) {
+    for (auto& s : subs_) s.uniform = fill;
 }
 
 BlockID Chunk::get_block(int x, int y, int z) const {
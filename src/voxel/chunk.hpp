@@ -1,5 +1,6 @@
 #pragma once
 
+#include "memory/pmr.hpp"
 #include "voxel/blocks.hpp"
 
 #include <cstdint>
@@ -24,13 +25,27 @@ struct ChunkCoordHash {
 };
 
 namespace detail {
+// Allocator-aware so the chunk's subchunk vector hands its memory resource down to the arrays.
 struct SubChunk {
+    using allocator_type = mem::pmr::allocator;
+
+    SubChunk() = default;
+    explicit SubChunk(const allocator_type& a) : palette(a), counts(a), packed(a) {}
+    SubChunk(const SubChunk&) = default;
+    SubChunk(SubChunk&&) noexcept = default;
+    SubChunk(const SubChunk& o, const allocator_type& a)
+        : kind(o.kind), uniform(o.uniform), palette(o.palette, a), counts(o.counts, a), packed(o.packed, a), bits(o.bits) {}
+    SubChunk(SubChunk&& o, const allocator_type& a)
+        : kind(o.kind), uniform(o.uniform), palette(std::move(o.palette), a), counts(std::move(o.counts), a), packed(std::move(o.packed), a), bits(o.bits) {}
+    SubChunk& operator=(const SubChunk&) = default;
+    SubChunk& operator=(SubChunk&&) = default;
+
     enum class Kind : std::uint8_t { Uniform, Palette };
     Kind kind{Kind::Uniform};
     BlockID uniform{0};
-    std::vector<BlockID> palette;
-    std::vector<std::uint16_t> counts;
-    std::vector<std::uint64_t> packed;
+    mem::pmr::vector<BlockID> palette;
+    mem::pmr::vector<std::uint16_t> counts;
+    mem::pmr::vector<std::uint64_t> packed;
     std::uint8_t bits{0};
 
     BlockID get(int x, int y, int z) const;
@@ -42,7 +57,8 @@ struct SubChunk {
 
 class Chunk {
 public:
-    explicit Chunk(ChunkCoord coord, BlockID fill = 0);
+    // Block storage comes from resource; by default the Voxel memory category.
+    explicit Chunk(ChunkCoord coord, BlockID fill = 0, std::pmr::memory_resource* resource = mem::category_resource(mem::MemCategory::Voxel));
 
     ChunkCoord coord() const { return coord_; }
     bool dirty() const { return dirty_; }
@@ -56,6 +72,7 @@ public:
     BlockID uniform_value() const;
     std::uint8_t bits_per_block() const;
     std::size_t palette_size() const;
+    std::pmr::memory_resource* resource() const { return subs_.get_allocator().resource(); }
 
 private:
     static bool in_bounds(int x, int y, int z);
@@ -69,7 +86,7 @@ private:
 
     ChunkCoord coord_{};
     bool dirty_{false};
-    std::vector<detail::SubChunk> subs_;
+    mem::pmr::vector<detail::SubChunk> subs_;
 };
 
 }
@@ -4,7 +4,8 @@
 
 namespace cube::voxel {
 
-ChunkManager::ChunkManager(std::size_t payload_limit_bytes) : payload_limit_bytes_(payload_limit_bytes) {}
+ChunkManager::ChunkManager(std::size_t payload_limit_bytes, std::pmr::memory_resource* resource)
+    : resource_(resource), chunks_(resource), lru_(resource), payload_limit_bytes_(payload_limit_bytes) {}
 
 void ChunkManager::set_payload_limit(std::size_t bytes) {
     payload_limit_bytes_ = bytes;
@@ -60,7 +61,7 @@ Chunk& ChunkManager::create_chunk(ChunkCoord c, BlockID fill) {
     }
 
     lru_.push_front(c);
-    Entry e{Chunk(c, fill), lru_.begin(), 0};
+    Entry e{Chunk(c, fill, resource_), lru_.begin(), 0};
     e.payload_bytes = e.chunk.payload_bytes();
     payload_bytes_ += e.payload_bytes;
     auto [ins, ok] = chunks_.emplace(c, std::move(e));
@@ -4,8 +4,6 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <list>
-#include <unordered_map>
 #include <vector>
 
 namespace cube::voxel {
@@ -19,7 +17,8 @@ public:
         std::uint64_t evictions{0};
     };
 
-    explicit ChunkManager(std::size_t payload_limit_bytes = 256ull * 1024ull * 1024ull);
+    // The map, LRU list and every chunk's block storage allocate from resource.
+    explicit ChunkManager(std::size_t payload_limit_bytes = 256ull * 1024ull * 1024ull, std::pmr::memory_resource* resource = mem::category_resource(mem::MemCategory::Voxel));
 
     void set_payload_limit(std::size_t bytes);
     std::size_t payload_limit() const { return payload_limit_bytes_; }
@@ -39,7 +38,7 @@ public:
 private:
     struct Entry {
         Chunk chunk;
-        std::list<ChunkCoord>::iterator it;
+        mem::pmr::list<ChunkCoord>::iterator it;
         std::size_t payload_bytes{0};
     };
 
@@ -47,8 +46,9 @@ private:
     void evict_if_needed_();
     void update_payload_(Entry& e, std::size_t new_bytes);
 
-    std::unordered_map<ChunkCoord, Entry, ChunkCoordHash> chunks_;
-    std::list<ChunkCoord> lru_;
+    std::pmr::memory_resource* resource_;
+    mem::pmr::unordered_map<ChunkCoord, Entry, ChunkCoordHash> chunks_;
+    mem::pmr::list<ChunkCoord> lru_;
     std::size_t payload_limit_bytes_{0};
     std::size_t payload_bytes_{0};
     std::uint64_t evictions_{0};
@@ -0,0 +1,76 @@
+#include "core/bench.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+static int bfail(int code, const char* what) {
+    std::fprintf(stderr, "cube_tests: FAIL(%d): %s\n", code, what);
+    return code;
+}
+
+int run_bench_tests() {
+    using namespace cube::bench;
+
+    {
+        Registry reg;
+        int calls = 0;
+        auto ok = [&](const char* name) {
+            return [&calls, name](const Options&, Result& out) {
+                ++calls;
+                out.name = name;
+                return true;
+            };
+        };
+        reg.add("voxel/set", "", ok("voxel/set"));
+        reg.add("voxel/get", "", ok("voxel/get"));
+        reg.add("jobs/missing", "", [&](const Options&, Result&) { ++calls; return false; });
+        reg.add("jobs/mpmc", "", ok("jobs/mpmc"));
+        auto names = [&](std::string_view filter) {
+            std::vector<std::string> out;
+            for (const Result& r : reg.run(filter, Options{0, 1})) out.push_back(r.name);
+            return out;
+        };
+
+        const std::vector<std::string> every{"voxel/set", "voxel/get", "jobs/mpmc"};
+        if (names("all") != every || names("") != every) return bfail(601, "\"all\" and an empty filter run everything in order");
+        if (names("voxel/") != std::vector<std::string>{"voxel/set", "voxel/get"} || names("jobs/mpmc") != std::vector<std::string>{"jobs/mpmc"}) {
+            return bfail(602, "filter matches by name prefix");
+        }
+        if (!names("render").empty() || !names("voxel/set/x").empty()) return bfail(603, "filter with no match runs nothing");
+
+        calls = 0;
+        std::vector<std::string> seen;
+        const auto results = reg.run("jobs", Options{}, [&](const Result& r) { seen.push_back(r.name); });
+        if (calls != 2 || results.size() != 1 || seen != std::vector<std::string>{"jobs/mpmc"}) return bfail(604, "failed runs are skipped and not reported");
+    }
+
+    {
+        namespace fs = std::filesystem;
+        const fs::path path = fs::temp_directory_path() / "cube_bench_test.json";
+        auto read = [&] {
+            std::ifstream in(path, std::ios::binary);
+            return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        };
+
+        Result r{};
+        r.name = "a\"b\\c\nd";
+        r.items = 10;
+        r.median_ns = 1000.0;
+        r.p95_ns = 1500.0;
+        r.ns_per_item = 100.0;
+        r.items_per_sec = 1e7;
+        if (!write_json(path.string(), {r, r}, {{"cpu", "x\ty"}, {"build", "release"}})) return bfail(605, "write_json opens its file");
+        const std::string row = "{\"name\": \"a\\\"b\\\\c\\u000ad\", \"items\": 10, \"median_ns\": 1000.0, \"p95_ns\": 1500.0, \"ns_per_item\": 100.000, \"items_per_sec\": 10000000.0}";
+        const std::string expect = "{\n  \"info\": {\n    \"cpu\": \"x\\u0009y\",\n    \"build\": \"release\"\n  },\n  \"results\": [\n    " + row + ",\n    " + row + "\n  ]\n}\n";
+        if (read() != expect) return bfail(606, "JSON escapes strings and keeps its shape");
+
+        if (!write_json(path.string(), {}, {}) || read() != "{\n  \"info\": {},\n  \"results\": []\n}\n") return bfail(607, "empty JSON report");
+        fs::remove(path);
+    }
+
+    return 0;
+}
@@ -1,10 +1,20 @@
+#include "core/cpu_topology.hpp"
 #include "core/job_system.hpp"
+#include "core/job_task.hpp"
+#include "core/mpmc_queue.hpp"
+#include "core/parallel_for.hpp"
+#include "core/task_graph.hpp"
 
 #include <atomic>
 #include <cstdio>
 #include <thread>
 #include <vector>
 #include <mutex>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
 
 static int jfail(int code, const char* what) {
     std::fprintf(stderr, "cube_tests: FAIL(%d): %s\n", code, what);
@@ -35,6 +45,30 @@ static void sleep_job(void* p) {
     std::this_thread::sleep_for(std::chrono::milliseconds(5));
 }
 
+struct StreamCheck {
+    std::thread::id main;
+    std::atomic<int> wrong_thread{0};
+    std::atomic<int> finished{0};
+};
+
+static cube::jobs::Task<int> generate(cube::jobs::JobSystem& js, int seed) {
+    cube::jobs::JobSystem::Counter parts;
+    js.init_counter(parts);
+    std::atomic<int> v{0};
+    IncCtx ctx{&v};
+    for (int i = 0; i < 4; ++i) js.submit(&inc_job, &ctx, cube::jobs::Priority::Normal, &parts, nullptr, "gen.part");
+    co_await parts;
+    co_return seed + v.load();
+}
+
+static cube::jobs::Task<void> stream_one(cube::jobs::JobSystem& js, StreamCheck& chk, int seed) {
+    const int mesh = co_await generate(js, seed);
+    co_await cube::jobs::main_thread(js);
+    if (std::this_thread::get_id() != chk.main) chk.wrong_thread.fetch_add(1);
+    co_await cube::jobs::schedule(js, cube::jobs::Priority::Low);
+    if (mesh == seed + 4) chk.finished.fetch_add(1);
+}
+
 }
 
 int run_job_tests() {
@@ -183,6 +217,506 @@ int run_job_tests() {
         if (st.stall_warnings == 0) return jfail(318, "stall detection");
     }
 
+    {
+        JobSystem js;
+        if (!js.init(JobSystem::Config{.thread_count = 4, .queue_capacity = 1024, .stall_warn_ms = 100})) return jfail(319, "JobSystem init (parallel_for)");
+        constexpr std::size_t N = 100000;
+        std::vector<std::uint8_t> hit(N, 0);
+        cube::jobs::parallel_for(js, 0, N, 256, [&](std::size_t i) { hit[i]++; });
+        std::atomic<std::uint64_t> sum{0};
+        cube::jobs::parallel_for(js, 0, N, 1000, [&](std::size_t b, std::size_t e) {
+            std::uint64_t s = 0;
+            for (std::size_t i = b; i < e; ++i) s += i;
+            sum.fetch_add(s, std::memory_order_relaxed);
+        });
+        js.shutdown();
+        for (std::size_t i = 0; i < N; ++i) if (hit[i] != 1) return jfail(320, "parallel_for visits each index once");
+        if (sum.load() != (std::uint64_t)N * (N - 1) / 2) return jfail(321, "parallel_for range sum");
+    }
+
+    {
+        JobSystem js;
+        if (!js.init(JobSystem::Config{.thread_count = 4, .queue_capacity = 1024, .stall_warn_ms = 100})) return jfail(322, "JobSystem init (task graph)");
+        std::mutex m;
+        std::vector<int> order;
+        auto rec = [&](int id) { std::scoped_lock lk(m); order.push_back(id); };
+        cube::jobs::TaskGraph g;
+        g.reserve(4, 4);
+        const auto a = g.add("a", [&] { rec(0); });
+        const auto b = g.add("b", [&] { rec(1); });
+        const auto c = g.add("c", [&] { rec(2); });
+        const auto d = g.add("d", [&] { rec(3); });
+        g.precede(a, b);
+        g.precede(a, c);
+        g.precede(b, d);
+        g.precede(c, d);
+        for (int frame = 0; frame < 3; ++frame) {
+            order.clear();
+            g.run(js);
+            if (order.size() != 4) { js.shutdown(); return jfail(323, "task graph runs every node"); }
+            if (order.front() != 0 || order.back() != 3) { js.shutdown(); return jfail(324, "task graph respects edges"); }
+        }
+        cube::jobs::TaskGraph cyc;
+        const auto x = cyc.add("x", [] {});
+        const auto y = cyc.add("y", [] {});
+        cyc.precede(x, y);
+        cyc.precede(y, x);
+        const bool compiled = cyc.compile();
+        js.shutdown();
+        if (compiled) return jfail(325, "task graph rejects cycles");
+    }
+
+    {
+        JobSystem js;
+        if (!js.init(JobSystem::Config{.thread_count = 2, .queue_capacity = 1024, .stall_warn_ms = 100, .trace_events_per_thread = 64})) return jfail(326, "JobSystem init (trace)");
+        JobSystem::Counter c;
+        js.init_counter(c);
+        std::atomic<int> v{0};
+        IncCtx ctx{&v};
+        for (int i = 0; i < 200; ++i) js.submit(&inc_job, &ctx, Priority::Normal, &c, nullptr, "traced");
+        js.wait(c);
+        std::vector<cube::jobs::TraceEvent> ev;
+        js.trace().collect(0, ev);
+        js.shutdown();
+        if (ev.empty() || ev.size() > 64 * (2 + cube::jobs::JobTrace::EXTERNAL_SLOTS)) return jfail(327, "trace ring keeps the newest events");
+        for (const auto& e : ev) {
+            if (std::strcmp(e.name, "traced") != 0 || e.counter_id != c.id) return jfail(328, "trace event name/counter");
+            if (e.end_ns < e.start_ns) return jfail(329, "trace event times");
+        }
+    }
+
+    {
+        // A reader racing the ring's owner keeps only whole events, never a mix of two.
+        cube::jobs::JobTrace trace;
+        trace.init(1, 16);
+        std::atomic<bool> stop{false};
+        std::thread writer([&] {
+            for (std::uint64_t k = 1; !stop.load(std::memory_order_relaxed); ++k) {
+                trace.record(0, cube::jobs::TraceEvent{"lap", k, k + 1, k, (std::uint32_t)k, 0});
+            }
+        });
+        bool torn = false;
+        std::vector<cube::jobs::TraceEvent> ev;
+        for (int i = 0; i < 2000 && !torn; ++i) {
+            ev.clear();
+            trace.collect(0, ev);
+            for (const auto& e : ev) torn |= e.end_ns != e.start_ns + 1 || e.queue_ns != e.start_ns || e.counter_id != (std::uint32_t)e.start_ns;
+        }
+        stop.store(true);
+        writer.join();
+        if (torn) return jfail(387, "trace reader drops events the writer is overwriting");
+    }
+
+    {
+        JobSystem js;
+        if (!js.init(JobSystem::Config{.thread_count = 2, .queue_capacity = 64, .stall_warn_ms = 100})) return jfail(330, "JobSystem init (overflow)");
+        JobSystem::Counter c;
+        js.init_counter(c);
+        std::atomic<int> v{0};
+        IncCtx ctx{&v};
+        constexpr int N = 1000000;
+        std::atomic<int> nested{0};
+        struct SpawnCtx { JobSystem* js; JobSystem::Counter* c; IncCtx* inc; std::atomic<int>* nested; };
+        SpawnCtx sc{&js, &c, &ctx, &nested};
+        auto spawn = +[](void* p) {
+            auto* s = static_cast<SpawnCtx*>(p);
+            for (int i = 0; i < 64; ++i) s->js->submit(&inc_job, s->inc, Priority::Normal, s->c, nullptr, "inc");
+            s->nested->fetch_add(64, std::memory_order_relaxed);
+        };
+        for (int i = 0; i < 16; ++i) js.submit(spawn, &sc, Priority::High, &c, nullptr, "spawn");
+        for (int i = 0; i < N; ++i) js.submit(&inc_job, &ctx, (Priority)(i % 3), &c, nullptr, "inc");
+        js.wait(c);
+        const auto st = js.snapshot_stats();
+        js.shutdown();
+        if (v.load() != N + nested.load()) return jfail(331, "overflow keeps every job");
+        if (st.overflow_events == 0 || st.overflow_pending != 0) return jfail(332, "overflow stats");
+    }
+
+    {
+        JobSystem js;
+        if (!js.init(JobSystem::Config{.thread_count = 2, .queue_capacity = 256, .stall_warn_ms = 100})) return jfail(333, "JobSystem init (main thread)");
+        struct MainCtx { std::thread::id main; std::atomic<int> wrong{0}; std::atomic<int> ran{0}; };
+        MainCtx mc{std::this_thread::get_id()};
+        auto on_main = +[](void* p) {
+            auto* m = static_cast<MainCtx*>(p);
+            if (std::this_thread::get_id() != m->main) m->wrong.fetch_add(1);
+            m->ran.fetch_add(1);
+        };
+        std::atomic<int> v{0};
+        IncCtx ctx{&v};
+        JobSystem::Counter workers_done, main_done, after;
+        js.init_counter(workers_done);
+        js.init_counter(main_done);
+        js.init_counter(after);
+        for (int i = 0; i < 8; ++i) js.submit(&inc_job, &ctx, Priority::Normal, &workers_done, nullptr, "worker");
+        js.submit_main(on_main, &mc, &main_done, &workers_done, "upload");
+        js.submit(&inc_job, &ctx, Priority::Normal, &after, &main_done, "after");
+        while (mc.ran.load() == 0) {
+            js.run_main_thread_jobs(1000000ull);
+            std::this_thread::yield();
+        }
+        js.wait(after);
+        if (v.load() != 9) { js.shutdown(); return jfail(334, "worker -> main -> worker gating"); }
+        for (int i = 0; i < 4; ++i) js.submit_main(on_main, &mc, &main_done, nullptr, "upload");
+        js.wait(main_done);
+        const auto st = js.snapshot_stats();
+        js.shutdown();
+        if (mc.ran.load() != 5 || mc.wrong.load() != 0) return jfail(335, "main-thread jobs run on the main thread");
+        if (st.main_ran != 5 || st.main_pending != 0) return jfail(336, "main-thread job stats");
+    }
+
+    {
+        // 4 cores x 2 SMT threads, cores {0,1} and {2,3} on separate L3 slices; cpu N+4 is cpu N's sibling.
+        cube::jobs::CpuTopology topo{};
+        for (std::uint32_t cpu = 0; cpu < 8; ++cpu) topo.cpus.push_back({cpu, 0, cpu % 4, (cpu % 4) / 2, cpu / 4});
+        topo.physical_cores = 4;
+        topo.l3_domains = 2;
+        const auto plan = cube::jobs::plan_cpus(topo, 1, 0);
+        if (plan.reserved != std::vector<std::uint32_t>{0, 4}) return jfail(337, "topology reserves the first core's threads");
+        if (plan.workers != std::vector<std::uint32_t>{1, 2, 3}) return jfail(338, "topology: one worker per free physical core");
+        const auto wide = cube::jobs::plan_cpus(topo, 1, 6);
+        if (wide.workers != std::vector<std::uint32_t>{1, 2, 3, 5, 6, 7}) return jfail(339, "topology uses SMT siblings last");
+    }
+
+    {
+        JobSystem js;
+        if (!js.init(JobSystem::Config{.thread_count = 1, .queue_capacity = 256, .stall_warn_ms = 100, .aging_ms = 0})) return jfail(342, "JobSystem init (deadlines)");
+        JobSystem::Counter gate, c;
+        js.init_counter(gate, 1);
+        js.init_counter(c);
+        std::mutex m;
+        std::vector<int> order;
+        OrderCtx o0{&m, &order, 0}, o1{&m, &order, 1}, o2{&m, &order, 2}, o3{&m, &order, 3};
+        const std::uint64_t now = cube::jobs::JobTrace::now_ns();
+        js.submit(JobSystem::Job{&push_order, &o0, &c, &gate, "best effort"}, Priority::Normal);
+        js.submit(JobSystem::Job{&push_order, &o1, &c, &gate, "late", now + 3000000000ull}, Priority::Normal);
+        js.submit(JobSystem::Job{&push_order, &o2, &c, &gate, "early", now + 1000000000ull}, Priority::Normal);
+        js.submit(JobSystem::Job{&push_order, &o3, &c, &gate, "missed", 1}, Priority::Normal);
+        gate.done();
+        js.wait(c);
+        const auto st = js.snapshot_stats();
+        js.shutdown();
+        if (order != std::vector<int>{3, 2, 1, 0}) return jfail(343, "deadline jobs run earliest-deadline-first");
+        if (st.missed_deadlines[1] != 1) return jfail(344, "missed deadline counted");
+    }
+
+    {
+        JobSystem js;
+        if (!js.init(JobSystem::Config{.thread_count = 1, .queue_capacity = 256, .stall_warn_ms = 100, .aging_ms = 2})) return jfail(345, "JobSystem init (aging)");
+        JobSystem::Counter gate, c;
+        js.init_counter(gate);
+        js.init_counter(c);
+        std::mutex m;
+        std::vector<int> order;
+        std::atomic<int> blocked{0};
+        struct BlockCtx { JobSystem::Counter* gate; std::atomic<int>* blocked; };
+        BlockCtx bc{&gate, &blocked};
+        gate.add(1);
+        js.submit(+[](void* p) {
+            auto* b = static_cast<BlockCtx*>(p);
+            b->blocked->store(1);
+            while (!b->gate->is_done()) std::this_thread::yield();
+        }, &bc, Priority::High, &c, nullptr, "block");
+        while (blocked.load() == 0) std::this_thread::yield();
+        OrderCtx low{&m, &order, -1};
+        js.submit(&push_order, &low, Priority::Low, &c, nullptr, "low");
+        std::vector<OrderCtx> highs;
+        highs.reserve(32);
+        for (int i = 0; i < 32; ++i) highs.push_back(OrderCtx{&m, &order, i});
+        for (auto& h : highs) js.submit(&sleep_job, &h, Priority::High, &c, nullptr, "high");
+        for (auto& h : highs) js.submit(&push_order, &h, Priority::High, &c, nullptr, "high");
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        gate.done();
+        js.wait(c);
+        const auto st = js.snapshot_stats();
+        js.shutdown();
+        if (order.size() != 33 || order.back() == -1) return jfail(346, "aging promotes a starving low lane");
+        if (st.max_queue_age_us[2] <= 0.0f) return jfail(347, "max queue age reported");
+    }
+
+    {
+        JobSystem js;
+        if (!js.init(JobSystem::Config{.thread_count = 2, .queue_capacity = 1024, .stall_warn_ms = 100})) return jfail(348, "JobSystem init (tasks)");
+        StreamCheck chk{std::this_thread::get_id()};
+        // Frames freed on one thread are reused by another only after a cache spills to the shared
+        // pool, so warm up until a whole round runs without heap allocations, then require that to hold.
+        int rounds = 0;
+        auto round = [&] {
+            ++rounds;
+            const std::uint64_t before = cube::jobs::task_frame_stats().heap_allocs;
+            JobSystem::Counter done;
+            js.init_counter(done);
+            for (int i = 0; i < 64; ++i) cube::jobs::spawn(js, stream_one(js, chk, i), &done);
+            js.wait(done);
+            return cube::jobs::task_frame_stats().heap_allocs - before;
+        };
+        while (rounds < 32 && round() != 0) {}
+        std::uint64_t steady_heap = 0;
+        for (int i = 0; i < 4; ++i) steady_heap += round();
+        const auto fs = cube::jobs::task_frame_stats();
+        js.shutdown();
+        if (chk.finished.load() != rounds * 64) return jfail(349, "coroutine pipeline completes");
+        if (chk.wrong_thread.load() != 0) return jfail(350, "coroutine resumes on the main thread");
+        if (steady_heap != 0 || fs.live_frames != 0) return jfail(351, "coroutine frames pooled in steady state");
+    }
+
+    {
+        cube::jobs::LatencyHistogram h;
+        for (std::uint64_t v = 1; v <= 1000; ++v) h.record(v * 1000);
+        const auto a = h.snapshot();
+        const auto p50 = a.percentile(0.50), p99 = a.percentile(0.99);
+        if (a.count != 1000 || a.max_ns != 1000000) return jfail(352, "histogram count/max");
+        if (p50 < 500000 * 7 / 8 || p50 > 500000 * 9 / 8) return jfail(353, "histogram p50 within 12.5%");
+        if (p99 < 990000 * 7 / 8 || p99 > 1000000) return jfail(354, "histogram p99 within 12.5%");
+        for (int i = 0; i < 10; ++i) h.record(5);
+        const auto w = h.snapshot().since(a);
+        if (w.count != 10 || w.percentile(0.5) != 5 || w.max_ns != 5) return jfail(355, "histogram window diff");
+        for (std::uint32_t b = 1; b < cube::jobs::LatencyHistogram::BUCKETS; ++b) {
+            const std::uint64_t lo = cube::jobs::LatencyHistogram::bucket_floor(b);
+            if (cube::jobs::LatencyHistogram::bucket_of(lo) != b || cube::jobs::LatencyHistogram::bucket_of(lo - 1) != b - 1) return jfail(356, "histogram bucket bounds");
+        }
+    }
+
+    {
+        JobSystem js;
+        if (!js.init(JobSystem::Config{.thread_count = 2, .queue_capacity = 1024, .stall_warn_ms = 100})) return jfail(357, "JobSystem init (job types)");
+        JobSystem::Counter c;
+        js.init_counter(c);
+        std::atomic<int> v{0};
+        IncCtx ctx{&v};
+        for (int i = 0; i < 100; ++i) js.submit(&inc_job, &ctx, Priority::Normal, &c, nullptr, "type.a");
+        for (int i = 0; i < 3; ++i) js.submit(&sleep_job, nullptr, Priority::Normal, &c, nullptr, "type.sleep");
+        js.wait(c);
+        std::vector<JobSystem::JobTypeStats> first, second;
+        js.snapshot_job_types(first);
+        js.snapshot_job_types(second);
+        js.shutdown();
+        auto find = [](const std::vector<JobSystem::JobTypeStats>& v, const char* n) -> const JobSystem::JobTypeStats* {
+            for (const auto& t : v) if (std::strcmp(t.name, n) == 0) return &t;
+            return nullptr;
+        };
+        const auto* a = find(first, "type.a");
+        const auto* sl = find(first, "type.sleep");
+        if (!a || !sl || a->run.count != 100 || sl->run.count != 3) return jfail(358, "per-name job counts");
+        if (sl->run.percentile(0.5) < 4000000) return jfail(359, "per-name run time");
+        const auto* a2 = find(second, "type.a");
+        if (!a2 || a2->run.count != 100) return jfail(360, "job type snapshots do not reset");
+    }
+
+    {
+        JobSystem js;
+        if (!js.init(JobSystem::Config{.thread_count = 2, .queue_capacity = 64, .stall_warn_ms = 100})) return jfail(361, "JobSystem init (inline closures)");
+        JobSystem::Counter c, gate;
+        js.init_counter(c);
+        js.init_counter(gate, 1);
+        std::atomic<std::uint64_t> sum{0};
+        struct Payload { std::uint64_t a, b, c, d; };
+        for (std::uint64_t i = 0; i < 500; ++i) {
+            const Payload p{i, i * 2, i * 3, i * 4};
+            js.submit([&sum, p] { sum.fetch_add(p.a + p.b + p.c + p.d, std::memory_order_relaxed); }, (Priority)(i % 3), &c, nullptr, "inline");
+        }
+        std::atomic<int> after{0};
+        js.submit([&after] { after.store(1); }, Priority::High, &c, &gate, "inline.dep");
+        gate.done();
+        js.wait(c);
+        js.shutdown();
+        if (sum.load() != 10ull * (499ull * 500ull / 2ull)) return jfail(362, "inline closures survive queue, overflow and continuations");
+        if (after.load() != 1) return jfail(363, "inline closure as continuation");
+    }
+
+    {
+        JobSystem js;
+        if (!js.init(JobSystem::Config{.thread_count = 3, .queue_capacity = 64, .stall_warn_ms = 100})) return jfail(364, "JobSystem init (bulk)");
+        std::atomic<std::uint64_t> sum{0};
+        auto add = [](void* p) { static_cast<std::atomic<std::uint64_t>*>(p)->fetch_add(1, std::memory_order_relaxed); };
+        std::vector<JobSystem::Job> batch(1000);
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            batch[i].fn = add;
+            batch[i].data = &sum;
+            if (i % 7 == 0) batch[i].deadline_ns = 1 + i;
+        }
+        JobSystem::Counter c;
+        js.init_counter(c);
+        std::vector<std::thread> producers;
+        for (int t = 0; t < 4; ++t) {
+            producers.emplace_back([&] {
+                for (int r = 0; r < 5; ++r) js.submit_batch(batch.data(), batch.size(), (Priority)(r % 3), &c);
+            });
+        }
+        for (auto& t : producers) t.join();
+        js.wait(c);
+        const auto st = js.snapshot_stats();
+        js.shutdown();
+        if (sum.load() != 4u * 5u * 1000u) return jfail(365, "bulk submit runs every job exactly once");
+        if (st.overflow_events == 0) return jfail(366, "bulk submit spills past a full ring");
+    }
+
+    {
+        JobSystem js;
+        if (!js.init(JobSystem::Config{.thread_count = 3, .queue_capacity = 256, .stall_warn_ms = 100})) return jfail(367, "JobSystem init (counter pool)");
+        if (sizeof(JobSystem::Counter) > 32) return jfail(368, "Counter stays compact");
+        const JobSystem::CounterHandle h = js.acquire_counter(1);
+        JobSystem::Counter* hc = js.resolve(h);
+        if (!hc || hc->is_done()) return jfail(369, "pooled counter resolves");
+        if (js.release_counter(h)) return jfail(370, "release refuses a counter with work outstanding");
+        hc->done();
+        if (!js.release_counter(h) || js.resolve(h) || js.release_counter(h)) return jfail(371, "released handle goes stale");
+        const JobSystem::CounterHandle h2 = js.acquire_counter();
+        if (h2.index != h.index || h2.generation == h.generation || js.resolve(h) || !js.resolve(h2)) return jfail(372, "recycled slot gets a new generation");
+        js.release_counter(h2);
+
+        // Many short-lived counters, each waited on and recycled immediately after.
+        std::atomic<std::uint32_t> ran{0};
+        std::vector<JobSystem::CounterHandle> live;
+        for (int round = 0; round < 20; ++round) {
+            live.clear();
+            for (int i = 0; i < 2000; ++i) {
+                live.push_back(js.acquire_counter());
+                js.submit([&ran] { ran.fetch_add(1, std::memory_order_relaxed); }, Priority::Normal, js.resolve(live.back()));
+            }
+            for (const auto& lh : live) {
+                js.wait(*js.resolve(lh));
+                if (!js.release_counter(lh)) return jfail(373, "release after wait");
+            }
+        }
+        const std::uint32_t left = js.pooled_counters();
+        js.shutdown();
+        if (ran.load() != 20u * 2000u) return jfail(374, "pooled counters track their jobs");
+        if (left != 0) return jfail(375, "every pooled counter returned");
+    }
+
+    {
+        JobSystem js;
+        if (!js.init(JobSystem::Config{.thread_count = 2, .queue_capacity = 64, .stall_warn_ms = 100, .scratch_bytes = 64 * 1024})) return jfail(376, "JobSystem init (scratch)");
+        JobSystem::Counter c;
+        js.init_counter(c);
+        std::atomic<int> bad{0};
+        for (int i = 0; i < 200; ++i) {
+            js.submit([&bad, i] {
+                cube::mem::StackAllocator& s = cube::jobs::scratch();
+                if (s.used() != 0 || s.capacity() != 64 * 1024) bad.fetch_add(1);
+                auto* p = static_cast<std::uint8_t*>(s.alloc(1024 + (std::size_t)i * 16, 16));
+                if (!p || ((std::uintptr_t)p & 15u)) bad.fetch_add(1);
+                else std::memset(p, i, 1024);
+                {
+                    cube::mem::StackAllocator::Scope scope(s);
+                    const auto m = s.mark();
+                    if (!s.alloc(512)) bad.fetch_add(1);
+                    if (s.mark() == m) bad.fetch_add(1);
+                }
+                if (s.alloc(128 * 1024)) bad.fetch_add(1);
+            }, Priority::Normal, &c, nullptr, "scratch");
+        }
+        js.wait(c);
+        std::vector<JobSystem::ScratchStats> arenas;
+        js.snapshot_scratch(arenas);
+        const auto st = js.snapshot_stats();
+        std::size_t outside = 1;
+        std::thread([&] { outside = cube::jobs::scratch().capacity(); }).join();
+        js.shutdown();
+        if (bad.load() != 0) return jfail(377, "scratch arena is empty at job start, aligned and bounded");
+        if (arenas.size() != 3 || st.scratch_peak_bytes < 1024 + 199 * 16) return jfail(378, "per-arena scratch peak stats");
+        if (outside != 0) return jfail(379, "threads without an arena get an empty scratch");
+    }
+
+    {
+        // Producers never let the ring get more than half full, so a 0 from enqueue_bulk is spurious.
+        constexpr std::uint32_t CAP = 256;
+        constexpr std::size_t N = 8;
+        cube::jobs::MpmcQueue<std::uint64_t> q;
+        if (!q.init(CAP)) return jfail(380, "MpmcQueue init");
+        std::atomic<std::int64_t> in_flight{0};
+        std::atomic<std::uint64_t> produced{0}, consumed{0}, spurious{0};
+        std::atomic<int> producers_left{3};
+        std::vector<std::thread> ts;
+        for (int p = 0; p < 3; ++p) {
+            ts.emplace_back([&] {
+                const std::uint64_t items[N] = {1, 2, 3, 4, 5, 6, 7, 8};
+                for (int i = 0; i < 20000; ++i) {
+                    while (in_flight.load(std::memory_order_acquire) > (std::int64_t)(CAP / 2)) std::this_thread::yield();
+                    const std::size_t k = q.enqueue_bulk(items, N);
+                    if (k == 0) spurious.fetch_add(1, std::memory_order_relaxed);
+                    in_flight.fetch_add((std::int64_t)k, std::memory_order_release);
+                    produced.fetch_add(k, std::memory_order_relaxed);
+                }
+                producers_left.fetch_sub(1, std::memory_order_release);
+            });
+        }
+        for (int c = 0; c < 2; ++c) {
+            ts.emplace_back([&] {
+                std::uint64_t v = 0;
+                for (;;) {
+                    if (q.dequeue(v)) {
+                        in_flight.fetch_sub(1, std::memory_order_release);
+                        consumed.fetch_add(1, std::memory_order_relaxed);
+                    } else if (producers_left.load(std::memory_order_acquire) == 0 && consumed.load() == produced.load()) {
+                        break;
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        for (auto& t : ts) t.join();
+        if (spurious.load() != 0) return jfail(381, "enqueue_bulk never reports a full ring that has room");
+        if (produced.load() != consumed.load()) return jfail(382, "enqueue_bulk items all dequeued");
+    }
+
+    {
+        JobSystem::Counter c;
+        c.state.store(JobSystem::Counter::FINISHING | 2);
+        c.done();
+        if (c.state.load() != (JobSystem::Counter::FINISHING | 1)) return jfail(383, "non-final done() leaves an earlier finish alone");
+        c.state.store(JobSystem::Counter::WAITER);
+        c.done();
+        if (c.state.load() != JobSystem::Counter::WAITER) return jfail(384, "done() on a zero count does not borrow from waiters");
+    }
+
+    {
+        JobSystem js;
+        if (!js.init(JobSystem::Config{.thread_count = 1, .queue_capacity = 64, .stall_warn_ms = 1000})) return jfail(385, "JobSystem init (blocked waiter)");
+        JobSystem::Counter outer, inner, released;
+        js.init_counter(outer);
+        js.init_counter(inner, 1);
+        js.init_counter(released, 1);
+        // The only worker blocks in wait(); work submitted now has no idle worker to take it.
+        js.submit([&js, &inner] { js.wait(inner); }, Priority::Normal, &outer, nullptr, "blocked");
+        js.submit([&js, &released] { js.wait(released); }, Priority::Normal, &outer, nullptr, "blocked.2");
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        js.submit([&inner] { inner.done(); }, Priority::Normal, nullptr, nullptr, "unblock");
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        released.done();
+        const auto until = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while (!outer.is_settled() && std::chrono::steady_clock::now() < until) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        const bool finished = outer.is_settled();
+        if (!finished) js.wait(outer);
+        js.shutdown();
+        if (!finished) return jfail(386, "a thread blocked in wait() runs work and wakes on its counter");
+    }
+
+#if defined(__linux__)
+    {
+        namespace fs = std::filesystem;
+        const fs::path root = fs::temp_directory_path() / "cube_sysfs_cpu_test";
+        fs::remove_all(root);
+        auto put = [&](const fs::path& p, const std::string& text) {
+            fs::create_directories(p.parent_path());
+            std::ofstream(p) << text << "\n";
+        };
+        put(root / "online", "0-3");
+        for (int cpu = 0; cpu < 4; ++cpu) {
+            const fs::path d = root / ("cpu" + std::to_string(cpu));
+            put(d / "topology" / "physical_package_id", "0");
+            put(d / "topology" / "core_id", std::to_string(cpu % 2));
+            put(d / "topology" / "thread_siblings_list", cpu % 2 ? "1,3" : "0,2");
+            put(d / "cache" / "index3" / "shared_cpu_list", "0-3");
+        }
+        const auto topo = cube::jobs::detect_cpu_topology(root.string());
+        fs::remove_all(root);
+        if (topo.cpus.size() != 4 || topo.physical_cores != 2 || topo.l3_domains != 1) return jfail(340, "sysfs topology parse");
+        if (topo.cpus[2].smt_index != 1 || topo.cpus[2].core != topo.cpus[0].core) return jfail(341, "sysfs SMT siblings");
+    }
+#endif
+
     return 0;
 }
-
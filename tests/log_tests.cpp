@@ -0,0 +1,298 @@
+#include "core/console_text.hpp"
+#include "core/log.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+static int lfail(int code, const char* what) {
+    std::fprintf(stderr, "cube_tests: FAIL(%d): %s\n", code, what);
+    return code;
+}
+
+int run_log_tests() {
+    {
+        namespace fs = std::filesystem;
+        const fs::path path = fs::temp_directory_path() / "cube_log_test.log";
+        fs::remove(path);
+        cube::log::Config cfg{};
+        cfg.file_path = path.string();
+        cfg.write_stdout = false;
+        cfg.queue_capacity = 16;
+        cfg.overflow = cube::log::OverflowPolicy::Block;
+        cube::log::init(cfg);
+
+        const cube::log::Stats before = cube::log::stats();
+        std::vector<std::thread> producers;
+        for (int t = 0; t < 4; ++t) {
+            producers.emplace_back([t] {
+                for (int i = 0; i < 500; ++i) LOG_INFO("Test", "producer %d line %d", t, i);
+            });
+        }
+        for (auto& th : producers) th.join();
+        const std::string long_msg(2000, 'x');
+        LOG_WARN("Test", "%s", long_msg.c_str());
+        cube::log::flush();
+
+        const cube::log::Stats after = cube::log::stats();
+        if (after.dropped != before.dropped || after.written - before.written != 2001) return lfail(501, "blocking log queue loses nothing");
+        std::ifstream in(path);
+        std::string line;
+        int lines = 0;
+        bool long_ok = false;
+        while (std::getline(in, line)) {
+            lines++;
+            if (line.find(long_msg) != std::string::npos) long_ok = true;
+        }
+        if (lines != 2001) return lfail(502, "writer thread writes every line to the file");
+        if (!long_ok) return lfail(503, "messages longer than a record survive the queue");
+        const auto entries = cube::log::snapshot();
+        if (entries.empty() || entries.back().category != "Test") return lfail(504, "writer thread feeds the log viewer");
+
+        cfg.overflow = cube::log::OverflowPolicy::Drop;
+        cfg.queue_capacity = 2;
+        cube::log::init(cfg);
+        const cube::log::Stats d0 = cube::log::stats();
+        for (int i = 0; i < 5000; ++i) LOG_INFO("Test", "burst %d", i);
+        cube::log::flush();
+        const cube::log::Stats d1 = cube::log::stats();
+        if ((d1.written - d0.written) + (d1.dropped - d0.dropped) != 5000) return lfail(505, "dropped and written lines account for every call");
+
+        cube::log::set_level_mask(1u << 2);
+        LOG_INFO("Test", "filtered");
+        cube::log::flush();
+        if (cube::log::stats().written != d1.written) return lfail(506, "level mask filters before queueing");
+        cube::log::set_level_mask(0xFF);
+
+        cfg.async = false;
+        cube::log::init(cfg);
+        const std::uint64_t w = cube::log::stats().written;
+        LOG_INFO("Test", "synchronous");
+        if (cube::log::stats().written != w + 1) return lfail(507, "logging without a writer thread is synchronous");
+        cube::log::shutdown();
+
+        cube::log::Config sync{};
+        sync.file_path.clear();
+        sync.async = false;
+        cube::log::init(sync);
+        fs::remove(path);
+    }
+
+    {
+        using namespace cube::log;
+        const char* fmt = "%d|%5.2f|%s|%zu|%llx|%c|%-6s|%%|%.*s|%p";
+        int* ptr = (int*)(std::uintptr_t)0x1234;
+        const std::size_t len = encoded_size(-42, 3.14159, "abc", (std::size_t)7, 0xbeefull, 'q', "ab", 3, "xyzw", ptr);
+        std::vector<std::byte> args(len);
+        encode_args(args.data(), -42, 3.14159, "abc", (std::size_t)7, 0xbeefull, 'q', "ab", 3, "xyzw", ptr);
+        std::string got;
+        format_args(got, fmt, args.data(), args.size());
+        char want[256];
+        std::snprintf(want, sizeof(want), fmt, -42, 3.14159, "abc", (std::size_t)7, 0xbeefull, 'q', "ab", 3, "xyzw", (void*)ptr);
+        if (got != want) return lfail(508, "deferred formatting matches snprintf");
+        got.clear();
+        format_args(got, "%d %s", args.data(), 9);
+        if (got != "-42 <?>") return lfail(521, "missing arguments format as <?>");
+
+        int evaluated = 0;
+        auto bump = [&] { return ++evaluated; };
+        set_level_mask(1u << 2);
+        LOG_INFO("Test", "%d", bump());
+        set_level_mask(0xFF);
+        if (evaluated != 0) return lfail(509, "filtered calls do not evaluate their arguments");
+
+        static_assert(compiled_in(Level::Info, "Test"));
+        if (category_min_level("Jobs", "Jobs=1,Render=2", 0) != 1 || category_min_level("Render", "Jobs=1,Render=2", 0) != 2 ||
+            category_min_level("Core", "Jobs=1,Render=2", 1) != 1) {
+            return lfail(510, "per-category compile-time floors");
+        }
+
+        namespace fs = std::filesystem;
+        const fs::path bin = fs::temp_directory_path() / "cube_log_test.clog";
+        fs::remove(bin);
+        Config cfg{};
+        cfg.file_path.clear();
+        cfg.binary_path = bin.string();
+        cfg.write_stdout = false;
+        cfg.overflow = OverflowPolicy::Block;
+        init(cfg);
+        const std::string long_arg(1000, 'y');
+        LOG_INFO("Test", "binary %d %s", 1, "one");
+        LOG_WARN("Test", "long %s", long_arg.c_str());
+        LOG_ERROR("Test", "float %.3f", 2.5);
+        shutdown();
+        init(cfg);
+        LOG_INFO("Test", "second session %u", 2u);
+        shutdown();
+
+        std::ifstream in(bin, std::ios::binary);
+        const std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        std::vector<std::string> msgs;
+        std::vector<Level> levels;
+        const bool ok = read_binary_log((const std::byte*)bytes.data(), bytes.size(), [&](const BinaryRecord& r) {
+            if (r.category == "Test") {
+                msgs.push_back(r.message());
+                levels.push_back(r.level);
+            }
+        });
+        if (!ok || msgs.size() != 4) return lfail(511, "binary log round trip");
+        if (msgs[0] != "binary 1 one" || msgs[1] != "long " + long_arg || msgs[2] != "float 2.500" || msgs[3] != "second session 2" || levels[2] != Level::Error) {
+            return lfail(512, "decoded binary records match the calls");
+        }
+        const bool truncated = read_binary_log((const std::byte*)bytes.data(), bytes.size() - 3, [](const BinaryRecord&) {});
+        if (truncated) return lfail(513, "truncated binary log is reported");
+        const auto entries = snapshot();
+        if (entries.empty() || entries.back().text.find("second session 2") == std::string::npos) return lfail(514, "viewer formats records without a text sink");
+
+        Config sync{};
+        sync.file_path.clear();
+        sync.async = false;
+        init(sync);
+        fs::remove(bin);
+    }
+
+    {
+        using namespace cube::log;
+        Config cfg{};
+        cfg.file_path.clear();
+        cfg.write_stdout = false;
+        cfg.async = false;
+        cfg.max_entries = 8;
+        init(cfg);
+        clear();
+        std::uint64_t cursor = read_since(0, [](const LineView&) {});
+        for (int i = 0; i < 3; ++i) LOG_INFO("Test", "ring %d", i);
+        std::vector<std::uint64_t> seqs;
+        std::vector<std::string> texts;
+        cursor = read_since(cursor, [&](const LineView& l) {
+            seqs.push_back(l.seq);
+            texts.emplace_back(l.text);
+        });
+        if (seqs.size() != 3 || seqs[1] != seqs[0] + 1 || seqs[2] != seqs[1] + 1 || cursor != seqs[2] + 1) {
+            return lfail(515, "read_since returns new lines with consecutive seqs");
+        }
+        if (texts[2].find("ring 2") == std::string::npos) return lfail(522, "read_since formats history lines");
+        int again = 0;
+        if (read_since(cursor, [&](const LineView&) { again++; }) != cursor || again) return lfail(516, "read_since with a current cursor is empty");
+
+        for (int i = 0; i < 20; ++i) LOG_INFO("Test", "wrap %d", i);
+        seqs.clear();
+        texts.clear();
+        cursor = read_since(cursor, [&](const LineView& l) {
+            seqs.push_back(l.seq);
+            texts.emplace_back(l.text);
+        });
+        if (seqs.size() != 8 || seqs.back() + 1 != cursor || texts.front().find("wrap 12") == std::string::npos) {
+            return lfail(517, "overwritten lines are skipped");
+        }
+
+        LOG_INFO("Test", "before clear");
+        clear();
+        LOG_INFO("Test", "after clear");
+        texts.clear();
+        read_since(cursor, [&](const LineView& l) { texts.emplace_back(l.text); });
+        if (texts.size() != 1 || texts[0].find("after clear") == std::string::npos) return lfail(518, "clear hides earlier lines");
+        if (snapshot().size() != 1) return lfail(523, "snapshot follows clear");
+
+        // A minute-long window, so the burst cannot straddle two windows however slow the build.
+        int evaluated = 0;
+        auto hot = [&](int i) {
+            CUBE_LOG_LIMITED_AT(Level::Warn, "Test", 3, 60000, "hot %d %d", i, ++evaluated);
+        };
+        cursor = read_since(0, [](const LineView&) {});
+        for (int i = 0; i < 10; ++i) hot(i);
+        texts.clear();
+        cursor = read_since(cursor, [&](const LineView& l) { texts.emplace_back(l.text); });
+        if (texts.size() != 3 || evaluated != 3) return lfail(519, "rate limit passes the first burst and skips the arguments of the rest");
+
+        // Window rollover on a clock the test drives.
+        RateLimit rl;
+        const std::uint64_t suppressed = stats().suppressed;
+        int passed = 0;
+        for (int i = 0; i < 10; ++i) passed += rate_limit_pass_at(rl, Level::Warn, "Test", std::source_location::current(), 3, 50, 1000 + i);
+        const bool reopened = rate_limit_pass_at(rl, Level::Warn, "Test", std::source_location::current(), 3, 50, 1100);
+        texts.clear();
+        read_since(cursor, [&](const LineView& l) { texts.emplace_back(l.text); });
+        if (passed != 3 || !reopened || texts.size() != 1 || texts[0].find("repeated 7 more times in 0.1s") == std::string::npos) {
+            return lfail(520, "next window reports the suppressed count first");
+        }
+        if (stats().suppressed - suppressed != 7) return lfail(524, "suppressed lines are counted");
+        if (read_since(0, {}) != read_since(0, [](const LineView&) {})) return lfail(527, "an empty reader gets the end cursor");
+
+        // Producers racing a shutdown: every line lands in the history, queued or written synchronously.
+        cfg.async = true;
+        cfg.max_entries = 16384;
+        cfg.queue_capacity = 64;
+        cfg.overflow = OverflowPolicy::Block;
+        init(cfg);
+        cursor = read_since(0, [](const LineView&) {});
+        std::atomic<int> started{0};
+        std::vector<std::thread> producers;
+        for (int t = 0; t < 4; ++t) {
+            producers.emplace_back([&, t] {
+                started.fetch_add(1);
+                for (int i = 0; i < 2000; ++i) LOG_INFO("Test", "race %d %d", t, i);
+            });
+        }
+        while (started.load() < 4) std::this_thread::yield();
+        shutdown();
+        for (auto& p : producers) p.join();
+        std::size_t raced = 0;
+        read_since(cursor, [&](const LineView& l) { raced += l.text.find("race ") != std::string_view::npos; });
+        if (raced != 8000) return lfail(525, "lines logged during shutdown are not lost");
+
+        // flush() returns only once the caller's own line is written, whatever other producers are doing.
+        init(cfg);
+        std::atomic<bool> missing{false};
+        producers.clear();
+        for (int t = 0; t < 4; ++t) {
+            producers.emplace_back([&, t] {
+                for (int i = 0; i < 200 && !missing.load(); ++i) {
+                    char want[32];
+                    std::snprintf(want, sizeof(want), "mine %d %d", t, i);
+                    LOG_INFO("Test", "%s", want);
+                    flush();
+                    bool found = false;
+                    read_since(0, [&](const LineView& l) { found |= l.text.find(want) != std::string_view::npos; });
+                    if (!found) missing.store(true);
+                }
+            });
+        }
+        for (auto& p : producers) p.join();
+        shutdown();
+        if (missing.load()) return lfail(528, "flush waits for the caller's own line");
+
+        Config sync{};
+        sync.file_path.clear();
+        sync.async = false;
+        init(sync);
+    }
+
+    {
+        // Once built, the console text grows in place and must match a rebuild from the same messages.
+        struct Msg { std::string text; };
+        std::vector<Msg> msgs{{"one"}, {"two"}};
+        ConsoleText text;
+        text.append("dropped while dirty");
+        text.refresh(msgs);
+        bool ok = std::string(text.c_str(), text.size()) == std::string("one\ntwo\n", 9);
+        for (const char* line : {"three", "", "four"}) {
+            msgs.push_back({line});
+            text.append(line);
+        }
+        const std::string appended(text.c_str(), text.size());
+        ok = ok && !text.dirty() && appended.back() == '\0' && appended.find('\0') == appended.size() - 1;
+        text.invalidate();
+        text.refresh(msgs);
+        ok = ok && appended == std::string(text.c_str(), text.size());
+        if (!ok) return lfail(526, "console text appends match a rebuild");
+    }
+
+    return 0;
+}
@@ -18,6 +18,8 @@ static int fail(int code, const char* what) {
 
 int run_memory_tests();
 int run_job_tests();
+int run_log_tests();
+int run_bench_tests();
 int run_voxel_tests();
 
 int main() {
@@ -126,6 +128,8 @@ int main() {
 
     if (int r = run_memory_tests(); r != 0) return r;
     if (int r = run_job_tests(); r != 0) return r;
+    if (int r = run_log_tests(); r != 0) return r;
+    if (int r = run_bench_tests(); r != 0) return r;
     if (int r = run_voxel_tests(); r != 0) return r;
 
     std::puts("cube_tests: OK");
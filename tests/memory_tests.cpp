@@ -1,10 +1,27 @@
+#include "memory/concurrent_pool.hpp"
+#include "memory/deferred_ring.hpp"
 #include "memory/linear_allocator.hpp"
+#include "memory/heap_allocator.hpp"
+#include "memory/heap_profiler.hpp"
+#include "memory/memory_category.hpp"
+#include "memory/pmr.hpp"
 #include "memory/pool_allocator.hpp"
+#include "memory/slab_allocator.hpp"
 #include "memory/stack_allocator.hpp"
+#include "memory/thread_scratch.hpp"
+#include "memory/virtual_arena.hpp"
+#include "memory/virtual_memory.hpp"
 
 #include <cstdio>
 #include <cstddef>
 #include <array>
+#include <atomic>
+#include <cstring>
+#include <cstdlib>
+#include <filesystem>
+#include <set>
+#include <thread>
+#include <vector>
 
 static int mfail(int code, const char* what) {
     std::fprintf(stderr, "cube_tests: FAIL(%d): %s\n", code, what);
@@ -56,6 +73,263 @@ int run_memory_tests() {
         if (!f) return mfail(224, "PoolAllocator reuse freed");
     }
 
+    {
+        const std::size_t page = cube::mem::page_size();
+        cube::mem::VirtualArena a;
+        if (!a.init(64ull * 1024ull * 1024ull, 64 * 1024, 128 * 1024)) return mfail(231, "VirtualArena reserve");
+        if (a.committed() != 0) return mfail(232, "VirtualArena commits nothing up front");
+        auto* p = static_cast<std::byte*>(a.alloc(100, 64));
+        if (!p || ((std::uintptr_t)p & 63u) || a.committed() != 64 * 1024) return mfail(233, "VirtualArena commits one step on first alloc");
+        auto* big = static_cast<std::byte*>(a.alloc(8ull * 1024ull * 1024ull, 16));
+        if (!big) return mfail(234, "VirtualArena grows past the first step");
+        std::memset(big, 0xab, 8ull * 1024ull * 1024ull);
+        if (a.committed() < a.used() || a.committed() % page) return mfail(235, "VirtualArena committed covers used");
+        if (a.alloc(a.capacity())) return mfail(236, "VirtualArena fails past reservation");
+        a.reset();
+        if (a.used() != 0 || a.committed() != 128 * 1024) return mfail(237, "VirtualArena decommits above retain on reset");
+        auto* again = static_cast<std::byte*>(a.alloc(1024 * 1024));
+        if (!again || again != p) return mfail(238, "VirtualArena recommits after reset");
+        again[1024 * 1024 - 1] = std::byte{1};
+        if (a.stats().peak_bytes_in_use < 8ull * 1024ull * 1024ull) return mfail(239, "VirtualArena peak stats");
+        cube::mem::VirtualArena moved(static_cast<cube::mem::VirtualArena&&>(a));
+        if (a.capacity() != 0 || moved.used() != 1024 * 1024) return mfail(240, "VirtualArena move");
+    }
+
+    {
+        cube::mem::ConcurrentPool pool;
+        if (!pool.init(40, 16, 4096, 8)) return mfail(241, "ConcurrentPool init");
+        if (pool.block_size() != 48) return mfail(242, "ConcurrentPool rounds blocks to alignment");
+        void* a = pool.alloc(40, 16);
+        void* b = pool.alloc(8);
+        if (!a || !b || a == b || ((std::uintptr_t)a & 15u) || pool.alloc(49)) return mfail(243, "ConcurrentPool alloc");
+        pool.free(b);
+        if (pool.alloc(8) != b) return mfail(244, "ConcurrentPool reuses the thread's last free");
+        pool.free(a);
+        pool.free(b);
+        if (pool.stats().bytes_in_use != 0) return mfail(245, "ConcurrentPool stats");
+    }
+
+    {
+        // ABA stress: magazines of one block push every free through the tagged Treiber stack, and a
+        // two-slab cap keeps the same few blocks cycling between threads.
+        cube::mem::ConcurrentPool pool;
+        if (!pool.init(32, 16, 4096, 1, 8192)) return mfail(246, "ConcurrentPool init (stress)");
+        constexpr int THREADS = 8;
+        constexpr int ITERS = 50000;
+        std::atomic<int> corrupt{0};
+        std::atomic<int> failed{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; ++t) {
+            threads.emplace_back([&, t] {
+                std::array<std::uint64_t*, 4> held{};
+                for (int i = 0; i < ITERS; ++i) {
+                    const std::size_t k = (std::size_t)(i % 4);
+                    if (held[k]) {
+                        if (held[k][2] != (std::uint64_t)t || held[k][3] != (std::uint64_t)(i - 4)) corrupt.fetch_add(1);
+                        pool.free(held[k]);
+                    }
+                    held[k] = static_cast<std::uint64_t*>(pool.alloc(32));
+                    if (!held[k]) { failed.fetch_add(1); continue; }
+                    held[k][2] = (std::uint64_t)t;
+                    held[k][3] = (std::uint64_t)i;
+                    if ((i & 255) == 0) std::this_thread::yield();
+                }
+                for (auto* p : held) pool.free(p);
+                pool.flush_thread_cache();
+            });
+        }
+        for (auto& th : threads) th.join();
+        if (corrupt.load() || failed.load()) return mfail(247, "ConcurrentPool hands out each block to one owner at a time");
+        const auto st = pool.stats();
+        if (st.alloc_count != st.free_count || st.alloc_count != (std::uint64_t)THREADS * ITERS) return mfail(248, "ConcurrentPool alloc/free balance");
+        std::set<void*> all;
+        const std::size_t blocks = pool.block_count();
+        for (std::size_t i = 0; i < blocks; ++i) all.insert(pool.alloc(32));
+        if (all.count(nullptr) || all.size() != blocks || pool.block_count() != blocks) return mfail(249, "ConcurrentPool loses or duplicates no blocks");
+    }
+
+    {
+        using cube::mem::SlabAllocator;
+        const std::size_t expect[] = {16, 24, 32, 48, 64, 96, 128};
+        for (std::uint32_t c = 0; c < 7; ++c) if (SlabAllocator::class_size(c) != expect[c]) return mfail(251, "SlabAllocator class sizes");
+        if (SlabAllocator::class_size(SlabAllocator::CLASS_COUNT - 1) != SlabAllocator::MAX_SMALL) return mfail(296, "SlabAllocator largest class");
+        if (SlabAllocator::class_of(1) != 0 || SlabAllocator::class_of(17) != 1 || SlabAllocator::class_of(25) != 2 || SlabAllocator::class_of(33) != 3 ||
+            SlabAllocator::class_of(24, 16) != 2 || SlabAllocator::class_of(SlabAllocator::MAX_SMALL + 1) != SlabAllocator::CLASS_COUNT) {
+            return mfail(252, "SlabAllocator class_of");
+        }
+
+        SlabAllocator slab;
+        if (!slab.init(64ull * 1024ull * 1024ull)) return mfail(253, "SlabAllocator init");
+        std::vector<std::pair<std::byte*, std::size_t>> live;
+        for (std::size_t size = 1; size <= 40000; size = size * 5 / 4 + 1) {
+            auto* p = static_cast<std::byte*>(slab.alloc(size));
+            if (!p || ((std::uintptr_t)p & 15u)) return mfail(254, "SlabAllocator alloc aligned");
+            std::memset(p, (int)(size & 0xff), size);
+            live.emplace_back(p, size);
+        }
+        for (const auto& [p, size] : live) {
+            if (p[size - 1] != (std::byte)(size & 0xff)) return mfail(255, "SlabAllocator blocks do not overlap");
+            if (slab.owns(p) != (size <= SlabAllocator::MAX_SMALL)) return mfail(256, "SlabAllocator routes large requests to the heap");
+        }
+        if (slab.class_stats(SlabAllocator::class_of(100)).bytes_in_use == 0 || slab.large_stats().alloc_count == 0) return mfail(257, "SlabAllocator per-class stats");
+        for (const auto& [p, size] : live) slab.free(p);
+        if (slab.stats().bytes_in_use != 0) return mfail(258, "SlabAllocator frees everything");
+        void* over = slab.alloc(64, 128);
+        if (!over || ((std::uintptr_t)over & 127u)) return mfail(259, "SlabAllocator over-aligned request");
+        slab.free(over);
+
+        cube::mem::IAllocator& def = cube::mem::category_allocator(cube::mem::MemCategory::Voxel);
+        cube::mem::set_category_allocator(cube::mem::MemCategory::Voxel, &slab);
+        const bool opted = &cube::mem::category_allocator(cube::mem::MemCategory::Voxel) == &slab;
+        cube::mem::set_category_allocator(cube::mem::MemCategory::Voxel, nullptr);
+        if (!opted || &cube::mem::category_allocator(cube::mem::MemCategory::Voxel) != &def) return mfail(260, "memory categories opt in and back out");
+    }
+
+    {
+        using namespace cube::mem;
+        HeapAllocator heap;
+        AllocatorResource res(heap);
+        {
+            pmr::vector<std::uint64_t> v(&res);
+            for (std::uint64_t i = 0; i < 1000; ++i) v.push_back(i);
+            pmr::unordered_map<int, pmr::string> m(&res);
+            m.emplace(1, pmr::string(200, 'x', &res));
+            if (heap.stats().bytes_in_use < 1000 * sizeof(std::uint64_t) + 200) return mfail(261, "pmr containers allocate through AllocatorResource");
+            if (m.at(1).get_allocator().resource() != &res) return mfail(262, "pmr allocator propagates to nested strings");
+        }
+        if (heap.stats().bytes_in_use != 0 || heap.stats().alloc_count != heap.stats().free_count) return mfail(263, "pmr containers free through AllocatorResource");
+        HeapAllocator other;
+        AllocatorResource same(heap), diff(other);
+        if (!res.is_equal(same) || res.is_equal(diff)) return mfail(264, "AllocatorResource equality follows the allocator");
+
+        HeapAllocator voxel;
+        std::pmr::memory_resource* cat = category_resource(MemCategory::Voxel);
+        {
+            ScopedCategoryAllocator scope(MemCategory::Voxel, &voxel);
+            pmr::vector<int> v(cat);
+            v.resize(64);
+            if (voxel.stats().alloc_count != 1) return mfail(265, "category resource follows the category switch");
+        }
+        if (&category_allocator(MemCategory::Voxel) == &voxel || voxel.stats().bytes_in_use != 0) return mfail(266, "ScopedCategoryAllocator restores the default");
+    }
+
+    {
+        using namespace cube::mem;
+        const std::size_t rate = heap_sample_rate();
+        set_heap_sample_rate(4096);
+        std::vector<void*> blocks;
+        {
+            MemTagScope tag(MemCategory::Mesh);
+            if (current_mem_tag() != MemCategory::Mesh) return mfail(267, "MemTagScope sets the thread tag");
+            for (int i = 0; i < 20000; ++i) {
+                void* p = std::malloc(256);
+                heap_profile_alloc(p, 256);
+                blocks.push_back(p);
+            }
+        }
+        if (current_mem_tag() != MemCategory::General) return mfail(288, "MemTagScope restores the thread tag");
+
+        HeapProfile prof = heap_profile_snapshot();
+        const double expected = 20000.0 * 256.0;
+        const double mesh = (double)prof.category_bytes[(std::size_t)MemCategory::Mesh];
+        if (mesh < expected * 0.85 || mesh > expected * 1.15) return mfail(268, "sampled estimate tracks live bytes");
+        if (prof.sites.empty() || prof.sites[0].category != MemCategory::Mesh || prof.sites[0].samples == 0) return mfail(269, "samples grouped by call site");
+
+        const std::string path = (std::filesystem::temp_directory_path() / "cube_heap_profile_test.txt").string();
+        if (!heap_profile_dump(path) || std::filesystem::file_size(path) == 0) return mfail(270, "heap profile dump");
+        std::filesystem::remove(path);
+
+        for (void* p : blocks) {
+            heap_profile_free(p);
+            std::free(p);
+        }
+        blocks.clear();
+        if (heap_profile_snapshot().category_bytes[(std::size_t)MemCategory::Mesh] != 0) return mfail(271, "frees retire samples");
+
+        set_heap_sample_rate(0);
+        {
+            MemTagScope tag(MemCategory::Mesh);
+            for (int i = 0; i < 1000; ++i) {
+                void* p = std::malloc(256);
+                heap_profile_alloc(p, 256);
+                blocks.push_back(p);
+            }
+        }
+        if (heap_profile_snapshot().category_bytes[(std::size_t)MemCategory::Mesh] != 0) return mfail(272, "sample rate 0 disables sampling");
+        for (void* p : blocks) {
+            heap_profile_free(p);
+            std::free(p);
+        }
+        set_heap_sample_rate(rate);
+    }
+
+    {
+        using namespace cube::mem;
+        const std::size_t huge = huge_page_size();
+        VirtualArena a;
+        if (!a.init(64ull * 1024ull * 1024ull, VirtualArena::DEFAULT_COMMIT_STEP, 4ull * 1024ull * 1024ull, PageSize::Huge)) return mfail(273, "huge page arena reserve");
+        auto* p = static_cast<std::byte*>(a.alloc(8ull * 1024ull * 1024ull, 64));
+        if (!p) return mfail(289, "huge page arena alloc");
+        std::memset(p, 1, 8ull * 1024ull * 1024ull);
+        if (huge && (((std::uintptr_t)a.base() & (huge - 1)) || (a.committed() & (huge - 1)))) return mfail(274, "huge page arena aligned to huge pages");
+        if (a.huge_bytes() > a.committed()) return mfail(275, "huge bytes bounded by committed bytes");
+        a.reset();
+        if (huge && a.committed() != 4ull * 1024ull * 1024ull) return mfail(276, "huge page arena retains whole huge pages");
+
+        SlabAllocator slab;
+        if (!slab.init(256ull * 1024ull * 1024ull, PageSize::Huge)) return mfail(277, "huge page slab init");
+        void* q = slab.alloc(100);
+        if (!q || !slab.owns(q) || (huge && (slab.committed() & (huge - 1)))) return mfail(290, "huge page slab commits whole huge pages");
+        slab.free(q);
+    }
+
+    {
+        using namespace cube::mem;
+        alignas(16) static std::byte buf[1024];
+        DeferredRing ring(buf, sizeof(buf));
+        if (ring.alloc(16)) return mfail(278, "deferred ring needs an open epoch");
+        if (!ring.begin_epoch(1) || ring.begin_epoch(1)) return mfail(291, "deferred ring epochs must increase");
+        auto* a = static_cast<std::byte*>(ring.alloc(400, 16));
+        if (!ring.begin_epoch(2)) return mfail(292, "deferred ring second epoch");
+        auto* b = static_cast<std::byte*>(ring.alloc(400, 16));
+        if (!a || !b || b < a + 400) return mfail(279, "deferred ring allocations do not overlap");
+        if (ring.alloc(400, 16)) return mfail(280, "deferred ring full while epochs are in flight");
+        if (ring.epoch_count() != 2 || ring.epoch_usage(0).epoch != 1 || ring.epoch_usage(0).bytes != 400 || ring.epoch_usage(1).allocs != 1) return mfail(281, "deferred ring per-epoch usage");
+
+        ring.retire(1);
+        if (ring.in_flight() != 400 || ring.epoch_count() != 1) return mfail(282, "deferred ring retires completed epochs only");
+        if (!ring.begin_epoch(3)) return mfail(293, "deferred ring third epoch");
+        auto* c = static_cast<std::byte*>(ring.alloc(300, 16));
+        if (c != buf) return mfail(283, "deferred ring wraps into reclaimed space");
+        if (ring.epoch_usage(1).bytes != 1024 - 800 + 300) return mfail(294, "deferred ring charges skipped tail bytes to the epoch");
+        ring.retire(3);
+        if (ring.in_flight() != 0 || ring.epoch_count() != 0 || ring.stats().free_count != 3) return mfail(284, "deferred ring drains");
+
+        DeferredRing lagged(buf, sizeof(buf), 2);
+        lagged.begin_epoch(10);
+        lagged.alloc(64);
+        lagged.retire(11);
+        if (lagged.in_flight() == 0) return mfail(285, "deferred ring latency holds epochs back");
+        lagged.retire(12);
+        if (lagged.in_flight() != 0) return mfail(295, "deferred ring latency releases epochs");
+
+        DeferredRing many(buf, sizeof(buf));
+        for (std::uint64_t e = 1; e <= DeferredRing::MAX_EPOCHS; ++e) many.begin_epoch(e);
+        if (many.begin_epoch(DeferredRing::MAX_EPOCHS + 1)) return mfail(286, "deferred ring bounds epochs in flight");
+    }
+
+    {
+        using namespace cube::mem;
+        alignas(16) std::byte buf[256];
+        StackAllocator mine(buf, sizeof(buf));
+        bool ok = !thread_scratch().alloc(16);
+        StackAllocator* prev = set_thread_scratch(&mine);
+        ok = ok && !prev && &thread_scratch() == &mine && thread_scratch().alloc(16);
+        std::thread([&] { if (thread_scratch().alloc(16)) ok = false; }).join();
+        ok = ok && set_thread_scratch(nullptr) == &mine && !thread_scratch().alloc(16);
+        if (!ok) return mfail(287, "thread scratch is per thread and empty until installed");
+    }
+
     return 0;
 }
 
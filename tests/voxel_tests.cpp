@@ -1,3 +1,5 @@
+#include "memory/heap_allocator.hpp"
+#include "memory/pmr.hpp"
 #include "voxel/blocks.hpp"
 #include "voxel/chunk.hpp"
 #include "voxel/chunk_manager.hpp"
@@ -53,6 +55,26 @@ int run_voxel_tests() {
         if (st.evictions == 0) return vfail(433, "evictions occur");
     }
 
+    {
+        cube::mem::HeapAllocator heap;
+        cube::mem::AllocatorResource res(heap);
+        {
+            ChunkManager m(0, &res);
+            const ChunkCoord cc{0, 0, 0};
+            for (int x = 0; x < 16; ++x) m.set_block(cc, x, 0, 0, (BlockID)(1 + (x & 3)));
+            const Chunk* c = m.get_chunk(cc);
+            if (!c || c->resource() != &res) return vfail(441, "chunk uses the manager's resource");
+            if (heap.stats().bytes_in_use < c->payload_bytes()) return vfail(442, "chunk block storage allocates from the resource");
+            const auto allocs = heap.stats().alloc_count;
+            m.set_block(cc, 0, 0, 0, 2);
+            m.set_block(cc, 1, 0, 0, 1);
+            if (heap.stats().alloc_count != allocs) return vfail(443, "edits within the palette do not allocate");
+            m.set_block(cc, 0, 0, 0, 3);
+            if (m.get_block(cc, 0, 0, 0) != 3 || m.get_block(cc, 1, 0, 0) != 1 || m.get_block(cc, 5, 0, 0) != 2) return vfail(444, "edits read back");
+        }
+        if (heap.stats().bytes_in_use != 0) return vfail(445, "chunk manager returns everything to the resource");
+    }
+
     return 0;
 }
 
@@ -0,0 +1,65 @@
+// Prints a binary log (Config::binary_path) as text, in the same line format as cube.log.
+//
+//   cube_log_decode cube.clog [--min-level info|warn|error] [--category Name]
+
+#include "core/log_format.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace {
+
+int usage() {
+    std::fprintf(stderr, "usage: cube_log_decode <file> [--min-level info|warn|error] [--category Name]\n");
+    return 2;
+}
+
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) return usage();
+    const char* path = argv[1];
+    int min_level = 0;
+    std::string category;
+    for (int i = 2; i < argc; ++i) {
+        if (!std::strcmp(argv[i], "--min-level") && i + 1 < argc) {
+            const char* l = argv[++i];
+            if (!std::strcmp(l, "info")) min_level = 0;
+            else if (!std::strcmp(l, "warn")) min_level = 1;
+            else if (!std::strcmp(l, "error")) min_level = 2;
+            else return usage();
+        } else if (!std::strcmp(argv[i], "--category") && i + 1 < argc) {
+            category = argv[++i];
+        } else {
+            return usage();
+        }
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        std::fprintf(stderr, "cube_log_decode: cannot open %s\n", path);
+        return 1;
+    }
+    const std::vector<char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    std::string line;
+    std::size_t records = 0;
+    const bool ok = cube::log::read_binary_log((const std::byte*)bytes.data(), bytes.size(), [&](const cube::log::BinaryRecord& r) {
+        if ((int)r.level < min_level) return;
+        if (!category.empty() && r.category != category) return;
+        line.clear();
+        cube::log::format_line(line, r.level, r.time_ms, r.category, r.file, r.line, r.message());
+        line += '\n';
+        std::fwrite(line.data(), 1, line.size(), stdout);
+        records++;
+    });
+    if (!ok) {
+        std::fprintf(stderr, "cube_log_decode: %s is truncated or not a binary log (%zu records decoded)\n", path, records);
+        return 1;
+    }
+    return 0;
+}